@@ -52,7 +52,7 @@ Array* make_o_files(Array *c_files) {
         obj_file_path = change_extension(obj_file_path, "o");
         
         RUN(GC, "-c", (char *)c_files->items[i], "-o", obj_file_path, 
-            GC_FLAGS, "-I"RAYLIB_SRC, "-I./src/ttf", "-I./src/logger");
+            GC_FLAGS, "-I"RAYLIB_SRC, "-I./src/ttf", "-I./src/logger", "-I./src/pool", "-I./src/raster");
         
         array_add(o_files, obj_file_path);
     }
@@ -1,10 +1,12 @@
 #include "logger.h"
 #include <stdarg.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 bool print_time_in_log = false;
 bool print_where_in_log = false;
 
-static log_level global_min_level = DEBUG;
+static _Atomic(log_level) global_min_level = DEBUG;
 
 typedef struct {
     log_handler_fn handler;
@@ -13,12 +15,17 @@ typedef struct {
     bool active;
 } handler_entry;
 
+// handlers are copied out under the lock and called without it,
+// so a handler may log or register handlers itself
 static handler_entry handlers[MAX_LOG_HANDLERS] = {0};
 static int handler_count = 0;
 static bool default_handler_registered = false;
+static pthread_mutex_t handlers_lock = PTHREAD_MUTEX_INITIALIZER;
 
 void default_log_handler(const log_message* message, void* user_data) {
-    (void)user_data;     
+    (void)user_data;
+    // one message per lock so lines from different threads do not interleave
+    flockfile(stdout);
     printf("%s[%s]%s ", message->color, message->level_str, RESET);
     
     if (print_time_in_log) {
@@ -30,13 +37,19 @@ void default_log_handler(const log_message* message, void* user_data) {
     }
     
     printf(": %s\n", message->formatted_message);
+    funlockfile(stdout);
 }
 
+static bool add_handler_locked(log_handler_fn handler, void* user_data, log_level min_level);
+
+// the default handler is in place before the flag is visible to any other thread
 static void init_logger() {
+    pthread_mutex_lock(&handlers_lock);
     if (!default_handler_registered) {
-        register_log_handler(default_log_handler, NULL, DEBUG);
+        add_handler_locked(default_log_handler, NULL, DEBUG);
         default_handler_registered = true;
     }
+    pthread_mutex_unlock(&handlers_lock);
 }
 
 const char *log_level_to_str(log_level level) {
@@ -72,10 +85,11 @@ const char *log_level_to_color(log_level level) {
 }
 
 char *current_time_str(void) {
-    static char time_str[64];
+    static _Thread_local char time_str[64];
     time_t now = time(NULL);
-    struct tm *time_info = localtime(&now);
-    strftime(time_str, sizeof(time_str), LOG_TIME_PATTERN, time_info);
+    struct tm time_info;
+    localtime_r(&now, &time_info);
+    strftime(time_str, sizeof(time_str), LOG_TIME_PATTERN, &time_info);
     return time_str;
 }
 
@@ -102,19 +116,21 @@ void logger(const char *file, int line, log_level level, const char *format,
     vsnprintf(formatted_message, sizeof(formatted_message), format, args);
     va_end(args);
     message.formatted_message = formatted_message;
-    
-    for (int i = 0; i < handler_count; i++) {
-        if (handlers[i].active && level >= handlers[i].min_level) {
-            handlers[i].handler(&message, handlers[i].user_data);
+
+    handler_entry active[MAX_LOG_HANDLERS];
+    pthread_mutex_lock(&handlers_lock);
+    int count = handler_count;
+    memcpy(active, handlers, count * sizeof(handler_entry));
+    pthread_mutex_unlock(&handlers_lock);
+
+    for (int i = 0; i < count; i++) {
+        if (active[i].active && level >= active[i].min_level) {
+            active[i].handler(&message, active[i].user_data);
         }
     }
 }
 
-bool register_log_handler(log_handler_fn handler, void* user_data, log_level min_level) {
-    if (!handler || handler_count >= MAX_LOG_HANDLERS) {
-        return false;
-    }
-    
+static bool add_handler_locked(log_handler_fn handler, void* user_data, log_level min_level) {
     for (int i = 0; i < handler_count; i++) {
         if (handlers[i].handler == handler) {
             handlers[i].user_data = user_data;
@@ -123,37 +139,58 @@ bool register_log_handler(log_handler_fn handler, void* user_data, log_level min
             return true;
         }
     }
-    
+
+    if (handler_count >= MAX_LOG_HANDLERS) {
+        return false;
+    }
+
     handlers[handler_count].handler = handler;
     handlers[handler_count].user_data = user_data;
     handlers[handler_count].min_level = min_level;
     handlers[handler_count].active = true;
     handler_count++;
-    
     return true;
 }
 
+bool register_log_handler(log_handler_fn handler, void* user_data, log_level min_level) {
+    if (!handler) {
+        return false;
+    }
+
+    pthread_mutex_lock(&handlers_lock);
+    bool added = add_handler_locked(handler, user_data, min_level);
+    pthread_mutex_unlock(&handlers_lock);
+
+    return added;
+}
+
 bool unregister_log_handler(log_handler_fn handler) {
     if (!handler) {
         return false;
     }
     
+    bool found = false;
+    pthread_mutex_lock(&handlers_lock);
     for (int i = 0; i < handler_count; i++) {
         if (handlers[i].handler == handler) {
             handlers[i].active = false;
-            return true;
+            found = true;
+            break;
         }
     }
-    
-    return false;
+    pthread_mutex_unlock(&handlers_lock);
+
+    return found;
 }
 
 void clear_log_handlers(void) {
+    pthread_mutex_lock(&handlers_lock);
     for (int i = 0; i < handler_count; i++) {
         handlers[i].active = false;
     }
     handler_count = 0;
     default_handler_registered = false;
+    pthread_mutex_unlock(&handlers_lock);
 }
 
 void set_log_level(log_level level) {
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include <math.h>
+#include <unistd.h>
+#include <strings.h>
 
 #include "logger.h"
 #include "ttf.h"
@@ -9,37 +11,1013 @@
 #include "glyph.h"
 #include "head.h"
 #include "loca.h"
+#include "instance.h"
+#include "ttc.h"
+#include "validate.h"
+#include "font.h"
+#include "pool.h"
+#include "pipeline.h"
+#include "lcd.h"
+#include "glyph_cache.h"
+#include "simplify.h"
+#include "hittest.h"
+#include "export.h"
+#include "subset.h"
+#include "compose.h"
+#include "hint.h"
+#include "registry.h"
+#include "fallback.h"
+#include "catalog.h"
 
 void log_setup() {
     print_time_in_log = true;
     print_where_in_log = true;
 }
 
+// the caller frees the code points
+static uint32_t* decode_utf8(const char *text, uint32_t *count) {
+    uint32_t *codepoints = malloc((strlen(text) + 1) * sizeof(uint32_t));
+    if (!codepoints) {
+        elog("out of memory");
+    }
+    *count = 0;
+    for (const uint8_t *p = (const uint8_t*)text; *p;) {
+        uint32_t extra = *p >= 0xF0 ? 3 : *p >= 0xE0 ? 2 : *p >= 0xC0 ? 1 : 0;
+        uint32_t codepoint = *p++ & (0x7F >> extra);
+        for (; extra > 0 && (*p & 0xC0) == 0x80; extra--) {
+            codepoint = codepoint << 6 | (*p++ & 0x3F);
+        }
+        codepoints[(*count)++] = codepoint;
+    }
+    return codepoints;
+}
+
+#define STRESS_LOOKUPS 200000
+
+typedef struct stress_state {
+    ttf_font *font;
+    uint32_t *checksums;
+    atomic_uint mismatches;
+} stress_state;
+
+static uint32_t glyph_checksum(const glyph_t *glyph) {
+    if (!glyph) {
+        return 0;
+    }
+    uint32_t sum = glyph->count;
+    for (uint16_t i = 0; i < glyph->count; i++) {
+        sum = sum * 31 + (uint16_t)glyph->x_poss[i];
+        sum = sum * 31 + (uint16_t)glyph->y_poss[i];
+    }
+    return sum;
+}
+
+static void stress_range(uint32_t begin, uint32_t end, void *arg) {
+    stress_state *state = arg;
+    for (uint32_t worker = begin; worker < end; worker++) {
+        uint32_t seed = worker * 2654435761u + 1;
+        for (uint32_t i = 0; i < STRESS_LOOKUPS; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            uint16_t index = (seed >> 8) % state->font->glyph_count;
+            if (glyph_checksum(get_font_glyph(state->font, index)) != state->checksums[index]) {
+                atomic_fetch_add(&state->mismatches, 1);
+            }
+        }
+        dlog("stress worker %u done", worker);
+    }
+}
+
+// hammers one shared font from many threads and checks every lookup against a serial decode
+static int run_stress(const char *path, uint32_t threads) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+
+    stress_state state = { .font = &font };
+    atomic_init(&state.mismatches, 0);
+    state.checksums = malloc(font.glyph_count * sizeof(uint32_t));
+    for (uint16_t i = 0; i < font.glyph_count; i++) {
+        uint32_t offset = font.locations[i];
+        glyph_t *glyph = NULL;
+        load_glyph(&font.source, offset, font.locations[i + 1] - offset, &glyph, NULL);
+        state.checksums[i] = glyph_checksum(glyph);
+        free_glyph(glyph);
+    }
+
+    thread_pool pool;
+    if (init_thread_pool(&pool, threads)) {
+        elog("cannot start %u threads", threads);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parallel_for(&pool, 0, pool.worker_count, 1, stress_range, &state);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    uint32_t mismatches = atomic_load(&state.mismatches);
+    ilog("stress : %u threads, %u lookups in %.3f s, %u mismatches", pool.worker_count,
+         pool.worker_count * STRESS_LOOKUPS, elapsed, mismatches);
+
+    free_thread_pool(&pool);
+    free(state.checksums);
+    free_font(&font);
+    return mismatches ? 1 : 0;
+}
+
+// loads every face of a collection, or a plain font as a collection of one, and decodes
+// each face's outlines in parallel; faces sharing glyf/loca decode them only once
+static int run_faces(const char *path, uint32_t threads) {
+    ttc_collection collection;
+    ttf_error error = {0};
+    if (load_ttc_collection(&collection, path, &error)) {
+        elog("%s", error.message);
+    }
+
+    thread_pool pool;
+    if (init_thread_pool(&pool, threads)) {
+        elog("cannot start %u threads", threads);
+    }
+
+    for (uint32_t f = 0; f < collection.face_count; f++) {
+        ttc_glyph_store *store = collection.faces[f].store;
+        if (!store) {
+            ilog("faces : face %u has no glyf outlines", f);
+            continue;
+        }
+        uint32_t cached = 0;
+        for (uint32_t g = 0; g < store->glyph_count; g++) {
+            cached += store->outlines[g] != NULL;
+        }
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        preload_face(&collection, f, &pool);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        uint32_t decoded = 0;
+        for (uint32_t g = 0; g < store->glyph_count; g++) {
+            decoded += store->outlines[g] != NULL;
+        }
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+        ilog("faces : face %u, %u glyphs, %u decoded, %u already shared, in %.3f ms", f, store->glyph_count,
+             decoded, cached, elapsed * 1e3);
+    }
+    ilog("faces : %u faces over %u glyph stores with %u threads", collection.face_count, collection.store_count,
+         pool.worker_count);
+
+    free_thread_pool(&pool);
+    free_ttc_collection(&collection);
+    return 0;
+}
+
+// varies every outline of a variable font at one weight in parallel, the default
+// instance when the font has no wght axis
+static int run_instance(const char *path, float weight, uint32_t threads) {
+    ttf_source source = {0};
+    if (load_ttf_source(&source, path) || select_ttf_face(&source, 0)) {
+        elog("error maping file , path '%s'", path);
+    }
+    ttf_validation validation = {0};
+    if (validate_ttf_source(&source, &validation)) {
+        elog("rejected font '%s' : %s", path, validation.reason);
+    }
+
+    ttf_instance_cache instances;
+    ttf_error error = {0};
+    if (init_instance_cache(&instances, &source, &error)) {
+        elog("%s", error.message);
+    }
+    float coords[TTF_MAX_AXES] = {0};
+    for (uint16_t i = 0; i < instances.fvar.axis_count; i++) {
+        coords[i] = instances.fvar.axes[i].def;
+    }
+    int wght = find_axis(&instances.fvar, "wght");
+    if (wght >= 0) {
+        coords[wght] = weight;
+    }
+
+    thread_pool pool;
+    if (init_thread_pool(&pool, threads)) {
+        elog("cannot start %u threads", threads);
+    }
+
+    ttf_instance *instance;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (get_instance(&instances, coords, &instance, &error) || preload_instance(&instances, instance, &pool, &error)) {
+        elog("%s", error.message);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    uint32_t varied = 0;
+    for (uint16_t g = 0; g < instances.glyph_count; g++) {
+        varied += instance->glyphs[g] != NULL;
+    }
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    ilog("instance : wght %.0f, %u of %u glyphs varied with %u threads in %.3f ms", wght >= 0 ? coords[wght] : 0.0f,
+         varied, instances.glyph_count, pool.worker_count, elapsed * 1e3);
+
+    free_thread_pool(&pool);
+    free_instance_cache(&instances);
+    unload_ttf_source(&source);
+    return 0;
+}
+
+typedef struct pipeline_totals {
+    atomic_uint_fast64_t glyphs;
+    atomic_uint_fast64_t pixels;
+} pipeline_totals;
+
+static void count_bitmap(const render_job *job, void *user) {
+    pipeline_totals *totals = user;
+    if (job->status == TTF_OK) {
+        atomic_fetch_add(&totals->glyphs, 1);
+        atomic_fetch_add(&totals->pixels, (uint64_t)job->bitmap.width * job->bitmap.height);
+    }
+}
+
+// renders every glyph of the font through the staged pipeline and reports per-stage counters
+static int run_pipeline(const char *path, float ppem, uint32_t threads, raster_mode mode, const raster_tone *tone, float simplify) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+    if (threads == 0) {
+        threads = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    pipeline_totals totals = {0};
+    pipeline_config config;
+    default_pipeline_config(&config, threads);
+    config.mode = mode;
+    config.tone = tone;
+    config.simplify = simplify;
+    render_pipeline pipeline;
+    if (start_pipeline(&pipeline, &font, &config, count_bitmap, &totals)) {
+        elog("cannot start render pipeline");
+    }
+
+    uint16_t *glyphs = malloc(font.glyph_count * sizeof(uint16_t));
+    if (!glyphs) {
+        elog("out of memory");
+    }
+    for (uint16_t i = 0; i < font.glyph_count; i++) {
+        glyphs[i] = i;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ttf_status submitted = pipeline_submit(&pipeline, glyphs, font.glyph_count, ppem);
+    finish_pipeline(&pipeline);
+    if (submitted) {
+        elog("out of memory submitting glyphs");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    ilog("pipeline : %lu glyphs, %lu pixels at %.1f ppem in %.3f s", (unsigned long)totals.glyphs,
+         (unsigned long)totals.pixels, ppem, elapsed);
+    for (uint32_t s = 0; s < STAGE_COUNT; s++) {
+        stage_counters *counters = &pipeline.counters[s];
+        ilog("  %-8s x%u : %lu items in %lu batches, busy %.3f ms, stalled %.3f ms, starved %.3f ms",
+             pipeline_stage_name(s), config.workers[s], (unsigned long)counters->items,
+             (unsigned long)counters->batches, counters->busy_ns * 1e-6,
+             counters->stall_ns * 1e-6, counters->starve_ns * 1e-6);
+    }
+
+    free(glyphs);
+    free_font(&font);
+    return 0;
+}
+
+// with hint the font's instructions grid-fit the glyph at the ppem rounded to whole pixels,
+// a simplify tolerance in pixels drops detail the size cannot show
+static void flatten_char(ttf_font *font, uint32_t unicode, float ppem, bool hint, float simplify, raster_mode mode, const raster_tone *tone, raster_path *raster) {
+    uint16_t index = font_glyph_index(font, unicode);
+    const glyph_t *glyph = get_font_glyph(font, index);
+    if (!glyph) {
+        elog("no outline for U+%04X", unicode);
+    }
+    float size = ppem;
+    uint32_t units_per_em = get_units_per_em(font->head);
+
+    ttf_hinter hinter;
+    if (hint) {
+        ttf_error error = {0};
+        if (init_hinter(&hinter, font, &error)) {
+            elog("%s", error.message);
+        }
+        size = lroundf(ppem);
+        const hinted_glyph *hinted = get_hinted_glyph(&hinter, index, (uint16_t)size);
+        if (!hinted) {
+            elog("no hinted outline for U+%04X at %.0f ppem", unicode, size);
+        }
+        glyph = &hinted->outline;
+        units_per_em = (uint32_t)size * HINT_UNITS_PER_PIXEL;
+    }
+
+    glyph_t *simple = NULL;
+    if (simplify > 0.0f && size <= SIMPLIFY_MAX_PPEM) {
+        simple = simplify_glyph(glyph, simplify * units_per_em / size);
+        if (simple) {
+            ilog("simplify : %u -> %u points, %d -> %d contours", glyph->count, simple->count,
+                 glyph->numberOfContours, simple->numberOfContours);
+            glyph = simple;
+        }
+    }
+    if (flatten_glyph_at(glyph, size, units_per_em, 0.0f, mode, tone, raster)) {
+        elog("out of memory");
+    }
+
+    free_glyph(simple);
+    if (hint) {
+        free_hinter(&hinter);
+    }
+}
+
+static int write_pgm_band(const uint8_t *pixels, uint32_t y, uint32_t rows, uint32_t width, void *user) {
+    (void)y;
+    return fwrite(pixels, width, rows, (FILE*)user) == rows ? 0 : -1;
+}
+
+// streams one glyph as a binary PGM band by band, the full bitmap is never held in memory
+static int run_pgm(const char *path, uint32_t unicode, float ppem, const char *out, uint32_t threads, raster_mode mode, const raster_tone *tone, bool hint, float simplify) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+
+    raster_path raster = {0};
+    flatten_char(&font, unicode, ppem, hint, simplify, mode, tone, &raster);
+
+    FILE *file = fopen(out, "wb");
+    if (!file) {
+        elog("cannot open '%s'", out);
+    }
+    fprintf(file, "P5\n%u %u\n255\n", raster.width, raster.height);
+
+    thread_pool pool;
+    if (init_thread_pool(&pool, threads)) {
+        elog("cannot start %u threads", threads);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = render_path_banded(&raster, RASTER_BAND_HEIGHT, &pool, write_pgm_band, file);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    if (result) {
+        elog("cannot render or write '%s'", out);
+    }
+    ilog("pgm : %ux%u, %u lines, %u threads in %.3f s -> %s", raster.width, raster.height,
+         raster.count, pool.worker_count, elapsed, out);
+
+    free_thread_pool(&pool);
+    fclose(file);
+    free_raster_path(&raster);
+    free_font(&font);
+    return result ? 1 : 0;
+}
+
+// renders one glyph with LCD subpixel filtering into a binary PPM
+static int run_lcd(const char *path, uint32_t unicode, float ppem, const char *out, float gamma, raster_mode mode, const raster_tone *tone, bool hint, float simplify) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+
+    lcd_filter filter;
+    init_lcd_filter(&filter, NULL, gamma);
+    raster_path raster = {0};
+    raster_canvas canvas;
+    raster_bitmap bitmap;
+    init_raster_canvas(&canvas);
+    flatten_char(&font, unicode, ppem, hint, simplify, mode, tone, &raster);
+    if (render_path_lcd(&raster, &canvas, &filter, &bitmap)) {
+        elog("out of memory");
+    }
+
+    FILE *file = fopen(out, "wb");
+    if (!file) {
+        elog("cannot open '%s'", out);
+    }
+    // coverage is drawn black on white the way text is
+    fprintf(file, "P6\n%u %u\n255\n", bitmap.width, bitmap.height);
+    for (size_t i = 0; i < (size_t)bitmap.width * bitmap.height * 3; i++) {
+        fputc(255 - bitmap.pixels[i], file);
+    }
+    ilog("lcd : %ux%u, gamma %.2f -> %s", bitmap.width, bitmap.height, gamma, out);
+
+    fclose(file);
+    free_raster_bitmap(&bitmap);
+    free_raster_canvas(&canvas);
+    free_raster_path(&raster);
+    free_font(&font);
+    return 0;
+}
+
+// the text's ink extents in font units, read from the glyph headers without decoding an outline
+static void measure_text_ink(ttf_font *font, const char *text, size_t length, int16_t *top, int16_t *bottom) {
+    *top = *bottom = 0;
+    if (length == 0) {
+        return;
+    }
+
+    uint16_t *indices = malloc(length * sizeof(uint16_t));
+    uint16_t *counts = malloc(length * sizeof(uint16_t));
+    int16_t *columns = malloc(length * 5 * sizeof(int16_t));
+    if (!indices || !counts || !columns) {
+        elog("out of memory");
+    }
+    for (size_t i = 0; i < length; i++) {
+        indices[i] = font_glyph_index(font, (uint8_t)text[i]);
+    }
+
+    glyph_metrics_batch batch = { columns, columns + length, columns + 2 * length, columns + 3 * length, columns + 4 * length, counts };
+    ttf_error error = {0};
+    if (load_glyph_metrics_batch(&font->source, font->head, indices, (uint32_t)length, &batch, &error)) {
+        elog("%s", error.message);
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (batch.numberOfContours[i] != 0) {
+            *top = batch.yMax[i] > *top ? batch.yMax[i] : *top;
+            *bottom = batch.yMin[i] < *bottom ? batch.yMin[i] : *bottom;
+        }
+    }
+
+    free(indices);
+    free(counts);
+    free(columns);
+}
+
+// fills a page by repeating the text, glyphs come from the bitmap cache and are composed
+// black on white into RGBA, then written as a PPM. The glyphs placed so far are composed
+// whenever the cache has no unpinned page left, so their atlas pixels are never evicted.
+static int run_text(const char *path, float ppem, const char *text, const char *out, uint32_t threads, raster_mode mode, const raster_tone *tone, float simplify) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+
+    const uint32_t width = 1024, height = 768, margin = 16;
+    compose_target target = { malloc((size_t)width * height * 4), width, height, width * 4, COMPOSE_RGBA8 };
+    if (!target.pixels) {
+        elog("out of memory");
+    }
+    memset(target.pixels, 255, (size_t)width * height * 4);
+
+    simplify_cache simple;
+    init_simplify_cache(&simple, &font, simplify);
+    glyph_cache cache;
+    if (init_glyph_cache(&cache, 4 << 20, 4, mode, tone, simplify > 0.0f ? &simple : NULL)) {
+        elog("out of memory");
+    }
+    float scale = ppem / get_units_per_em(font.head);
+    int16_t ascender = (int16_t)ntohs(font.hhea->ascender);
+    float line_height = (ascender - (int16_t)ntohs(font.hhea->descender) + (int16_t)ntohs(font.hhea->lineGap)) * scale;
+    uint32_t capacity = 1024, count = 0, composed = 0, batches = 0;
+    placed_glyph *glyphs = malloc(capacity * sizeof(placed_glyph));
+    if (!glyphs) {
+        elog("out of memory");
+    }
+
+    thread_pool pool;
+    if (init_thread_pool(&pool, threads)) {
+        elog("cannot start %u threads", threads);
+    }
+    const compose_color ink = { 0, 0, 0, 255 };
+    double elapsed = 0.0;
+    struct timespec start, end;
+
+    // the first baseline drops below the ascender when the text's ink reaches above it
+    size_t length = strlen(text);
+    int16_t ink_top, ink_bottom;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    measure_text_ink(&font, text, length, &ink_top, &ink_bottom);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ilog("text : ink from %.1f to %.1f px around the baseline, %zu glyphs measured in %.3f ms", ink_bottom * scale,
+         ink_top * scale, length, ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) * 1e3);
+
+    glyph_cache_begin_frame(&cache);
+    float pen_x = margin, baseline = margin + (ink_top > ascender ? ink_top : ascender) * scale;
+    for (size_t i = 0; length > 0 && baseline < height; i = (i + 1) % length) {
+        uint16_t index = font_glyph_index(&font, (uint8_t)text[i]);
+        float advance = font_advance_width(&font, index) * scale;
+        if (pen_x + advance > width - margin) {
+            pen_x = margin;
+            baseline += line_height;
+        }
+        const cached_glyph *bitmap;
+        if (glyph_cache_get(&cache, &font, index, ppem, pen_x, &bitmap)) {
+            elog("out of memory");
+        }
+        if (!bitmap && cache.frame_full) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (compose_glyphs(&target, glyphs, count, ink, &pool)) {
+                elog("out of memory");
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            elapsed += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+            composed += count;
+            batches++;
+            count = 0;
+            glyph_cache_begin_frame(&cache);
+            if (glyph_cache_get(&cache, &font, index, ppem, pen_x, &bitmap)) {
+                elog("out of memory");
+            }
+        }
+        if (bitmap && bitmap->width > 0) {
+            if (count == capacity) {
+                capacity *= 2;
+                glyphs = realloc(glyphs, capacity * sizeof(placed_glyph));
+                if (!glyphs) {
+                    elog("out of memory");
+                }
+            }
+            glyphs[count++] = (placed_glyph){
+                bitmap->pixels, bitmap->stride, bitmap->width, bitmap->height,
+                (int32_t)floorf(pen_x) + bitmap->left, (int32_t)lroundf(baseline) - bitmap->top
+            };
+        }
+        pen_x += advance;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (compose_glyphs(&target, glyphs, count, ink, &pool)) {
+        elog("out of memory");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    composed += count;
+    batches++;
+
+    ilog("text : %u glyphs composed in %u batches with %u threads in %.3f ms, cache %lu hits %lu misses %lu evictions",
+         composed, batches, pool.worker_count, elapsed * 1e3, (unsigned long)cache.stats.hits,
+         (unsigned long)cache.stats.misses, (unsigned long)cache.stats.evictions);
+
+    FILE *file = fopen(out, "wb");
+    if (!file) {
+        elog("cannot open '%s'", out);
+    }
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        fwrite(target.pixels + i * 4, 1, 3, file);
+    }
+
+    fclose(file);
+    free_thread_pool(&pool);
+    free(glyphs);
+    free_glyph_cache(&cache);
+    free_simplify_cache(&simple);
+    free(target.pixels);
+    free_font(&font);
+    return 0;
+}
+
+// writes every outline of the font as JSON or an SVG glyph sheet without opening a window
+static int run_export(const char *path, const char *format, const char *out, uint32_t threads) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+    export_format export = strcmp(format, "svg") == 0 ? EXPORT_SVG : EXPORT_JSON;
+
+    FILE *file = fopen(out, "wb");
+    if (!file) {
+        elog("cannot open '%s'", out);
+    }
+    thread_pool pool;
+    if (init_thread_pool(&pool, threads)) {
+        elog("cannot start %u threads", threads);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ttf_status status = export_font_outlines(&font, export, &pool, file, &error);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (status) {
+        elog("%s", error.message);
+    }
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    ilog("export : %u glyphs as %s with %u threads in %.3f ms -> %s", font.glyph_count,
+         export == EXPORT_SVG ? "svg" : "json", pool.worker_count, elapsed * 1e3, out);
+
+    free_thread_pool(&pool);
+    fclose(file);
+    free_font(&font);
+    return 0;
+}
+
+// keeps the glyphs for the characters of a UTF-8 string and writes them as a new TTF
+static int run_subset(const char *path, const char *text, const char *out) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+
+    uint32_t count;
+    uint32_t *codepoints = decode_utf8(text, &count);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ttf_subset subset;
+    if (build_font_subset(&font, codepoints, count, &subset, &error)) {
+        elog("%s", error.message);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    FILE *file = fopen(out, "wb");
+    if (!file || fwrite(subset.data, 1, subset.size, file) != subset.size) {
+        elog("cannot write '%s'", out);
+    }
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    ilog("subset : %u codepoints, %u of %u glyphs, %lu -> %lu bytes in %.3f ms -> %s", subset.codepoint_count,
+         subset.glyph_count, font.glyph_count, (unsigned long)font.source.size, (unsigned long)subset.size,
+         elapsed * 1e3, out);
+
+    fclose(file);
+    free_font_subset(&subset);
+    free(codepoints);
+    free_font(&font);
+    return 0;
+}
+
+// Scans a directory without mapping anything, then looks the text up in every face of
+// the family through the registry, so faces get mapped on first use and evicted again
+// once they go over the budget. The text is then resolved twice through a fallback
+// chain of the family's regular face followed by every other font, the second pass
+// coming entirely from the chain's memo.
+static int run_registry(const char *dir, const char *family, const char *text, size_t budget) {
+    font_registry registry = { .budget = budget };
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (registry_scan(&registry, dir)) {
+        elog("cannot scan '%s'", dir);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    ilog("registry : %lu fonts in '%s' scanned in %.3f ms, budget %lu bytes", (unsigned long)registry.count, dir,
+         elapsed * 1e3, (unsigned long)registry.budget);
+
+    uint32_t count;
+    uint32_t *codepoints = decode_utf8(text, &count);
+
+    uint32_t faces = 0;
+    for (size_t i = 0; i < registry.count; i++) {
+        font_entry *entry = &registry.entries[i];
+        if (strcasecmp(entry->family, family) != 0) {
+            continue;
+        }
+        uint32_t covered = 0, located = 0;
+        for (uint32_t c = 0; c < count; c++) {
+            uint32_t glyph_offset, glyph_length;
+            uint16_t index = registry_glyph_index(&registry, entry, codepoints[c]);
+            covered += index != 0;
+            located += index != 0 && !registry_glyph_location(&registry, entry, index, &glyph_offset, &glyph_length);
+        }
+        faces++;
+        ilog("registry : %s %s (%u%s) covers %u of %u codepoints, %u located%s", entry->family, entry->style,
+             entry->weight, entry->italic ? " italic" : "", covered, count, located, entry->rejected ? ", rejected" : "");
+    }
+    if (faces == 0) {
+        wlog("registry : no font of family '%s'", family);
+    }
+
+    font_entry *primary = registry_find(&registry, family, 400, false);
+    font_entry **members = malloc((registry.count + 1) * sizeof(font_entry*));
+    ttf_source **sources = malloc((registry.count + 1) * sizeof(ttf_source*));
+    if (!members || !sources) {
+        elog("out of memory");
+    }
+    uint16_t member_count = 0;
+    for (size_t i = 0; i <= registry.count; i++) {
+        font_entry *entry = i == 0 ? primary : &registry.entries[i - 1];
+        if (!entry || (i > 0 && entry == primary)) {
+            continue;
+        }
+        ttf_source *source = registry_acquire(&registry, entry);
+        if (source) {
+            members[member_count] = entry;
+            sources[member_count++] = source;
+        }
+    }
+
+    ttf_error error = {0};
+    font_chain chain;
+    if (init_font_chain(&chain, sources, member_count, &error)) {
+        elog("%s", error.message);
+    }
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        for (uint32_t c = 0; c < count; c++) {
+            uint64_t misses = chain.misses;
+            glyph_ref ref = resolve_glyph(&chain, codepoints[c]);
+            if (chain.misses != misses) {
+                font_entry *entry = members[ref.font];
+                ilog("fallback : U+%04X -> %s %s glyph %u%s", codepoints[c], entry->family, entry->style, ref.glyph,
+                     ref.glyph ? "" : " (notdef)");
+            }
+        }
+    }
+    ilog("fallback : %u fonts in chain, %lu resolutions, %lu memo hits, %lu distinct codepoints", member_count,
+         (unsigned long)(chain.hits + chain.misses), (unsigned long)chain.hits, (unsigned long)chain.count);
+
+    free_font_chain(&chain);
+    for (uint16_t f = 0; f < member_count; f++) {
+        registry_release(&registry, members[f]);
+    }
+    free(members);
+    free(sources);
+
+    uint32_t mapped = 0;
+    for (size_t i = 0; i < registry.count; i++) {
+        mapped += registry.entries[i].mapped;
+    }
+    ilog("registry : %u of %lu fonts mapped, %lu bytes, %lu evictions", mapped, (unsigned long)registry.count,
+         (unsigned long)registry.mapped_bytes, (unsigned long)registry.evictions);
+
+    free(codepoints);
+    free_registry(&registry);
+    return 0;
+}
+
+#define CATALOG_MAX_RESULTS 8
+
+// Rebuilds the on-disk index of a directory, reopening only new or changed files, then
+// answers from the index alone which fonts cover each character of the text.
+static int run_catalog(const char *dir, const char *index_path, const char *text, const char *family) {
+    struct timespec start, end;
+    size_t reparsed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (build_catalog(index_path, dir, &reparsed)) {
+        elog("cannot build the index '%s' of '%s'", index_path, dir);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    catalog cat;
+    if (open_catalog(&cat, index_path)) {
+        elog("cannot open the index '%s'", index_path);
+    }
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    ilog("catalog : %u records, %lu reparsed, %u coverage pages in %.3f ms -> %s", cat.header->record_count,
+         (unsigned long)reparsed, cat.header->page_count, elapsed * 1e3, index_path);
+
+    uint32_t count;
+    uint32_t *codepoints = decode_utf8(text, &count);
+    for (uint32_t c = 0; c < count; c++) {
+        const catalog_record *results[CATALOG_MAX_RESULTS];
+        size_t found = catalog_find_covering(&cat, family, codepoints[c], results, CATALOG_MAX_RESULTS);
+        if (found == 0) {
+            wlog("catalog : U+%04X is not covered", codepoints[c]);
+        }
+        for (size_t r = 0; r < found; r++) {
+            ilog("catalog : U+%04X -> %s %s (%s)", codepoints[c], catalog_string(&cat, results[r]->family),
+                 catalog_string(&cat, results[r]->style), catalog_string(&cat, results[r]->path));
+        }
+    }
+
+    free(codepoints);
+    close_catalog(&cat);
+    return 0;
+}
+
+#define GOLDEN_TEXT "agR8&W"
+#define GOLDEN_BAND_HEIGHT 4
+#define GOLDEN_LINE_SIZE 96
+
+static const float golden_sizes[] = { 9.0f, 16.0f, 32.0f, 64.0f };
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t bitmap_hash(const raster_bitmap *bitmap) {
+    uint64_t hash = fnv1a(0xCBF29CE484222325ull, &bitmap->width, sizeof(bitmap->width));
+    hash = fnv1a(hash, &bitmap->height, sizeof(bitmap->height));
+    return fnv1a(hash, bitmap->pixels, (size_t)bitmap->width * bitmap->height);
+}
+
+// Renders GOLDEN_TEXT on the F26.6 path at every golden size, both in one pass and in
+// thin parallel bands, and compares the checksums with the golden file. The two
+// passes must agree with each other too. --update rewrites the file.
+static int run_golden(const char *path, const char *golden, bool update) {
+    ttf_font font;
+    ttf_error error = {0};
+    if (load_font(&font, path, 0, &error)) {
+        elog("%s", error.message);
+    }
+    thread_pool pool;
+    if (init_thread_pool(&pool, 0)) {
+        elog("cannot start the thread pool");
+    }
+
+    uint32_t sizes = sizeof(golden_sizes) / sizeof(golden_sizes[0]);
+    uint32_t count = (uint32_t)strlen(GOLDEN_TEXT) * sizes;
+    char (*lines)[GOLDEN_LINE_SIZE] = calloc(count, GOLDEN_LINE_SIZE);
+    if (!lines) {
+        elog("out of memory");
+    }
+
+    uint32_t failures = 0, line = 0;
+    raster_canvas canvas;
+    init_raster_canvas(&canvas);
+    for (const char *c = GOLDEN_TEXT; *c; c++) {
+        for (uint32_t s = 0; s < sizes; s++, line++) {
+            raster_path raster = {0};
+            raster_bitmap whole, banded;
+            flatten_char(&font, (uint32_t)*c, golden_sizes[s], false, 0.0f, RASTER_FIXED, NULL, &raster);
+            if (render_path(&raster, &canvas, &whole) || render_path_tiled(&raster, GOLDEN_BAND_HEIGHT, &pool, &banded)) {
+                elog("out of memory");
+            }
+            uint64_t hash = bitmap_hash(&whole);
+            if (bitmap_hash(&banded) != hash) {
+                wlog("U+%04X at %.0f ppem : banded render differs from the single pass", *c, golden_sizes[s]);
+                failures++;
+            }
+            snprintf(lines[line], GOLDEN_LINE_SIZE, "U+%04X %.0f %ux%u %016llx", *c, golden_sizes[s],
+                     whole.width, whole.height, (unsigned long long)hash);
+            free_raster_bitmap(&whole);
+            free_raster_bitmap(&banded);
+            free_raster_path(&raster);
+        }
+    }
+    free_raster_canvas(&canvas);
+    free_thread_pool(&pool);
+    free_font(&font);
+
+    FILE *file = fopen(golden, update ? "w" : "r");
+    if (!file) {
+        elog("cannot open '%s'", golden);
+    }
+    if (update) {
+        for (uint32_t i = 0; i < count; i++) {
+            fprintf(file, "%s\n", lines[i]);
+        }
+        ilog("golden : wrote %u checksums to %s", count, golden);
+    } else {
+        char expected[GOLDEN_LINE_SIZE];
+        for (uint32_t i = 0; i < count; i++) {
+            if (!fgets(expected, sizeof(expected), file)) {
+                expected[0] = '\0';
+            }
+            expected[strcspn(expected, "\n")] = '\0';
+            if (strcmp(expected, lines[i]) != 0) {
+                wlog("golden mismatch : expected '%s', got '%s'", expected, lines[i]);
+                failures++;
+            }
+        }
+        ilog("golden : %u checksums, %u failures against %s", count, failures, golden);
+    }
+    fclose(file);
+    free(lines);
+    return failures ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
-    (void) argc;
     log_setup();
     dlog("TTF Font : %s", argv[1]);
 
+    // <font> --stress [threads] exercises the shared read path without opening a window
+    if (argc > 2 && strcmp(argv[2], "--stress") == 0) {
+        return run_stress(argv[1], argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 0);
+    }
+    // <font> --faces [threads] loads every face of a collection over shared glyph stores
+    if (argc > 2 && strcmp(argv[2], "--faces") == 0) {
+        return run_faces(argv[1], argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 0);
+    }
+    if (argc > 3 && strcmp(argv[2], "--instance") == 0) {
+        return run_instance(argv[1], strtof(argv[3], NULL), argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 10) : 0);
+    }
+    // trailing --fixed switches the raster modes to the F26.6 path, --darken adds
+    // gamma, stem darkening and small-size emboldening, --hint runs the font's
+    // TrueType instructions for the single glyph modes, --simplify drops outline
+    // detail below SIMPLIFY_MAX_PPEM
+    raster_mode mode = RASTER_FLOAT;
+    raster_tone darken;
+    const raster_tone *tone = NULL;
+    bool hint = false;
+    float simplify = 0.0f;
+    for (; argc > 2; argc--) {
+        if (strcmp(argv[argc - 1], "--fixed") == 0) {
+            mode = RASTER_FIXED;
+        } else if (strcmp(argv[argc - 1], "--hint") == 0) {
+            hint = true;
+        } else if (strcmp(argv[argc - 1], "--simplify") == 0) {
+            simplify = SIMPLIFY_TOLERANCE;
+        } else if (strcmp(argv[argc - 1], "--darken") == 0) {
+            init_raster_tone(&darken, 1.4f, 0.3f, true);
+            tone = &darken;
+        } else {
+            break;
+        }
+    }
+
+    if (argc > 5 && strcmp(argv[2], "--pgm") == 0) {
+        return run_pgm(argv[1], (uint32_t)*argv[3], strtof(argv[4], NULL), argv[5],
+                       argc > 6 ? (uint32_t)strtoul(argv[6], NULL, 10) : 0, mode, tone, hint, simplify);
+    }
+    if (argc > 5 && strcmp(argv[2], "--lcd") == 0) {
+        return run_lcd(argv[1], (uint32_t)*argv[3], strtof(argv[4], NULL), argv[5],
+                       argc > 6 ? strtof(argv[6], NULL) : 1.0f, mode, tone, hint, simplify);
+    }
+    if (argc > 5 && strcmp(argv[2], "--text") == 0) {
+        return run_text(argv[1], strtof(argv[3], NULL), argv[4], argv[5],
+                        argc > 6 ? (uint32_t)strtoul(argv[6], NULL, 10) : 0, mode, tone, simplify);
+    }
+    if (argc > 4 && strcmp(argv[2], "--subset") == 0) {
+        return run_subset(argv[1], argv[3], argv[4]);
+    }
+    if (argc > 4 && strcmp(argv[2], "--export") == 0) {
+        return run_export(argv[1], argv[3], argv[4], argc > 5 ? (uint32_t)strtoul(argv[5], NULL, 10) : 0);
+    }
+    if (argc > 4 && strcmp(argv[2], "--registry") == 0) {
+        return run_registry(argv[1], argv[3], argv[4], argc > 5 ? (size_t)strtoull(argv[5], NULL, 10) : 0);
+    }
+    if (argc > 4 && strcmp(argv[2], "--catalog") == 0) {
+        return run_catalog(argv[1], argv[3], argv[4], argc > 5 ? argv[5] : NULL);
+    }
+    if (argc > 3 && strcmp(argv[2], "--golden") == 0) {
+        return run_golden(argv[1], argv[3], argc > 4 && strcmp(argv[4], "--update") == 0);
+    }
+    if (argc > 3 && strcmp(argv[2], "--pipeline") == 0) {
+        return run_pipeline(argv[1], strtof(argv[3], NULL), argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 10) : 0, mode, tone, simplify);
+    }
+
     ttf_source source = {0};
-    if (load_ttf_source(&source, argv[1])) {
+    ttf_load_options load_options = { .advice = TTF_ADVISE_RANDOM, .measure_faults = true };
+    ttf_load_stats load_stats = {0};
+    if (load_ttf_source_ex(&source, argv[1], &load_options, &load_stats)) {
         elog("error maping file , path '%s'", argv[1]);
     }   
+    dlog("Loaded in %lu ns, first touch %lu ns (%ld minor, %ld major faults)",
+         (unsigned long)load_stats.load_ns, (unsigned long)load_stats.first_touch_ns,
+         load_stats.minor_faults, load_stats.major_faults);
+
+    // collections open on their first face
+    if (select_ttf_face(&source, 0)) {
+        elog("no usable face in '%s'", argv[1]);
+    }
+
+    ttf_validation validation = {0};
+    if (validate_ttf_source(&source, &validation)) {
+        elog("rejected font '%s' : %s (table '%s', glyph %u)", argv[1], validation.reason,
+             validation.table ? validation.table : "-", validation.glyph);
+    }
 
-    uint16_t index = get_glyph_index(&source, (uint32_t)*((char*)argv[2]));
-    head_table *head = try_load_head_table(&source);
+    uint16_t index = 0;
+    head_table *head = NULL;
     uint32_t glyph_offset, glyph_length;
+    ttf_error error = {0};
 
-    if (is_short_format(head)) {
-        load_as_short(&source, head, index, &glyph_offset, &glyph_length);
-    } else {
-        load_as_long(&source, head, index, &glyph_offset, &glyph_length);
+    if (lookup_glyph_index(&source, (uint32_t)*((char*)argv[2]), &index, &error) ||
+        load_head_table(&source, &head, &error) ||
+        load_glyph_location(&source, head, index, &glyph_offset, &glyph_length, &error)) {
+        elog("%s", error.message);
     }
 
     if (glyph_length == 0) {
         elog("Empty glyph (no outline data)\n");
     }
 
-    glyph_t* gh = try_load_glyph(&source, glyph_offset, glyph_length);
+    glyph_t* gh = NULL;
+    ttf_instance_cache instances = {0};
+
+    // optional third argument selects a weight on variable fonts
+    if (argc > 3 && !init_instance_cache(&instances, &source, NULL)) {
+        float coords[TTF_MAX_AXES] = {0};
+        for (uint16_t i = 0; i < instances.fvar.axis_count; i++) {
+            coords[i] = instances.fvar.axes[i].def;
+        }
+
+        int wght = find_axis(&instances.fvar, "wght");
+        if (wght >= 0) {
+            coords[wght] = strtof(argv[3], NULL);
+        }
+
+        ttf_instance *instance;
+        if (get_instance(&instances, coords, &instance, &error) || get_instance_glyph(&instances, instance, index, &gh, &error)) {
+            elog("%s", error.message);
+        }
+        dlog("Advance width at %s : %u", argv[3], get_instance_advance(&instances, instance, index));
+    }
+
+    if (!gh && load_glyph(&source, glyph_offset, glyph_length, &gh, &error)) {
+        elog("%s", error.message);
+    }
 
     InitWindow(800, 600, "TTF Glyph Renderer");
     SetTargetFPS(60);
@@ -59,10 +1037,27 @@ int main(int argc, char** argv) {
     float offset_x = 50.0f - glyph_xMin * scale;
     float offset_y = 550.0f + glyph_yMin * scale;
 
+    // picking under the mouse goes through the index instead of every point and edge
+    hit_index hits;
+    if (build_hit_index(&hits, gh)) {
+        elog("out of memory");
+    }
+
     while (!WindowShouldClose())
     {
         BeginDrawing();
         ClearBackground(RAYWHITE);
+
+        Vector2 mouse = GetMousePosition();
+        float mouse_x = (mouse.x - offset_x) / scale;
+        float mouse_y = (offset_y - mouse.y) / scale;
+        float picked_distance;
+        int32_t picked = hit_nearest_point(&hits, mouse_x, mouse_y, &picked_distance);
+        if (picked_distance * scale > 12.0f) {
+            picked = -1;
+        }
+        int32_t winding = hit_winding(&hits, mouse_x, mouse_y);
+        DrawText(TextFormat("%.0f, %.0f  winding %d", mouse_x, mouse_y, winding), 10, 10, 10, winding ? RED : DARKGRAY);
     
         float box_x = offset_x + glyph_xMin * scale;
         float box_y = offset_y - glyph_yMax * scale;
@@ -102,11 +1097,20 @@ int main(int argc, char** argv) {
         
             DrawText(TextFormat("%d", i), px + 8, py - 8, 10, DARKGRAY);
         }
+
+        if (picked >= 0) {
+            float px = offset_x + x_coords[picked] * scale;
+            float py = offset_y - y_coords[picked] * scale;
+            DrawCircleLines(px, py, 9, ORANGE);
+            DrawText(TextFormat("%d : %d, %d", picked, x_coords[picked], y_coords[picked]), 10, 24, 10, ORANGE);
+        }
     
         EndDrawing();
     }
 
     CloseWindow();
+    free_hit_index(&hits);
+    unload_ttf_source(&source);
     
     return 0;
 }
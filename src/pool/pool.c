@@ -0,0 +1,395 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+#define POOL_IDLE_SPINS 64
+
+typedef struct range_chunk {
+    pool_task task;
+    range_fn fn;
+    void *arg;
+    uint32_t begin;
+    uint32_t end;
+} range_chunk;
+
+static _Thread_local thread_pool *current_pool = NULL;
+static _Thread_local int current_worker = -1;
+static _Thread_local uint32_t steal_seed = 0;
+
+static task_ring* new_ring(int64_t capacity, task_ring *previous) {
+    task_ring *ring = malloc(sizeof(task_ring) + capacity * sizeof(_Atomic(pool_task*)));
+    if (!ring) {
+        return NULL;
+    }
+    ring->mask = capacity - 1;
+    ring->previous = previous;
+    return ring;
+}
+
+static int init_deque(task_deque *deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->ring, new_ring(POOL_DEQUE_CAPACITY, NULL));
+    return atomic_load(&deque->ring) ? 0 : -1;
+}
+
+static void free_deque(task_deque *deque) {
+    task_ring *ring = atomic_load(&deque->ring);
+    while (ring) {
+        task_ring *previous = ring->previous;
+        free(ring);
+        ring = previous;
+    }
+}
+
+// old rings stay alive until the pool goes away since a thief may still read them
+static task_ring* grow_ring(task_deque *deque, task_ring *ring, int64_t top, int64_t bottom) {
+    task_ring *grown = new_ring((ring->mask + 1) * 2, ring);
+    if (!grown) {
+        return NULL;
+    }
+    for (int64_t i = top; i < bottom; i++) {
+        pool_task *task = atomic_load_explicit(&ring->slots[i & ring->mask], memory_order_relaxed);
+        atomic_store_explicit(&grown->slots[i & grown->mask], task, memory_order_relaxed);
+    }
+    atomic_store_explicit(&deque->ring, grown, memory_order_release);
+    return grown;
+}
+
+// -1 when a full ring cannot grow, the task is then not queued
+static int deque_push(task_deque *deque, pool_task *task) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    task_ring *ring = atomic_load_explicit(&deque->ring, memory_order_relaxed);
+    if (bottom - top > ring->mask && !(ring = grow_ring(deque, ring, top, bottom))) {
+        return -1;
+    }
+    atomic_store_explicit(&ring->slots[bottom & ring->mask], task, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return 0;
+}
+
+static pool_task* deque_take(task_deque *deque) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    task_ring *ring = atomic_load_explicit(&deque->ring, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    pool_task *task = atomic_load_explicit(&ring->slots[bottom & ring->mask], memory_order_relaxed);
+    if (top == bottom) {
+        // last element, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static pool_task* deque_steal(task_deque *deque) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    task_ring *ring = atomic_load_explicit(&deque->ring, memory_order_acquire);
+    pool_task *task = atomic_load_explicit(&ring->slots[top & ring->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+static uint32_t next_victim(uint32_t bound) {
+    if (!steal_seed) {
+        steal_seed = (uint32_t)(uintptr_t)&steal_seed | 1;
+    }
+    steal_seed ^= steal_seed << 13;
+    steal_seed ^= steal_seed >> 17;
+    steal_seed ^= steal_seed << 5;
+    return steal_seed % bound;
+}
+
+static pool_task* find_task(thread_pool *pool) {
+    pool_task *task = NULL;
+    bool own = current_pool == pool && current_worker >= 0;
+
+    if (own) {
+        task = deque_take(&pool->deques[current_worker]);
+    } else {
+        pthread_mutex_lock(&pool->inject_lock);
+        task = deque_take(&pool->inject);
+        pthread_mutex_unlock(&pool->inject_lock);
+    }
+
+    // the inject deque sits at index worker_count of the victim ring
+    if (!task) {
+        uint32_t victims = pool->worker_count + 1;
+        uint32_t start = next_victim(victims);
+        for (uint32_t i = 0; i < victims && !task; i++) {
+            uint32_t victim = (start + i) % victims;
+            if (own && victim == (uint32_t)current_worker) {
+                continue;
+            }
+            task = deque_steal(victim == pool->worker_count ? &pool->inject : &pool->deques[victim]);
+        }
+    }
+
+    if (task) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return task;
+}
+
+static void run_task(pool_task *task) {
+    task_group *group = task->group;
+    bool owned = task->owned;
+
+    task->fn(task->arg);
+    if (owned) {
+        free(task);
+    }
+    if (group) {
+        atomic_fetch_sub_explicit(&group->pending, 1, memory_order_release);
+    }
+}
+
+// -1 when the task could not be queued, the caller runs it instead
+static int push_task(thread_pool *pool, pool_task *task) {
+    if (task->group) {
+        atomic_fetch_add_explicit(&task->group->pending, 1, memory_order_relaxed);
+    }
+
+    int status;
+    if (current_pool == pool && current_worker >= 0) {
+        status = deque_push(&pool->deques[current_worker], task);
+    } else {
+        pthread_mutex_lock(&pool->inject_lock);
+        status = deque_push(&pool->inject, task);
+        pthread_mutex_unlock(&pool->inject_lock);
+    }
+    if (status) {
+        if (task->group) {
+            atomic_fetch_sub_explicit(&task->group->pending, 1, memory_order_relaxed);
+        }
+        return -1;
+    }
+
+    // pairs with the sleepers/queued check in wait_for_work
+    atomic_fetch_add(&pool->queued, 1);
+    if (atomic_load(&pool->sleepers) > 0) {
+        pthread_mutex_lock(&pool->sleep_lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->sleep_lock);
+    }
+    return 0;
+}
+
+static void wait_for_work(thread_pool *pool) {
+    pthread_mutex_lock(&pool->sleep_lock);
+    atomic_fetch_add(&pool->sleepers, 1);
+    while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop)) {
+        pthread_cond_wait(&pool->wake, &pool->sleep_lock);
+    }
+    atomic_fetch_sub(&pool->sleepers, 1);
+    pthread_mutex_unlock(&pool->sleep_lock);
+}
+
+typedef struct worker_start {
+    thread_pool *pool;
+    int index;
+} worker_start;
+
+static void* worker_main(void *arg) {
+    worker_start *start = arg;
+    current_pool = start->pool;
+    current_worker = start->index;
+    thread_pool *pool = start->pool;
+    free(start);
+
+    uint32_t idle = 0;
+    while (!atomic_load(&pool->stop)) {
+        pool_task *task = find_task(pool);
+        if (task) {
+            run_task(task);
+            idle = 0;
+        } else if (++idle < POOL_IDLE_SPINS) {
+            sched_yield();
+        } else {
+            wait_for_work(pool);
+            idle = 0;
+        }
+    }
+    return NULL;
+}
+
+// stops and joins the first started workers, then frees every deque
+static void release_thread_pool(thread_pool *pool, uint32_t started) {
+    pthread_mutex_lock(&pool->sleep_lock);
+    atomic_store(&pool->stop, true);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (uint32_t i = 0; pool->deques && i < pool->worker_count; i++) {
+        free_deque(&pool->deques[i]);
+    }
+    free_deque(&pool->inject);
+
+    pthread_mutex_destroy(&pool->inject_lock);
+    pthread_mutex_destroy(&pool->sleep_lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->threads);
+    free(pool->deques);
+    pool->threads = NULL;
+    pool->deques = NULL;
+}
+
+int init_thread_pool(thread_pool *pool, uint32_t worker_count) {
+    if (worker_count == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cores > 0 ? (uint32_t)cores : 1;
+    }
+    if (worker_count > POOL_MAX_WORKERS) {
+        worker_count = POOL_MAX_WORKERS;
+    }
+
+    memset(pool, 0, sizeof(thread_pool));
+    pool->worker_count = worker_count;
+    pthread_mutex_init(&pool->inject_lock, NULL);
+    pthread_mutex_init(&pool->sleep_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->stop, false);
+
+    // every deque exists before the first worker starts stealing from them
+    pool->threads = calloc(worker_count, sizeof(pthread_t));
+    pool->deques = calloc(worker_count, sizeof(task_deque));
+    bool ready = pool->threads && pool->deques && !init_deque(&pool->inject);
+    for (uint32_t i = 0; ready && i < worker_count; i++) {
+        ready = !init_deque(&pool->deques[i]);
+    }
+    if (!ready) {
+        release_thread_pool(pool, 0);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < worker_count; i++) {
+        worker_start *start = malloc(sizeof(worker_start));
+        if (!start) {
+            release_thread_pool(pool, i);
+            return -1;
+        }
+        start->pool = pool;
+        start->index = (int)i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, start)) {
+            free(start);
+            release_thread_pool(pool, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void free_thread_pool(thread_pool *pool) {
+    release_thread_pool(pool, pool->worker_count);
+}
+
+void init_task_group(task_group *group) {
+    atomic_init(&group->pending, 0);
+}
+
+void pool_submit(thread_pool *pool, task_group *group, task_fn fn, void *arg) {
+    if (!pool) {
+        fn(arg);
+        return;
+    }
+
+    // without room for the task it runs here, as it would without a pool
+    pool_task *task = malloc(sizeof(pool_task));
+    if (!task) {
+        fn(arg);
+        return;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->group = group;
+    task->owned = true;
+    if (push_task(pool, task)) {
+        free(task);
+        fn(arg);
+    }
+}
+
+// the waiting thread keeps running queued work so nested waits cannot deadlock
+void task_group_wait(thread_pool *pool, task_group *group) {
+    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+        pool_task *task = pool ? find_task(pool) : NULL;
+        if (task) {
+            run_task(task);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void run_chunk(void *arg) {
+    range_chunk *chunk = arg;
+    chunk->fn(chunk->begin, chunk->end, chunk->arg);
+}
+
+void parallel_for(thread_pool *pool, uint32_t begin, uint32_t end, uint32_t grain, range_fn fn, void *arg) {
+    if (begin >= end) {
+        return;
+    }
+    if (!pool) {
+        fn(begin, end, arg);
+        return;
+    }
+
+    uint32_t total = end - begin;
+    if (grain == 0) {
+        grain = total / (pool->worker_count * 4);
+        grain = grain ? grain : 1;
+    }
+
+    uint32_t chunk_count = (total + grain - 1) / grain;
+    range_chunk *chunks = malloc(chunk_count * sizeof(range_chunk));
+    if (!chunks) {
+        fn(begin, end, arg);
+        return;
+    }
+    task_group group;
+    init_task_group(&group);
+
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        range_chunk *chunk = &chunks[i];
+        chunk->fn = fn;
+        chunk->arg = arg;
+        chunk->begin = begin + i * grain;
+        chunk->end = end - chunk->begin > grain ? chunk->begin + grain : end;
+        chunk->task = (pool_task){ .fn = run_chunk, .arg = chunk, .group = &group, .owned = false };
+        if (push_task(pool, &chunk->task)) {
+            run_chunk(chunk);
+        }
+    }
+
+    task_group_wait(pool, &group);
+    free(chunks);
+}
@@ -0,0 +1,67 @@
+#ifndef POOL
+#define POOL
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define POOL_MAX_WORKERS 256
+#define POOL_DEQUE_CAPACITY 1024
+
+typedef void (*task_fn)(void *arg);
+typedef void (*range_fn)(uint32_t begin, uint32_t end, void *arg);
+
+typedef struct task_group {
+    atomic_uint pending;
+} task_group;
+
+typedef struct pool_task {
+    task_fn fn;
+    void *arg;
+    task_group *group;
+    bool owned;
+} pool_task;
+
+typedef struct task_ring {
+    int64_t mask;
+    struct task_ring *previous;
+    _Atomic(pool_task*) slots[];
+} task_ring;
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, thieves take from the top
+typedef struct task_deque {
+    atomic_int_fast64_t top;
+    atomic_int_fast64_t bottom;
+    _Atomic(task_ring*) ring;
+} task_deque;
+
+typedef struct thread_pool {
+    pthread_t *threads;
+    task_deque *deques;
+    uint32_t worker_count;
+    // deque for threads outside the pool, its owner side is serialized by inject_lock
+    task_deque inject;
+    pthread_mutex_t inject_lock;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    atomic_uint queued;
+    atomic_uint sleepers;
+    atomic_bool stop;
+} thread_pool;
+
+// worker_count 0 picks one worker per online core; -1, with nothing left to free,
+// when the deques cannot be allocated or a worker cannot start
+int init_thread_pool(thread_pool *pool, uint32_t worker_count);
+void free_thread_pool(thread_pool *pool);
+
+// Work that cannot be queued for lack of memory runs on the calling thread instead,
+// so submitting and parallel_for never fail.
+void init_task_group(task_group *group);
+void pool_submit(thread_pool *pool, task_group *group, task_fn fn, void *arg);
+void task_group_wait(thread_pool *pool, task_group *group);
+
+// grain 0 splits the range into a few chunks per worker
+void parallel_for(thread_pool *pool, uint32_t begin, uint32_t end, uint32_t grain, range_fn fn, void *arg);
+
+#endif
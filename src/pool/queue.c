@@ -0,0 +1,113 @@
+#include <stdlib.h>
+
+#include "queue.h"
+
+static size_t round_capacity(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int init_spsc_queue(spsc_queue *queue, size_t capacity) {
+    capacity = round_capacity(capacity);
+    queue->items = malloc(capacity * sizeof(void*));
+    if (!queue->items) {
+        return -1;
+    }
+    queue->mask = capacity - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 0;
+}
+
+void free_spsc_queue(spsc_queue *queue) {
+    free(queue->items);
+    queue->items = NULL;
+}
+
+bool spsc_push(spsc_queue *queue, void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head > queue->mask) {
+        return false;
+    }
+    queue->items[tail & queue->mask] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool spsc_pop(spsc_queue *queue, void **item) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *item = queue->items[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+int init_mpmc_queue(mpmc_queue *queue, size_t capacity) {
+    capacity = round_capacity(capacity);
+    queue->cells = malloc(capacity * sizeof(mpmc_cell));
+    if (!queue->cells) {
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = capacity - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 0;
+}
+
+void free_mpmc_queue(mpmc_queue *queue) {
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+// a cell is writable when its sequence equals the ticket, readable at ticket + 1
+bool mpmc_push(mpmc_queue *queue, void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    for (;;) {
+        mpmc_cell *cell = &queue->cells[tail & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)tail;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &tail, tail + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->item = item;
+                atomic_store_explicit(&cell->sequence, tail + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+}
+
+bool mpmc_pop(mpmc_queue *queue, void **item) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    for (;;) {
+        mpmc_cell *cell = &queue->cells[head & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(head + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &head, head + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *item = cell->item;
+                atomic_store_explicit(&cell->sequence, head + queue->mask + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef QUEUE
+#define QUEUE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define QUEUE_CACHE_LINE 64
+
+// single producer, single consumer ring, capacity rounded up to a power of two
+typedef struct spsc_queue {
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t head;
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail;
+    _Alignas(QUEUE_CACHE_LINE) void **items;
+    size_t mask;
+} spsc_queue;
+
+typedef struct mpmc_cell {
+    atomic_size_t sequence;
+    void *item;
+} mpmc_cell;
+
+// bounded multi producer, multi consumer queue with per-cell sequence numbers
+typedef struct mpmc_queue {
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t head;
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail;
+    _Alignas(QUEUE_CACHE_LINE) mpmc_cell *cells;
+    size_t mask;
+} mpmc_queue;
+
+int init_spsc_queue(spsc_queue *queue, size_t capacity);
+void free_spsc_queue(spsc_queue *queue);
+bool spsc_push(spsc_queue *queue, void *item);
+bool spsc_pop(spsc_queue *queue, void **item);
+
+int init_mpmc_queue(mpmc_queue *queue, size_t capacity);
+void free_mpmc_queue(mpmc_queue *queue);
+bool mpmc_push(mpmc_queue *queue, void *item);
+bool mpmc_pop(mpmc_queue *queue, void **item);
+
+#endif
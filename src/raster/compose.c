@@ -0,0 +1,228 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "compose.h"
+
+// pixels per pass of the RGBA kernel, its scratch lives on the stack
+#define COMPOSE_SPAN 64
+
+// linear light is kept in 16 bits, the encode table is indexed by its top 12
+static uint16_t srgb_to_linear[256];
+static uint8_t linear_to_srgb[4096];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        float linear = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        srgb_to_linear[i] = (uint16_t)(linear * 65535.0f + 0.5f);
+    }
+    for (uint32_t i = 0; i < 4096; i++) {
+        float linear = (i + 0.5f) / 4096.0f;
+        float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+        linear_to_srgb[i] = (uint8_t)(fminf(c, 1.0f) * 255.0f + 0.5f);
+    }
+    linear_to_srgb[0] = 0;
+    linear_to_srgb[4095] = 255;
+}
+
+typedef struct compose_job {
+    const compose_target *target;
+    const placed_glyph *glyphs;
+    compose_color color;
+    uint32_t *band_starts;
+    uint32_t *band_glyphs;
+    // glyph coverage to 16-bit source alpha, color.a folded in
+    uint16_t alpha[256];
+    uint8_t alpha8[256];
+} compose_job;
+
+// out = a + d * (1 - a) on 8-bit alpha, the division by 255 rounded exactly
+static void blend_a8(uint8_t *dst, const uint8_t *coverage, const uint8_t *alpha8, uint32_t count) {
+    uint32_t x = 0;
+#ifdef __SSE2__
+    // alpha8 is the identity when color.a is 255, which is the common case worth vectorizing
+    if (alpha8[128] == 128 && alpha8[255] == 255) {
+        __m128i zero = _mm_setzero_si128();
+        __m128i bias = _mm_set1_epi16(128);
+        for (; x + 8 <= count; x += 8) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(coverage + x)), zero);
+            __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(dst + x)), zero);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, d), bias);
+            t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+            __m128i out = _mm_sub_epi16(_mm_add_epi16(a, d), t);
+            _mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(out, zero));
+        }
+    }
+#endif
+    for (; x < count; x++) {
+        uint32_t a = alpha8[coverage[x]];
+        uint32_t t = a * dst[x] + 128;
+        dst[x] = (uint8_t)(a + dst[x] - ((t + (t >> 8)) >> 8));
+    }
+}
+
+// out = src * a + dst * (1 - a) per channel in 16-bit linear light, alpha's source being 1
+static void blend_linear(uint16_t *dst, const uint16_t *src, const uint16_t *alpha, uint32_t lanes) {
+    uint32_t i = 0;
+#ifdef __SSE2__
+    __m128i ones = _mm_set1_epi16(-1);
+    __m128i s = _mm_loadu_si128((const __m128i*)src);
+    for (; i + 8 <= lanes; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(alpha + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i out = _mm_add_epi16(_mm_mulhi_epu16(s, a), _mm_mulhi_epu16(d, _mm_xor_si128(a, ones)));
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+#endif
+    for (; i < lanes; i++) {
+        uint32_t a = alpha[i];
+        dst[i] = (uint16_t)(((uint32_t)src[i & 7] * a >> 16) + ((uint32_t)dst[i] * (65535 - a) >> 16));
+    }
+}
+
+static void blend_rgba8(uint8_t *dst, const uint8_t *coverage, const compose_job *job, uint32_t count) {
+    // src repeats r, g, b, 1 so one 8-lane vector covers two pixels
+    uint16_t src[8];
+    for (uint32_t p = 0; p < 2; p++) {
+        src[p * 4] = srgb_to_linear[job->color.r];
+        src[p * 4 + 1] = srgb_to_linear[job->color.g];
+        src[p * 4 + 2] = srgb_to_linear[job->color.b];
+        src[p * 4 + 3] = 65535;
+    }
+
+    uint16_t linear[COMPOSE_SPAN * 4];
+    uint16_t alpha[COMPOSE_SPAN * 4];
+    for (uint32_t start = 0; start < count; start += COMPOSE_SPAN) {
+        uint32_t span = count - start < COMPOSE_SPAN ? count - start : COMPOSE_SPAN;
+        uint8_t *pixels = dst + start * 4;
+
+        // spans of zero coverage are common between stems and are skipped whole
+        bool empty = true;
+        for (uint32_t x = 0; x < span && empty; x++) {
+            empty = coverage[start + x] == 0;
+        }
+        if (empty) {
+            continue;
+        }
+
+        for (uint32_t x = 0; x < span; x++) {
+            uint16_t a = job->alpha[coverage[start + x]];
+            for (uint32_t c = 0; c < 3; c++) {
+                linear[x * 4 + c] = srgb_to_linear[pixels[x * 4 + c]];
+                alpha[x * 4 + c] = a;
+            }
+            linear[x * 4 + 3] = pixels[x * 4 + 3] * 257;
+            alpha[x * 4 + 3] = a;
+        }
+        blend_linear(linear, src, alpha, span * 4);
+        for (uint32_t x = 0; x < span; x++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                pixels[x * 4 + c] = linear_to_srgb[linear[x * 4 + c] >> 4];
+            }
+            pixels[x * 4 + 3] = (uint8_t)((linear[x * 4 + 3] + 128) / 257);
+        }
+    }
+}
+
+static void compose_glyph_rows(const compose_job *job, const placed_glyph *glyph, int32_t band_top, int32_t band_bottom) {
+    const compose_target *target = job->target;
+    int32_t x0 = glyph->x > 0 ? glyph->x : 0;
+    int32_t x1 = glyph->x + glyph->width < (int32_t)target->width ? glyph->x + glyph->width : (int32_t)target->width;
+    int32_t y0 = glyph->y > band_top ? glyph->y : band_top;
+    int32_t y1 = glyph->y + glyph->height < band_bottom ? glyph->y + glyph->height : band_bottom;
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    uint32_t bytes = target->format == COMPOSE_RGBA8 ? 4 : 1;
+    for (int32_t y = y0; y < y1; y++) {
+        const uint8_t *coverage = glyph->coverage + (size_t)(y - glyph->y) * glyph->stride + (x0 - glyph->x);
+        uint8_t *dst = target->pixels + (size_t)y * target->stride + (size_t)x0 * bytes;
+        if (target->format == COMPOSE_RGBA8) {
+            blend_rgba8(dst, coverage, job, (uint32_t)(x1 - x0));
+        } else {
+            blend_a8(dst, coverage, job->alpha8, (uint32_t)(x1 - x0));
+        }
+    }
+}
+
+static void compose_band_range(uint32_t begin, uint32_t end, void *arg) {
+    compose_job *job = arg;
+    for (uint32_t band = begin; band < end; band++) {
+        int32_t top = (int32_t)(band * COMPOSE_BAND_HEIGHT);
+        for (uint32_t i = job->band_starts[band]; i < job->band_starts[band + 1]; i++) {
+            compose_glyph_rows(job, &job->glyphs[job->band_glyphs[i]], top, top + COMPOSE_BAND_HEIGHT);
+        }
+    }
+}
+
+static bool glyph_bands(const compose_target *target, const placed_glyph *glyph, uint32_t *first, uint32_t *last) {
+    int32_t top = glyph->y > 0 ? glyph->y : 0;
+    int32_t bottom = glyph->y + glyph->height < (int32_t)target->height ? glyph->y + glyph->height : (int32_t)target->height;
+    if (top >= bottom || glyph->x >= (int32_t)target->width || glyph->x + glyph->width <= 0) {
+        return false;
+    }
+    *first = (uint32_t)top / COMPOSE_BAND_HEIGHT;
+    *last = (uint32_t)(bottom - 1) / COMPOSE_BAND_HEIGHT;
+    return true;
+}
+
+// glyphs are binned into the bands they touch keeping submission order, so every band
+// blends its glyphs in the same order a serial pass would
+int compose_glyphs(const compose_target *target, const placed_glyph *glyphs, uint32_t count,
+                    compose_color color, thread_pool *pool) {
+    pthread_once(&tables_once, build_tables);
+
+    compose_job job = { .target = target, .glyphs = glyphs, .color = color };
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t a = i * color.a;
+        job.alpha[i] = (uint16_t)((a * 65535 + 32512) / 65025);
+        job.alpha8[i] = (uint8_t)((a + 127) / 255);
+    }
+
+    uint32_t band_count = (target->height + COMPOSE_BAND_HEIGHT - 1) / COMPOSE_BAND_HEIGHT;
+    job.band_starts = calloc(band_count + 1, sizeof(uint32_t));
+    if (!job.band_starts) {
+        return -1;
+    }
+    uint32_t first, last;
+    for (uint32_t i = 0; i < count; i++) {
+        if (glyph_bands(target, &glyphs[i], &first, &last)) {
+            for (uint32_t b = first; b <= last; b++) {
+                job.band_starts[b + 1]++;
+            }
+        }
+    }
+    for (uint32_t b = 0; b < band_count; b++) {
+        job.band_starts[b + 1] += job.band_starts[b];
+    }
+    job.band_glyphs = malloc((job.band_starts[band_count] + 1) * sizeof(uint32_t));
+    uint32_t *cursor = malloc((band_count + 1) * sizeof(uint32_t));
+    if (!job.band_glyphs || !cursor) {
+        free(job.band_starts);
+        free(job.band_glyphs);
+        free(cursor);
+        return -1;
+    }
+    memcpy(cursor, job.band_starts, (band_count + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        if (glyph_bands(target, &glyphs[i], &first, &last)) {
+            for (uint32_t b = first; b <= last; b++) {
+                job.band_glyphs[cursor[b]++] = i;
+            }
+        }
+    }
+    free(cursor);
+
+    parallel_for(pool, 0, band_count, 1, compose_band_range, &job);
+
+    free(job.band_starts);
+    free(job.band_glyphs);
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef COMPOSE
+#define COMPOSE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pool.h"
+
+#define COMPOSE_BAND_HEIGHT 32
+
+typedef enum compose_format {
+    COMPOSE_A8,
+    COMPOSE_RGBA8
+} compose_format;
+
+// RGBA8 targets hold premultiplied sRGB-encoded channels, blending happens in linear light
+typedef struct compose_target {
+    uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    compose_format format;
+} compose_target;
+
+// an A8 coverage bitmap with its top-left corner at (x, y) in the target
+typedef struct placed_glyph {
+    const uint8_t *coverage;
+    uint32_t stride;
+    uint16_t width;
+    uint16_t height;
+    int32_t x;
+    int32_t y;
+} placed_glyph;
+
+// straight (not premultiplied) sRGB color
+typedef struct compose_color {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} compose_color;
+
+// Glyphs are blended in order with source-over. With a pool the target is split into
+// row bands that are composed in parallel; the result is identical to a serial run.
+// Returns -1 and leaves the target untouched when the band lists cannot be allocated.
+int compose_glyphs(const compose_target *target, const placed_glyph *glyphs, uint32_t count,
+                    compose_color color, thread_pool *pool);
+
+#endif
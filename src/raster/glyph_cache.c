@@ -0,0 +1,220 @@
+#include <math.h>
+
+#include "glyph_cache.h"
+
+#define PAGE_BYTES ((size_t)GLYPH_CACHE_PAGE_SIZE * GLYPH_CACHE_PAGE_SIZE)
+
+static uint32_t hash_key(const ttf_font *font, uint16_t glyph, int32_t ppem_26_6, uint8_t subpixel) {
+    uint64_t h = (uint64_t)(uintptr_t)font * 0x9E3779B97F4A7C15ull;
+    h ^= ((uint64_t)glyph << 40) ^ ((uint64_t)(uint32_t)ppem_26_6 << 8) ^ subpixel;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return (uint32_t)(h >> 32) % GLYPH_CACHE_BUCKETS;
+}
+
+int init_glyph_cache(glyph_cache *cache, size_t budget, uint8_t subpixel_steps, raster_mode mode,
+                     const raster_tone *tone, simplify_cache *simplify) {
+    memset(cache, 0, sizeof(glyph_cache));
+    if (subpixel_steps == 0) {
+        subpixel_steps = 1;
+    }
+
+    cache->subpixel_steps = subpixel_steps;
+    cache->mode = mode;
+    cache->tone = tone;
+    cache->simplify = simplify;
+    cache->budget = budget;
+    size_t max_pages = budget / PAGE_BYTES;
+    cache->max_pages = max_pages == 0 ? 1 : (max_pages > UINT16_MAX ? UINT16_MAX : (uint16_t)max_pages);
+    cache->pages = calloc(cache->max_pages, sizeof(atlas_page));
+    if (!cache->pages) {
+        return -1;
+    }
+    init_raster_path(&cache->path);
+    init_raster_canvas(&cache->canvas);
+    return 0;
+}
+
+static void free_page_entries(atlas_page *page) {
+    cache_entry *entry = page->entries;
+    while (entry) {
+        cache_entry *next = entry->page_next;
+        free(entry);
+        entry = next;
+    }
+    page->entries = NULL;
+}
+
+void free_glyph_cache(glyph_cache *cache) {
+    for (uint16_t i = 0; i < cache->page_count; i++) {
+        free_page_entries(&cache->pages[i]);
+        free(cache->pages[i].pixels);
+    }
+    free(cache->pages);
+    free_raster_path(&cache->path);
+    free_raster_canvas(&cache->canvas);
+    memset(cache, 0, sizeof(glyph_cache));
+}
+
+static void evict_page(glyph_cache *cache, atlas_page *page) {
+    for (cache_entry *entry = page->entries; entry; entry = entry->page_next) {
+        cache_entry **link = &cache->buckets[hash_key(entry->font, entry->glyph, entry->ppem_26_6, entry->subpixel)];
+        while (*link != entry) {
+            link = &(*link)->next;
+        }
+        *link = entry->next;
+    }
+    free_page_entries(page);
+
+    memset(page->pixels, 0, PAGE_BYTES);
+    page->shelf_y = 0;
+    page->shelf_height = 0;
+    page->cursor_x = 0;
+    cache->stats.evictions++;
+}
+
+// Shelf packing: glyphs fill the current shelf left to right, the shelf grows to the
+// tallest glyph on it, and a new shelf opens below once a glyph no longer fits.
+static bool place_on_page(atlas_page *page, uint32_t width, uint32_t height, uint16_t *x, uint16_t *y) {
+    uint32_t shelf_height = height > page->shelf_height ? height : page->shelf_height;
+    if (page->cursor_x + width > GLYPH_CACHE_PAGE_SIZE || page->shelf_y + shelf_height > GLYPH_CACHE_PAGE_SIZE) {
+        page->shelf_y += page->shelf_height;
+        page->shelf_height = 0;
+        page->cursor_x = 0;
+        shelf_height = height;
+        if (width > GLYPH_CACHE_PAGE_SIZE || page->shelf_y + height > GLYPH_CACHE_PAGE_SIZE) {
+            return false;
+        }
+    }
+
+    *x = (uint16_t)page->cursor_x;
+    *y = (uint16_t)page->shelf_y;
+    page->cursor_x += width;
+    page->shelf_height = shelf_height;
+    return true;
+}
+
+static atlas_page* allocate_space(glyph_cache *cache, uint32_t width, uint32_t height, uint16_t *x, uint16_t *y) {
+    if (cache->page_count > 0 && place_on_page(&cache->pages[cache->current], width, height, x, y)) {
+        return &cache->pages[cache->current];
+    }
+
+    if (cache->page_count < cache->max_pages) {
+        atlas_page *page = &cache->pages[cache->page_count];
+        page->pixels = calloc(1, PAGE_BYTES);
+        if (!page->pixels) {
+            return NULL;
+        }
+        cache->current = cache->page_count++;
+    } else {
+        // the least recently used page goes, unless the current frame still uses it
+        uint16_t oldest = cache->page_count;
+        for (uint16_t i = 0; i < cache->page_count; i++) {
+            if (cache->frame && cache->pages[i].last_used >= cache->frame) {
+                continue;
+            }
+            if (oldest == cache->page_count || cache->pages[i].last_used < cache->pages[oldest].last_used) {
+                oldest = i;
+            }
+        }
+        if (oldest == cache->page_count) {
+            cache->frame_full = true;
+            return NULL;
+        }
+        evict_page(cache, &cache->pages[oldest]);
+        cache->current = oldest;
+    }
+
+    atlas_page *page = &cache->pages[cache->current];
+    return place_on_page(page, width, height, x, y) ? page : NULL;
+}
+
+ttf_status glyph_cache_get(glyph_cache *cache, ttf_font *font, uint16_t glyph, float ppem, float pen_x, const cached_glyph **bitmap) {
+    *bitmap = NULL;
+    int32_t ppem_26_6 = (int32_t)lroundf(ppem * 64.0f);
+    float fraction = pen_x - floorf(pen_x);
+    uint8_t subpixel = (uint8_t)(fraction * cache->subpixel_steps);
+    if (subpixel >= cache->subpixel_steps) {
+        subpixel = cache->subpixel_steps - 1;
+    }
+
+    uint32_t bucket = hash_key(font, glyph, ppem_26_6, subpixel);
+    for (cache_entry *entry = cache->buckets[bucket]; entry; entry = entry->next) {
+        if (entry->font == font && entry->glyph == glyph && entry->ppem_26_6 == ppem_26_6 && entry->subpixel == subpixel) {
+            cache->pages[entry->bitmap.page].last_used = ++cache->clock;
+            cache->stats.hits++;
+            *bitmap = &entry->bitmap;
+            return TTF_OK;
+        }
+    }
+    cache->stats.misses++;
+
+    const glyph_t *outline = cache->simplify && cache->simplify->font == font
+                             ? get_simplified_glyph(cache->simplify, glyph, ppem_26_6 / 64.0f)
+                             : get_font_glyph(font, glyph);
+    if (!outline) {
+        return TTF_OK;
+    }
+
+    // every pen position in a bucket shares the rendering at the bucket's left edge
+    float x_shift = (float)subpixel / cache->subpixel_steps;
+    if (flatten_glyph_at(outline, ppem_26_6 / 64.0f, get_units_per_em(font->head), x_shift, cache->mode, cache->tone, &cache->path)) {
+        return TTF_ERR_NO_MEMORY;
+    }
+
+    uint32_t width = cache->path.width;
+    uint32_t height = cache->path.height;
+    uint16_t x, y;
+    atlas_page *page = NULL;
+    if (width + GLYPH_CACHE_PADDING <= GLYPH_CACHE_PAGE_SIZE && height + GLYPH_CACHE_PADDING <= GLYPH_CACHE_PAGE_SIZE) {
+        page = allocate_space(cache, width + GLYPH_CACHE_PADDING, height + GLYPH_CACHE_PADDING, &x, &y);
+    }
+    if (!page) {
+        if (!cache->frame_full) {
+            cache->stats.uncacheable++;
+        }
+        return TTF_OK;
+    }
+
+    raster_bitmap rendered;
+    if (render_path(&cache->path, &cache->canvas, &rendered)) {
+        return TTF_ERR_NO_MEMORY;
+    }
+    uint8_t *target = page->pixels + (size_t)y * GLYPH_CACHE_PAGE_SIZE + x;
+    for (uint32_t row = 0; row < height; row++) {
+        memcpy(target + (size_t)row * GLYPH_CACHE_PAGE_SIZE, rendered.pixels + (size_t)row * width, width);
+    }
+    free_raster_bitmap(&rendered);
+
+    cache_entry *entry = malloc(sizeof(cache_entry));
+    if (!entry) {
+        return TTF_ERR_NO_MEMORY;
+    }
+    entry->font = font;
+    entry->glyph = glyph;
+    entry->ppem_26_6 = ppem_26_6;
+    entry->subpixel = subpixel;
+    entry->bitmap = (cached_glyph){
+        .pixels = target,
+        .stride = GLYPH_CACHE_PAGE_SIZE,
+        .page = (uint16_t)(page - cache->pages),
+        .x = x,
+        .y = y,
+        .width = (uint16_t)width,
+        .height = (uint16_t)height,
+        .left = rendered.left,
+        .top = rendered.top
+    };
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    entry->page_next = page->entries;
+    page->entries = entry;
+    page->last_used = ++cache->clock;
+
+    *bitmap = &entry->bitmap;
+    return TTF_OK;
+}
+
+void glyph_cache_begin_frame(glyph_cache *cache) {
+    cache->frame = cache->clock + 1;
+    cache->frame_full = false;
+}
@@ -0,0 +1,94 @@
+#ifndef GLYPH_CACHE
+#define GLYPH_CACHE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "font.h"
+#include "raster.h"
+#include "simplify.h"
+
+#define GLYPH_CACHE_PAGE_SIZE 512
+#define GLYPH_CACHE_BUCKETS 1024
+#define GLYPH_CACHE_PADDING 1
+
+// where a rendered glyph lives; pixels points into an atlas page with the page's stride
+typedef struct cached_glyph {
+    const uint8_t *pixels;
+    uint32_t stride;
+    uint16_t page;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    int32_t left;
+    int32_t top;
+} cached_glyph;
+
+typedef struct cache_entry {
+    const ttf_font *font;
+    uint16_t glyph;
+    int32_t ppem_26_6;
+    uint8_t subpixel;
+    cached_glyph bitmap;
+    struct cache_entry *next;
+    struct cache_entry *page_next;
+} cache_entry;
+
+// shelf-packed A8 page, evicted as a whole when the byte budget runs out
+typedef struct atlas_page {
+    uint8_t *pixels;
+    uint32_t shelf_y;
+    uint32_t shelf_height;
+    uint32_t cursor_x;
+    uint64_t last_used;
+    cache_entry *entries;
+} atlas_page;
+
+typedef struct glyph_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t uncacheable;
+} glyph_cache_stats;
+
+// Single-threaded: pointers returned by glyph_cache_get stay valid until
+// a later call evicts their page. Once glyph_cache_begin_frame has been called,
+// pages used since then are pinned and never evicted, so every pointer handed
+// out during a frame stays valid until the next one begins.
+typedef struct glyph_cache {
+    uint8_t subpixel_steps;
+    raster_mode mode;
+    const raster_tone *tone;
+    simplify_cache *simplify;
+    size_t budget;
+    atlas_page *pages;
+    uint16_t page_count;
+    uint16_t max_pages;
+    uint16_t current;
+    cache_entry *buckets[GLYPH_CACHE_BUCKETS];
+    uint64_t clock;
+    // pages with last_used at or past frame are pinned, 0 pins nothing
+    uint64_t frame;
+    // set when a glyph could not be placed because every page is pinned
+    bool frame_full;
+    raster_path path;
+    raster_canvas canvas;
+    glyph_cache_stats stats;
+} glyph_cache;
+
+// subpixel_steps is 3 or 4 buckets per pixel, budget is the atlas byte budget;
+// tone and simplify may be NULL and have to outlive the cache, simplify only
+// applies to glyphs of the font it was made for
+int init_glyph_cache(glyph_cache *cache, size_t budget, uint8_t subpixel_steps, raster_mode mode,
+                     const raster_tone *tone, simplify_cache *simplify);
+void free_glyph_cache(glyph_cache *cache);
+
+// Looks up a glyph drawn with its origin at pen_x; the bitmap's left edge goes at
+// floor(pen_x) + left. A NULL bitmap means the glyph has no outline or does not fit
+// a page, or, with frame_full set, that the frame's glyphs fill every page: use them,
+// begin a new frame and ask again. TTF_ERR_NO_MEMORY when the glyph cannot be drawn.
+ttf_status glyph_cache_get(glyph_cache *cache, ttf_font *font, uint16_t glyph, float ppem, float pen_x, const cached_glyph **bitmap);
+void glyph_cache_begin_frame(glyph_cache *cache);
+
+#endif
@@ -0,0 +1,203 @@
+#include <math.h>
+
+#include "hittest.h"
+
+static uint32_t clamp_cell(float value, uint32_t count) {
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+    return value >= count ? count - 1 : (uint32_t)value;
+}
+
+// edges are bucketed twice, counting then filling, so each band's list is contiguous
+static int build_bands(hit_index *index) {
+    float y_min = INFINITY, y_max = -INFINITY;
+    for (uint32_t i = 0; i < index->edge_count; i++) {
+        y_min = fminf(y_min, fminf(index->edges[i].y0, index->edges[i].y1));
+        y_max = fmaxf(y_max, fmaxf(index->edges[i].y0, index->edges[i].y1));
+    }
+    uint32_t bands = index->edge_count / HIT_EDGES_PER_BAND;
+    index->band_count = bands == 0 ? 1 : (bands > HIT_MAX_BANDS ? HIT_MAX_BANDS : bands);
+    index->band_y = index->edge_count ? y_min : 0.0f;
+    index->band_height = index->edge_count && y_max > y_min ? (y_max - y_min) / index->band_count : 1.0f;
+
+    index->band_start = calloc(index->band_count + 1, sizeof(uint32_t));
+    if (!index->band_start) {
+        return -1;
+    }
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < index->edge_count; i++) {
+            raster_line *edge = &index->edges[i];
+            uint32_t first = clamp_cell((fminf(edge->y0, edge->y1) - index->band_y) / index->band_height, index->band_count);
+            uint32_t last = clamp_cell((fmaxf(edge->y0, edge->y1) - index->band_y) / index->band_height, index->band_count);
+            for (uint32_t b = first; b <= last; b++) {
+                if (pass == 0) {
+                    index->band_start[b + 1]++;
+                } else {
+                    index->band_edges[index->band_start[b]++] = i;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (uint32_t b = 0; b < index->band_count; b++) {
+                index->band_start[b + 1] += index->band_start[b];
+            }
+            index->band_edges = malloc((index->band_start[index->band_count] + 1) * sizeof(uint32_t));
+            if (!index->band_edges) {
+                return -1;
+            }
+        }
+    }
+    // filling advanced every start to the next band's, shift them back
+    for (uint32_t b = index->band_count; b > 0; b--) {
+        index->band_start[b] = index->band_start[b - 1];
+    }
+    index->band_start[0] = 0;
+    return 0;
+}
+
+static int build_grid(hit_index *index) {
+    const glyph_t *glyph = index->glyph;
+    float x_min = INFINITY, y_min = INFINITY, x_max = -INFINITY, y_max = -INFINITY;
+    for (uint16_t i = 0; i < glyph->count; i++) {
+        x_min = fminf(x_min, glyph->x_poss[i]);
+        x_max = fmaxf(x_max, glyph->x_poss[i]);
+        y_min = fminf(y_min, glyph->y_poss[i]);
+        y_max = fmaxf(y_max, glyph->y_poss[i]);
+    }
+    uint32_t side = (uint32_t)ceilf(sqrtf((float)glyph->count / HIT_POINTS_PER_CELL));
+    index->columns = index->rows = side == 0 ? 1 : side;
+    index->cell_x = glyph->count ? x_min : 0.0f;
+    index->cell_y = glyph->count ? y_min : 0.0f;
+    index->cell_width = glyph->count && x_max > x_min ? (x_max - x_min) / index->columns : 1.0f;
+    index->cell_height = glyph->count && y_max > y_min ? (y_max - y_min) / index->rows : 1.0f;
+
+    uint32_t cells = index->columns * index->rows;
+    index->cell_start = calloc(cells + 1, sizeof(uint32_t));
+    index->cell_points = malloc((glyph->count + 1) * sizeof(uint16_t));
+    if (!index->cell_start || !index->cell_points) {
+        return -1;
+    }
+    for (uint16_t i = 0; i < glyph->count; i++) {
+        uint32_t column = clamp_cell((glyph->x_poss[i] - index->cell_x) / index->cell_width, index->columns);
+        uint32_t row = clamp_cell((glyph->y_poss[i] - index->cell_y) / index->cell_height, index->rows);
+        index->cell_start[row * index->columns + column + 1]++;
+    }
+    for (uint32_t c = 0; c < cells; c++) {
+        index->cell_start[c + 1] += index->cell_start[c];
+    }
+    for (uint16_t i = 0; i < glyph->count; i++) {
+        uint32_t column = clamp_cell((glyph->x_poss[i] - index->cell_x) / index->cell_width, index->columns);
+        uint32_t row = clamp_cell((glyph->y_poss[i] - index->cell_y) / index->cell_height, index->rows);
+        index->cell_points[index->cell_start[row * index->columns + column]++] = i;
+    }
+    for (uint32_t c = cells; c > 0; c--) {
+        index->cell_start[c] = index->cell_start[c - 1];
+    }
+    index->cell_start[0] = 0;
+    return 0;
+}
+
+int build_hit_index(hit_index *index, const glyph_t *glyph) {
+    memset(index, 0, sizeof(hit_index));
+    index->glyph = glyph;
+
+    // flattened at one pixel per font unit, then turned back to y up
+    raster_path path;
+    init_raster_path(&path);
+    if (flatten_glyph(glyph, 1.0f, 0.0f, &path)) {
+        free_raster_path(&path);
+        return -1;
+    }
+    index->edges = path.lines;
+    index->edge_count = path.count;
+    for (uint32_t i = 0; i < path.count; i++) {
+        raster_line *edge = &index->edges[i];
+        *edge = (raster_line){ edge->x0 + path.left, path.top - edge->y0, edge->x1 + path.left, path.top - edge->y1 };
+    }
+
+    if (build_bands(index) || build_grid(index)) {
+        free_hit_index(index);
+        return -1;
+    }
+    return 0;
+}
+
+void free_hit_index(hit_index *index) {
+    free(index->edges);
+    free(index->band_start);
+    free(index->band_edges);
+    free(index->cell_start);
+    free(index->cell_points);
+    memset(index, 0, sizeof(hit_index));
+}
+
+// a ray towards +x crosses each edge whose half-open y range holds the point
+int32_t hit_winding(const hit_index *index, float x, float y) {
+    float band = (y - index->band_y) / index->band_height;
+    if (index->edge_count == 0 || !(band >= 0.0f) || band > index->band_count) {
+        return 0;
+    }
+    uint32_t b = clamp_cell(band, index->band_count);
+
+    int32_t winding = 0;
+    for (uint32_t i = index->band_start[b]; i < index->band_start[b + 1]; i++) {
+        const raster_line *edge = &index->edges[index->band_edges[i]];
+        if ((edge->y0 <= y) == (edge->y1 <= y)) {
+            continue;
+        }
+        float crossing = edge->x0 + (y - edge->y0) * (edge->x1 - edge->x0) / (edge->y1 - edge->y0);
+        if (crossing > x) {
+            winding += edge->y1 > edge->y0 ? 1 : -1;
+        }
+    }
+    return winding;
+}
+
+// Rings of cells around the query's cell are searched until no unvisited cell
+// can hold anything closer than the best point so far.
+int32_t hit_nearest_point(const hit_index *index, float x, float y, float *distance) {
+    const glyph_t *glyph = index->glyph;
+    if (!glyph || glyph->count == 0) {
+        return -1;
+    }
+    int32_t column = (int32_t)clamp_cell((x - index->cell_x) / index->cell_width, index->columns);
+    int32_t row = (int32_t)clamp_cell((y - index->cell_y) / index->cell_height, index->rows);
+    float step = fminf(index->cell_width, index->cell_height);
+    int32_t rings = (int32_t)(index->columns > index->rows ? index->columns : index->rows);
+
+    int32_t best = -1;
+    float best_sq = INFINITY;
+    for (int32_t ring = 0; ring < rings; ring++) {
+        for (int32_t r = row - ring; r <= row + ring; r++) {
+            if (r < 0 || r >= (int32_t)index->rows) {
+                continue;
+            }
+            // inner rows only visit the ring's two end cells
+            int32_t stride = r == row - ring || r == row + ring ? 1 : 2 * ring;
+            for (int32_t c = column - ring; c <= column + ring; c += stride > 0 ? stride : 1) {
+                if (c < 0 || c >= (int32_t)index->columns) {
+                    continue;
+                }
+                uint32_t cell = (uint32_t)r * index->columns + (uint32_t)c;
+                for (uint32_t i = index->cell_start[cell]; i < index->cell_start[cell + 1]; i++) {
+                    uint16_t point = index->cell_points[i];
+                    float dx = glyph->x_poss[point] - x, dy = glyph->y_poss[point] - y;
+                    if (dx * dx + dy * dy < best_sq) {
+                        best_sq = dx * dx + dy * dy;
+                        best = point;
+                    }
+                }
+            }
+        }
+        float reach = ring * step;
+        if (best >= 0 && best_sq <= reach * reach) {
+            break;
+        }
+    }
+
+    if (distance) {
+        *distance = sqrtf(best_sq);
+    }
+    return best;
+}
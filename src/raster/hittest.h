@@ -0,0 +1,48 @@
+#ifndef HITTEST
+#define HITTEST
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "glyph.h"
+#include "raster.h"
+
+// bands and grid cells hold about this many edges and points each
+#define HIT_EDGES_PER_BAND 4
+#define HIT_POINTS_PER_CELL 4
+#define HIT_MAX_BANDS 1024
+
+// Built once per outline, everything in font units with y up. Flattened edges are
+// bucketed into horizontal bands so a winding query only crosses the edges of one
+// band; points go into a uniform grid searched ring by ring from the query's cell.
+typedef struct hit_index {
+    raster_line *edges;
+    uint32_t edge_count;
+    uint32_t *band_start;
+    uint32_t *band_edges;
+    uint32_t band_count;
+    float band_y;
+    float band_height;
+
+    const glyph_t *glyph;
+    uint32_t *cell_start;
+    uint16_t *cell_points;
+    uint32_t columns;
+    uint32_t rows;
+    float cell_x;
+    float cell_y;
+    float cell_width;
+    float cell_height;
+} hit_index;
+
+// the glyph has to outlive the index, which reads its points
+int build_hit_index(hit_index *index, const glyph_t *glyph);
+void free_hit_index(hit_index *index);
+
+// nonzero winding number at a point, the glyph covers it when this is not 0
+int32_t hit_winding(const hit_index *index, float x, float y);
+
+// index of the closest on or off-curve point, -1 for a glyph without points
+int32_t hit_nearest_point(const hit_index *index, float x, float y, float *distance);
+
+#endif
@@ -0,0 +1,124 @@
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "lcd.h"
+
+void init_lcd_filter(lcd_filter *filter, const uint8_t *weights, float gamma) {
+    static const uint8_t defaults[LCD_FILTER_TAPS] = LCD_DEFAULT_WEIGHTS;
+    if (!weights) {
+        weights = defaults;
+    }
+    for (uint32_t i = 0; i < LCD_FILTER_TAPS; i++) {
+        filter->weights[i] = weights[i];
+    }
+
+    // the filter runs on linear coverage, the table then encodes it for display
+    filter->linear = gamma <= 0.0f || fabsf(gamma - 1.0f) < 1e-3f;
+    for (uint32_t i = 0; i < 256; i++) {
+        float value = filter->linear ? i / 255.0f : powf(i / 255.0f, 1.0f / gamma);
+        filter->gamma[i] = (uint8_t)(value * 255.0f + 0.5f);
+    }
+}
+
+// out[x] = (sum of weights[k] * in[x + k - 2] + 128) >> 8, at most 255 * 256 + 128 so
+// 16-bit lanes never overflow
+void filter_lcd_row(const lcd_filter *filter, const uint8_t *padded, uint8_t *rgb, uint32_t subpixels) {
+    const uint16_t *w = filter->weights;
+    uint32_t x = 0;
+
+#if defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128i round = _mm_set1_epi16(128);
+    __m128i w0 = _mm_set1_epi16(w[0]), w1 = _mm_set1_epi16(w[1]), w2 = _mm_set1_epi16(w[2]);
+    __m128i w3 = _mm_set1_epi16(w[3]), w4 = _mm_set1_epi16(w[4]);
+    for (; x + 8 <= subpixels; x += 8) {
+        #define TAP(k) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(padded + x + k)), zero)
+        __m128i sum = _mm_add_epi16(round, _mm_mullo_epi16(TAP(0), w0));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(TAP(1), w1));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(TAP(2), w2));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(TAP(3), w3));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(TAP(4), w4));
+        #undef TAP
+        _mm_storel_epi64((__m128i*)(rgb + x), _mm_packus_epi16(_mm_srli_epi16(sum, 8), zero));
+    }
+#elif defined(__ARM_NEON)
+    for (; x + 8 <= subpixels; x += 8) {
+        uint16x8_t sum = vdupq_n_u16(128);
+        for (uint32_t k = 0; k < LCD_FILTER_TAPS; k++) {
+            sum = vmlaq_n_u16(sum, vmovl_u8(vld1_u8(padded + x + k)), w[k]);
+        }
+        vst1_u8(rgb + x, vshrn_n_u16(sum, 8));
+    }
+#endif
+
+    for (; x < subpixels; x++) {
+        uint32_t sum = 128;
+        for (uint32_t k = 0; k < LCD_FILTER_TAPS; k++) {
+            sum += w[k] * padded[x + k];
+        }
+        rgb[x] = (uint8_t)(sum >> 8);
+    }
+
+    if (!filter->linear) {
+        for (x = 0; x < subpixels; x++) {
+            rgb[x] = filter->gamma[rgb[x]];
+        }
+    }
+}
+
+int render_path_lcd(const raster_path *path, raster_canvas *canvas, const lcd_filter *filter, raster_bitmap *bitmap) {
+    uint32_t width = path->width + 2;
+    uint32_t subpixels = width * 3;
+    bitmap->width = width;
+    bitmap->height = path->height;
+    bitmap->left = path->left - 1;
+    bitmap->top = path->top;
+    bitmap->pixels = malloc((size_t)subpixels * path->height);
+    uint8_t *coverage = malloc((size_t)subpixels * path->height);
+    uint8_t *padded = calloc(subpixels + 2 + LCD_ROW_PADDING, 1);
+    if (!bitmap->pixels || !coverage || !padded) {
+        free(bitmap->pixels);
+        bitmap->pixels = NULL;
+        free(coverage);
+        free(padded);
+        return -1;
+    }
+
+    const uint8_t *lut = path->tone ? path->tone->lut : NULL;
+    // x is stretched 3x around a one pixel margin, y stays at the path's resolution
+    if (reset_raster_canvas(canvas, path->mode, subpixels, path->height)) {
+        free(bitmap->pixels);
+        bitmap->pixels = NULL;
+        free(coverage);
+        free(padded);
+        return -1;
+    }
+    if (path->mode == RASTER_FIXED) {
+        for (uint32_t i = 0; i < path->count; i++) {
+            const raster_fixed_line *line = &path->fixed_lines[i];
+            accumulate_line_fixed(canvas, (line->x0 + 64) * 3, line->y0, (line->x1 + 64) * 3, line->y1);
+        }
+        resolve_coverage_fixed(canvas, lut, coverage);
+    } else {
+        for (uint32_t i = 0; i < path->count; i++) {
+            const raster_line *line = &path->lines[i];
+            accumulate_line(canvas, (line->x0 + 1.0f) * 3.0f, line->y0, (line->x1 + 1.0f) * 3.0f, line->y1);
+        }
+        resolve_coverage(canvas, lut, coverage);
+    }
+
+    for (uint32_t y = 0; y < path->height; y++) {
+        memcpy(padded + 2, coverage + (size_t)y * subpixels, subpixels);
+        filter_lcd_row(filter, padded, bitmap->pixels + (size_t)y * subpixels, subpixels);
+    }
+
+    free(coverage);
+    free(padded);
+    return 0;
+}
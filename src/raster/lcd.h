@@ -0,0 +1,32 @@
+#ifndef LCD
+#define LCD
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "raster.h"
+
+#define LCD_FILTER_TAPS 5
+
+// FreeType's default LCD filter, the weights sum to 256
+#define LCD_DEFAULT_WEIGHTS { 0x08, 0x4D, 0x56, 0x4D, 0x08 }
+
+typedef struct lcd_filter {
+    uint16_t weights[LCD_FILTER_TAPS];
+    bool linear;
+    uint8_t gamma[256];
+} lcd_filter;
+
+// weights must sum to 256 or less, NULL selects the default; gamma 1.0 leaves coverage linear
+void init_lcd_filter(lcd_filter *filter, const uint8_t *weights, float gamma);
+
+// Renders a path flattened at normal width with 3x horizontal oversampling. The bitmap
+// is RGB, 3 bytes per pixel, and one pixel wider on each side for the filter spill.
+int render_path_lcd(const raster_path *path, raster_canvas *canvas, const lcd_filter *filter, raster_bitmap *bitmap);
+
+// filters one row of 3 * width subpixels into 3 * width RGB bytes; padded holds
+// two zero bytes before and LCD_ROW_PADDING after the row
+#define LCD_ROW_PADDING 16
+void filter_lcd_row(const lcd_filter *filter, const uint8_t *padded, uint8_t *rgb, uint32_t subpixels);
+
+#endif
@@ -0,0 +1,299 @@
+#include <sched.h>
+#include <time.h>
+
+#include "pipeline.h"
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+const char* pipeline_stage_name(pipeline_stage stage) {
+    switch (stage) {
+    case STAGE_DECODE:
+        return "decode";
+    case STAGE_FLATTEN:
+        return "flatten";
+    case STAGE_RASTER:
+        return "raster";
+    case STAGE_SINK:
+        return "sink";
+    default:
+        return "unknown";
+    }
+}
+
+static int init_stage_queue(stage_queue *queue, bool single, size_t capacity) {
+    queue->single = single;
+    return single ? init_spsc_queue(&queue->spsc, capacity) : init_mpmc_queue(&queue->mpmc, capacity);
+}
+
+static void free_stage_queue(stage_queue *queue) {
+    if (queue->single) {
+        free_spsc_queue(&queue->spsc);
+    } else {
+        free_mpmc_queue(&queue->mpmc);
+    }
+}
+
+static bool queue_push(stage_queue *queue, render_job *job) {
+    return queue->single ? spsc_push(&queue->spsc, job) : mpmc_push(&queue->mpmc, job);
+}
+
+static bool queue_pop(stage_queue *queue, render_job **job) {
+    return queue->single ? spsc_pop(&queue->spsc, (void**)job) : mpmc_pop(&queue->mpmc, (void**)job);
+}
+
+static uint32_t queue_pop_batch(stage_queue *queue, render_job **jobs, uint32_t max) {
+    uint32_t count = 0;
+    while (count < max && queue_pop(queue, &jobs[count])) {
+        count++;
+    }
+    return count;
+}
+
+// a full queue is backpressure: the producer waits and the wait is booked as a stall
+static void push_blocking(stage_queue *queue, render_job *job, atomic_uint_fast64_t *stall_ns) {
+    if (queue_push(queue, job)) {
+        return;
+    }
+    uint64_t start = now_ns();
+    while (!queue_push(queue, job)) {
+        sched_yield();
+    }
+    atomic_fetch_add_explicit(stall_ns, now_ns() - start, memory_order_relaxed);
+}
+
+static void free_job(render_job *job) {
+    free_glyph(job->glyph);
+    free_raster_path(&job->path);
+    free_raster_bitmap(&job->bitmap);
+    free(job);
+}
+
+// simplifying and emboldening rewrite the outline, anything else flattens straight from the glyf bytes
+static bool needs_decoded_glyph(const pipeline_config *config, float ppem) {
+    return (config->simplify > 0.0f && ppem <= SIMPLIFY_MAX_PPEM) || (config->tone && config->tone->embolden);
+}
+
+static void run_stage(pipeline_worker *worker, render_job *job) {
+    render_pipeline *pipeline = worker->pipeline;
+    ttf_font *font = pipeline->font;
+
+    if (job->status) {
+        return;
+    }
+
+    switch (worker->stage) {
+    case STAGE_DECODE: {
+        if (job->glyph_index >= font->glyph_count) {
+            job->status = TTF_ERR_RANGE;
+            break;
+        }
+        uint32_t glyph_offset = font->locations[job->glyph_index];
+        uint32_t glyph_length = font->locations[job->glyph_index + 1] - glyph_offset;
+        if (needs_decoded_glyph(&pipeline->config, job->ppem)) {
+            job->status = load_glyph(&font->source, glyph_offset, glyph_length, &job->glyph, NULL);
+        } else {
+            job->status = init_glyph_iter(&font->source, glyph_offset, glyph_length, &job->outline, NULL);
+        }
+        break;
+    }
+    case STAGE_FLATTEN:
+        if (!job->glyph) {
+            if (flatten_glyph_iter(&job->outline, job->ppem, get_units_per_em(font->head), 0.0f, pipeline->config.mode, pipeline->config.tone, &job->path)) {
+                job->status = TTF_ERR_NO_MEMORY;
+            }
+            break;
+        }
+        // jobs own their decoded glyph, so it is swapped rather than cached
+        if (pipeline->config.simplify > 0.0f && job->ppem <= SIMPLIFY_MAX_PPEM) {
+            glyph_t *simple = simplify_glyph(job->glyph, pipeline->config.simplify * get_units_per_em(font->head) / job->ppem);
+            if (simple) {
+                free_glyph(job->glyph);
+                job->glyph = simple;
+            }
+        }
+        if (flatten_glyph_at(job->glyph, job->ppem, get_units_per_em(font->head), 0.0f, pipeline->config.mode, pipeline->config.tone, &job->path)) {
+            job->status = TTF_ERR_NO_MEMORY;
+        }
+        free_glyph(job->glyph);
+        job->glyph = NULL;
+        break;
+    case STAGE_RASTER:
+        if (render_path(&job->path, &worker->canvas, &job->bitmap)) {
+            job->status = TTF_ERR_NO_MEMORY;
+        }
+        free_raster_path(&job->path);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* stage_main(void *arg) {
+    pipeline_worker *worker = arg;
+    render_pipeline *pipeline = worker->pipeline;
+    pipeline_stage stage = worker->stage;
+    stage_queue *input = &pipeline->queues[stage];
+    stage_counters *counters = &pipeline->counters[stage];
+    // without room for a batch the worker still drains its queue one job at a time
+    render_job *single = NULL;
+    uint32_t batch_size = pipeline->config.batch_size;
+    render_job **batch = malloc(batch_size * sizeof(render_job*));
+    if (!batch) {
+        batch = &single;
+        batch_size = 1;
+    }
+
+    for (;;) {
+        uint32_t count = queue_pop_batch(input, batch, batch_size);
+        if (count == 0) {
+            // closed is checked before the final pop so no item pushed before closing is lost
+            if (atomic_load_explicit(&pipeline->closed[stage], memory_order_acquire)) {
+                count = queue_pop_batch(input, batch, batch_size);
+                if (count == 0) {
+                    break;
+                }
+            } else {
+                uint64_t start = now_ns();
+                sched_yield();
+                atomic_fetch_add_explicit(&counters->starve_ns, now_ns() - start, memory_order_relaxed);
+                continue;
+            }
+        }
+
+        uint64_t start = now_ns();
+        for (uint32_t i = 0; i < count; i++) {
+            run_stage(worker, batch[i]);
+        }
+        if (stage == STAGE_SINK) {
+            for (uint32_t i = 0; i < count; i++) {
+                pipeline->sink(batch[i], pipeline->user);
+                free_job(batch[i]);
+            }
+        }
+        atomic_fetch_add_explicit(&counters->busy_ns, now_ns() - start, memory_order_relaxed);
+        atomic_fetch_add_explicit(&counters->items, count, memory_order_relaxed);
+        atomic_fetch_add_explicit(&counters->batches, 1, memory_order_relaxed);
+
+        if (stage != STAGE_SINK) {
+            for (uint32_t i = 0; i < count; i++) {
+                push_blocking(&pipeline->queues[stage + 1], batch[i], &counters->stall_ns);
+            }
+        }
+    }
+
+    // the last worker out closes the next stage's input
+    if (atomic_fetch_sub(&pipeline->active[stage], 1) == 1 && stage != STAGE_SINK) {
+        atomic_store_explicit(&pipeline->closed[stage + 1], true, memory_order_release);
+    }
+    if (batch != &single) {
+        free(batch);
+    }
+    return NULL;
+}
+
+// joins the first started workers, then frees the canvases, queues and worker array
+static void release_pipeline(render_pipeline *pipeline, uint32_t started) {
+    for (uint32_t w = 0; w < started; w++) {
+        pthread_join(pipeline->workers[w].thread, NULL);
+    }
+    for (uint32_t w = 0; pipeline->workers && w < pipeline->worker_count; w++) {
+        free_raster_canvas(&pipeline->workers[w].canvas);
+    }
+    for (uint32_t s = 0; s < STAGE_COUNT; s++) {
+        free_stage_queue(&pipeline->queues[s]);
+    }
+    free(pipeline->workers);
+    pipeline->workers = NULL;
+}
+
+void default_pipeline_config(pipeline_config *config, uint32_t threads) {
+    config->workers[STAGE_DECODE] = 1;
+    config->workers[STAGE_FLATTEN] = 1;
+    config->workers[STAGE_RASTER] = threads > 3 ? threads - 3 : 1;
+    config->workers[STAGE_SINK] = 1;
+    config->queue_capacity = PIPELINE_QUEUE_CAPACITY;
+    config->batch_size = PIPELINE_BATCH_SIZE;
+    config->mode = RASTER_FLOAT;
+    config->tone = NULL;
+    config->simplify = 0.0f;
+}
+
+int start_pipeline(render_pipeline *pipeline, ttf_font *font, const pipeline_config *config, render_sink_fn sink, void *user) {
+    memset(pipeline, 0, sizeof(render_pipeline));
+    pipeline->font = font;
+    pipeline->sink = sink;
+    pipeline->user = user;
+    pipeline->config = *config;
+    if (pipeline->config.batch_size == 0) {
+        pipeline->config.batch_size = PIPELINE_BATCH_SIZE;
+    }
+    if (pipeline->config.queue_capacity == 0) {
+        pipeline->config.queue_capacity = PIPELINE_QUEUE_CAPACITY;
+    }
+
+    for (uint32_t s = 0; s < STAGE_COUNT; s++) {
+        if (pipeline->config.workers[s] == 0) {
+            pipeline->config.workers[s] = 1;
+        }
+        pipeline->worker_count += pipeline->config.workers[s];
+    }
+
+    // the decode queue is fed by the single submitting thread
+    for (uint32_t s = 0; s < STAGE_COUNT; s++) {
+        uint32_t producers = s == 0 ? 1 : pipeline->config.workers[s - 1];
+        bool single = producers == 1 && pipeline->config.workers[s] == 1;
+        atomic_init(&pipeline->closed[s], false);
+        atomic_init(&pipeline->active[s], pipeline->config.workers[s]);
+        if (init_stage_queue(&pipeline->queues[s], single, pipeline->config.queue_capacity)) {
+            release_pipeline(pipeline, 0);
+            return -1;
+        }
+    }
+    atomic_init(&pipeline->submit_stall_ns, 0);
+
+    pipeline->workers = calloc(pipeline->worker_count, sizeof(pipeline_worker));
+    if (!pipeline->workers) {
+        release_pipeline(pipeline, 0);
+        return -1;
+    }
+    uint32_t w = 0;
+    for (uint32_t s = 0; s < STAGE_COUNT; s++) {
+        for (uint32_t i = 0; i < pipeline->config.workers[s]; i++, w++) {
+            pipeline_worker *worker = &pipeline->workers[w];
+            worker->pipeline = pipeline;
+            worker->stage = (pipeline_stage)s;
+            init_raster_canvas(&worker->canvas);
+            if (pthread_create(&worker->thread, NULL, stage_main, worker)) {
+                // with every stage closed and nothing queued the started workers drain out at once
+                for (uint32_t c = 0; c < STAGE_COUNT; c++) {
+                    atomic_store_explicit(&pipeline->closed[c], true, memory_order_release);
+                }
+                release_pipeline(pipeline, w);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+ttf_status pipeline_submit(render_pipeline *pipeline, const uint16_t *glyphs, uint32_t count, float ppem) {
+    for (uint32_t i = 0; i < count; i++) {
+        render_job *job = calloc(1, sizeof(render_job));
+        if (!job) {
+            return TTF_ERR_NO_MEMORY;
+        }
+        job->glyph_index = glyphs[i];
+        job->ppem = ppem;
+        push_blocking(&pipeline->queues[STAGE_DECODE], job, &pipeline->submit_stall_ns);
+    }
+    return TTF_OK;
+}
+
+void finish_pipeline(render_pipeline *pipeline) {
+    atomic_store_explicit(&pipeline->closed[STAGE_DECODE], true, memory_order_release);
+    release_pipeline(pipeline, pipeline->worker_count);
+}
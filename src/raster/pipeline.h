@@ -0,0 +1,94 @@
+#ifndef PIPELINE
+#define PIPELINE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "font.h"
+#include "raster.h"
+#include "simplify.h"
+#include "queue.h"
+
+#define PIPELINE_QUEUE_CAPACITY 256
+#define PIPELINE_BATCH_SIZE 16
+
+typedef enum pipeline_stage {
+    STAGE_DECODE,
+    STAGE_FLATTEN,
+    STAGE_RASTER,
+    STAGE_SINK,
+    STAGE_COUNT
+} pipeline_stage;
+
+typedef struct render_job {
+    uint16_t glyph_index;
+    float ppem;
+    ttf_status status;
+    // decoded only when the outline gets rewritten, otherwise flattened through outline
+    glyph_t *glyph;
+    glyph_iter outline;
+    raster_path path;
+    raster_bitmap bitmap;
+} render_job;
+
+// called from the sink workers, the job and its bitmap are freed when it returns
+typedef void (*render_sink_fn)(const render_job *job, void *user);
+
+typedef struct stage_counters {
+    atomic_uint_fast64_t items;
+    atomic_uint_fast64_t batches;
+    atomic_uint_fast64_t busy_ns;
+    atomic_uint_fast64_t stall_ns;
+    atomic_uint_fast64_t starve_ns;
+} stage_counters;
+
+// a queue is SPSC when a single worker sits on each side of it
+typedef struct stage_queue {
+    bool single;
+    spsc_queue spsc;
+    mpmc_queue mpmc;
+} stage_queue;
+
+typedef struct pipeline_config {
+    uint32_t workers[STAGE_COUNT];
+    uint32_t queue_capacity;
+    uint32_t batch_size;
+    raster_mode mode;
+    const raster_tone *tone;
+    // pixel tolerance for simplifying outlines up to SIMPLIFY_MAX_PPEM, 0 is off
+    float simplify;
+} pipeline_config;
+
+typedef struct pipeline_worker {
+    struct render_pipeline *pipeline;
+    pipeline_stage stage;
+    pthread_t thread;
+    raster_canvas canvas;
+} pipeline_worker;
+
+typedef struct render_pipeline {
+    ttf_font *font;
+    render_sink_fn sink;
+    void *user;
+    pipeline_config config;
+    // queues[i] feeds stage i, closed[i] is set once nothing more will arrive on it
+    stage_queue queues[STAGE_COUNT];
+    atomic_bool closed[STAGE_COUNT];
+    atomic_uint active[STAGE_COUNT];
+    stage_counters counters[STAGE_COUNT];
+    atomic_uint_fast64_t submit_stall_ns;
+    pipeline_worker *workers;
+    uint32_t worker_count;
+} render_pipeline;
+
+void default_pipeline_config(pipeline_config *config, uint32_t threads);
+int start_pipeline(render_pipeline *pipeline, ttf_font *font, const pipeline_config *config, render_sink_fn sink, void *user);
+// one submitting thread at a time; blocks while the decode queue is full. Stops
+// with TTF_ERR_NO_MEMORY when a job cannot be allocated, earlier jobs still run.
+ttf_status pipeline_submit(render_pipeline *pipeline, const uint16_t *glyphs, uint32_t count, float ppem);
+void finish_pipeline(render_pipeline *pipeline);
+const char* pipeline_stage_name(pipeline_stage stage);
+
+#endif
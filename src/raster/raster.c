@@ -0,0 +1,807 @@
+#include <math.h>
+#include <stdatomic.h>
+
+#include "raster.h"
+
+typedef struct raster_point {
+    float x;
+    float y;
+} raster_point;
+
+typedef struct raster_fixed_point {
+    int32_t x;
+    int32_t y;
+} raster_fixed_point;
+
+// point arrays of a decoded glyph, or of one contour read from a glyph_iter
+typedef struct outline_points {
+    const int16_t *x;
+    const int16_t *y;
+    const uint8_t *flags;
+} outline_points;
+
+// rounds half away from zero so results do not depend on the sign of the operands
+static int32_t mul_div_round(int64_t a, int64_t b, int64_t c) {
+    int64_t product = a * b;
+    int64_t half = c / 2;
+    return (int32_t)(product >= 0 ? (product + half) / c : -((-product + half) / c));
+}
+
+static int32_t floor_pixel(int32_t value) {
+    return value >= 0 ? value / 64 : -((-value + 63) / 64);
+}
+
+static int32_t ceil_pixel(int32_t value) {
+    return -floor_pixel(-value);
+}
+
+static uint64_t isqrt(uint64_t value) {
+    uint64_t root = (uint64_t)sqrt((double)value);
+    while (root * root > value) {
+        root--;
+    }
+    while ((root + 1) * (root + 1) <= value) {
+        root++;
+    }
+    return root;
+}
+
+void init_raster_path(raster_path *path) {
+    memset(path, 0, sizeof(raster_path));
+}
+
+void free_raster_path(raster_path *path) {
+    free(path->lines);
+    memset(path, 0, sizeof(raster_path));
+}
+
+// the path keeps its lines when growing fails, the caller gives up on it
+static int add_line(raster_path *path, raster_point a, raster_point b) {
+    // horizontal lines carry no coverage
+    if (a.y == b.y) {
+        return 0;
+    }
+    if (path->count == path->capacity) {
+        uint32_t capacity = path->capacity ? path->capacity * 2 : 64;
+        raster_line *lines = realloc(path->lines, capacity * sizeof(raster_line));
+        if (!lines) {
+            return -1;
+        }
+        path->lines = lines;
+        path->capacity = capacity;
+    }
+    path->lines[path->count++] = (raster_line){ a.x, a.y, b.x, b.y };
+    return 0;
+}
+
+static raster_point midpoint(raster_point a, raster_point b) {
+    return (raster_point){ (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f };
+}
+
+static int add_quad(raster_path *path, raster_point p0, raster_point p1, raster_point p2) {
+    float ddx = p0.x - 2.0f * p1.x + p2.x;
+    float ddy = p0.y - 2.0f * p1.y + p2.y;
+    float devsq = ddx * ddx + ddy * ddy;
+    if (devsq < 0.333f) {
+        return add_line(path, p0, p2);
+    }
+
+    uint32_t segments = 1 + (uint32_t)floorf(sqrtf(sqrtf(RASTER_CURVE_TOLERANCE * devsq)));
+    raster_point previous = p0;
+    for (uint32_t i = 1; i <= segments; i++) {
+        float t = (float)i / segments;
+        float mt = 1.0f - t;
+        raster_point next = {
+            mt * mt * p0.x + 2.0f * mt * t * p1.x + t * t * p2.x,
+            mt * mt * p0.y + 2.0f * mt * t * p1.y + t * t * p2.y
+        };
+        if (add_line(path, previous, next)) {
+            return -1;
+        }
+        previous = next;
+    }
+    return 0;
+}
+
+// TrueType contours may start off-curve and imply on-curve points between consecutive off-curve ones
+static int flatten_contour(const outline_points *points, uint16_t start, uint16_t end, float scale, float x_shift, raster_path *path) {
+    uint16_t count = end - start + 1;
+    #define POINT(i) ((raster_point){ points->x[i] * scale + x_shift - path->left, path->top - points->y[i] * scale })
+    #define ON_CURVE(i) (points->flags[i] & ON_CURVE_POINT)
+
+    int32_t first = -1;
+    for (uint16_t i = start; i <= end; i++) {
+        if (ON_CURVE(i)) {
+            first = i;
+            break;
+        }
+    }
+
+    raster_point current, origin, control = {0};
+    uint16_t begin;
+    if (first >= 0) {
+        begin = (uint16_t)first;
+        current = POINT(first);
+    } else {
+        begin = end;
+        current = midpoint(POINT(start), POINT(end));
+    }
+    origin = current;
+
+    bool has_control = false;
+    for (uint16_t j = 1; j <= count; j++) {
+        uint16_t index = start + (begin - start + j) % count;
+        raster_point point = POINT(index);
+        if (ON_CURVE(index)) {
+            if (has_control ? add_quad(path, current, control, point) : add_line(path, current, point)) {
+                return -1;
+            }
+            current = point;
+            has_control = false;
+        } else {
+            if (has_control) {
+                raster_point implied = midpoint(control, point);
+                if (add_quad(path, current, control, implied)) {
+                    return -1;
+                }
+                current = implied;
+            }
+            control = point;
+            has_control = true;
+        }
+    }
+
+    int result = has_control ? add_quad(path, current, control, origin) : add_line(path, current, origin);
+
+    #undef POINT
+    #undef ON_CURVE
+    return result;
+}
+
+static void place_path(raster_path *path, int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax, float scale, float x_shift) {
+    path->mode = RASTER_FLOAT;
+    path->count = 0;
+    path->left = (int32_t)floorf(xMin * scale + x_shift);
+    path->top = (int32_t)ceilf(yMax * scale);
+    int32_t right = (int32_t)ceilf(xMax * scale + x_shift);
+    int32_t bottom = (int32_t)floorf(yMin * scale);
+    path->width = right > path->left ? (uint32_t)(right - path->left) : 1;
+    path->height = path->top > bottom ? (uint32_t)(path->top - bottom) : 1;
+}
+
+int flatten_glyph(const glyph_t *glyph, float scale, float x_shift, raster_path *path) {
+    place_path(path, glyph->xMin, glyph->yMin, glyph->xMax, glyph->yMax, scale, x_shift);
+
+    outline_points points = { glyph->x_poss, glyph->y_poss, glyph->flags };
+    uint16_t start = 0;
+    for (int16_t c = 0; c < glyph->numberOfContours; c++) {
+        uint16_t end = ntohs(glyph->endPtsOfContours[c]);
+        if (end >= glyph->count || end < start) {
+            break;
+        }
+        if (flatten_contour(&points, start, end, scale, x_shift, path)) {
+            return -1;
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+static int add_fixed_line(raster_path *path, raster_fixed_point a, raster_fixed_point b) {
+    if (a.y == b.y) {
+        return 0;
+    }
+    if (path->count == path->capacity) {
+        uint32_t capacity = path->capacity ? path->capacity * 2 : 64;
+        raster_fixed_line *lines = realloc(path->fixed_lines, capacity * sizeof(raster_fixed_line));
+        if (!lines) {
+            return -1;
+        }
+        path->fixed_lines = lines;
+        path->capacity = capacity;
+    }
+    path->fixed_lines[path->count++] = (raster_fixed_line){ a.x, a.y, b.x, b.y };
+    return 0;
+}
+
+static raster_fixed_point fixed_midpoint(raster_fixed_point a, raster_fixed_point b) {
+    return (raster_fixed_point){ (a.x + b.x) / 2, (a.y + b.y) / 2 };
+}
+
+// same subdivision rule as add_quad, evaluated exactly in integers
+static int add_fixed_quad(raster_path *path, raster_fixed_point p0, raster_fixed_point p1, raster_fixed_point p2) {
+    int64_t ddx = p0.x - 2 * p1.x + p2.x;
+    int64_t ddy = p0.y - 2 * p1.y + p2.y;
+    uint64_t devsq = (uint64_t)(ddx * ddx + ddy * ddy);
+    if (devsq * 3 < RASTER_FIXED_ONE) {
+        return add_fixed_line(path, p0, p2);
+    }
+
+    int64_t segments = 1 + (int64_t)isqrt(isqrt(devsq * (uint64_t)RASTER_CURVE_TOLERANCE / RASTER_FIXED_ONE));
+    int64_t nn = segments * segments;
+    raster_fixed_point previous = p0;
+    for (int64_t i = 1; i <= segments; i++) {
+        int64_t a = (segments - i) * (segments - i);
+        int64_t b = 2 * i * (segments - i);
+        int64_t c = i * i;
+        raster_fixed_point next = {
+            mul_div_round(a * p0.x + b * p1.x + c * p2.x, 1, nn),
+            mul_div_round(a * p0.y + b * p1.y + c * p2.y, 1, nn)
+        };
+        if (add_fixed_line(path, previous, next)) {
+            return -1;
+        }
+        previous = next;
+    }
+    return 0;
+}
+
+static int flatten_contour_fixed(const outline_points *points, uint16_t start, uint16_t end,
+                                  int32_t ppem_26_6, uint16_t units_per_em, int32_t x_shift_26_6, raster_path *path) {
+    uint16_t count = end - start + 1;
+    #define POINT(i) ((raster_fixed_point){ \
+        mul_div_round(points->x[i], ppem_26_6, units_per_em) + x_shift_26_6 - path->left * 64, \
+        path->top * 64 - mul_div_round(points->y[i], ppem_26_6, units_per_em) })
+    #define ON_CURVE(i) (points->flags[i] & ON_CURVE_POINT)
+
+    int32_t first = -1;
+    for (uint16_t i = start; i <= end; i++) {
+        if (ON_CURVE(i)) {
+            first = i;
+            break;
+        }
+    }
+
+    raster_fixed_point current, origin, control = {0};
+    uint16_t begin;
+    if (first >= 0) {
+        begin = (uint16_t)first;
+        current = POINT(first);
+    } else {
+        begin = end;
+        current = fixed_midpoint(POINT(start), POINT(end));
+    }
+    origin = current;
+
+    bool has_control = false;
+    for (uint16_t j = 1; j <= count; j++) {
+        uint16_t index = start + (begin - start + j) % count;
+        raster_fixed_point point = POINT(index);
+        if (ON_CURVE(index)) {
+            if (has_control ? add_fixed_quad(path, current, control, point) : add_fixed_line(path, current, point)) {
+                return -1;
+            }
+            current = point;
+            has_control = false;
+        } else {
+            if (has_control) {
+                raster_fixed_point implied = fixed_midpoint(control, point);
+                if (add_fixed_quad(path, current, control, implied)) {
+                    return -1;
+                }
+                current = implied;
+            }
+            control = point;
+            has_control = true;
+        }
+    }
+
+    int result = has_control ? add_fixed_quad(path, current, control, origin) : add_fixed_line(path, current, origin);
+
+    #undef POINT
+    #undef ON_CURVE
+    return result;
+}
+
+static void place_path_fixed(raster_path *path, int16_t xMin, int16_t yMin, int16_t xMax, int16_t yMax,
+                             int32_t ppem_26_6, uint16_t units_per_em, int32_t x_shift_26_6) {
+    path->mode = RASTER_FIXED;
+    path->count = 0;
+    path->left = floor_pixel(mul_div_round(xMin, ppem_26_6, units_per_em) + x_shift_26_6);
+    path->top = ceil_pixel(mul_div_round(yMax, ppem_26_6, units_per_em));
+    int32_t right = ceil_pixel(mul_div_round(xMax, ppem_26_6, units_per_em) + x_shift_26_6);
+    int32_t bottom = floor_pixel(mul_div_round(yMin, ppem_26_6, units_per_em));
+    path->width = right > path->left ? (uint32_t)(right - path->left) : 1;
+    path->height = path->top > bottom ? (uint32_t)(path->top - bottom) : 1;
+}
+
+// Font units are scaled to F26.6 with one rounded multiply-divide per coordinate,
+// so the same glyph and ppem give the same lines on every machine.
+int flatten_glyph_fixed(const glyph_t *glyph, int32_t ppem_26_6, uint16_t units_per_em, int32_t x_shift_26_6, raster_path *path) {
+    place_path_fixed(path, glyph->xMin, glyph->yMin, glyph->xMax, glyph->yMax, ppem_26_6, units_per_em, x_shift_26_6);
+
+    outline_points points = { glyph->x_poss, glyph->y_poss, glyph->flags };
+    uint16_t start = 0;
+    for (int16_t c = 0; c < glyph->numberOfContours; c++) {
+        uint16_t end = ntohs(glyph->endPtsOfContours[c]);
+        if (end >= glyph->count || end < start) {
+            break;
+        }
+        if (flatten_contour_fixed(&points, start, end, ppem_26_6, units_per_em, x_shift_26_6, path)) {
+            return -1;
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+int flatten_glyph_at(const glyph_t *glyph, float ppem, uint16_t units_per_em, float x_shift,
+                      raster_mode mode, const raster_tone *tone, raster_path *path) {
+    glyph_t *bold = NULL;
+    float strength = tone && tone->embolden ? stem_darkening_strength(ppem) : 0.0f;
+    if (strength > 0.0f) {
+        bold = embolden_glyph(glyph, strength * units_per_em / ppem);
+        glyph = bold ? bold : glyph;
+    }
+
+    int result;
+    if (mode == RASTER_FIXED) {
+        result = flatten_glyph_fixed(glyph, (int32_t)lroundf(ppem * 64.0f), units_per_em, (int32_t)lroundf(x_shift * 64.0f), path);
+    } else {
+        result = flatten_glyph(glyph, ppem / units_per_em, x_shift, path);
+    }
+    path->tone = tone;
+    free_glyph(bold);
+    return result;
+}
+
+// contours are gathered whole, a contour may open off-curve and close on its first point
+int flatten_glyph_iter(glyph_iter *iter, float ppem, uint16_t units_per_em, float x_shift,
+                       raster_mode mode, const raster_tone *tone, raster_path *path) {
+    float scale = ppem / units_per_em;
+    int32_t ppem_26_6 = (int32_t)lroundf(ppem * 64.0f);
+    int32_t x_shift_26_6 = (int32_t)lroundf(x_shift * 64.0f);
+    if (mode == RASTER_FIXED) {
+        place_path_fixed(path, iter->xMin, iter->yMin, iter->xMax, iter->yMax, ppem_26_6, units_per_em, x_shift_26_6);
+    } else {
+        place_path(path, iter->xMin, iter->yMin, iter->xMax, iter->yMax, scale, x_shift);
+    }
+    path->tone = tone;
+
+    // only contours longer than the stack buffers go to the heap
+    int16_t stack_x[RASTER_CONTOUR_POINTS], stack_y[RASTER_CONTOUR_POINTS];
+    uint8_t stack_flags[RASTER_CONTOUR_POINTS];
+    int16_t *xs = stack_x, *ys = stack_y;
+    uint8_t *flags = stack_flags;
+    void *heap = NULL;
+    uint32_t capacity = RASTER_CONTOUR_POINTS, count = 0;
+
+    int result = 0;
+    glyph_point point;
+    while (!result && next_glyph_point(iter, &point)) {
+        if (count == capacity) {
+            uint32_t grown_capacity = capacity * 2;
+            int16_t *grown = malloc(grown_capacity * (2 * sizeof(int16_t) + 1));
+            if (!grown) {
+                result = -1;
+                break;
+            }
+            memcpy(grown, xs, count * sizeof(int16_t));
+            memcpy(grown + grown_capacity, ys, count * sizeof(int16_t));
+            memcpy(grown + 2 * grown_capacity, flags, count);
+            free(heap);
+            heap = grown;
+            capacity = grown_capacity;
+            xs = grown;
+            ys = grown + capacity;
+            flags = (uint8_t*)(grown + 2 * capacity);
+        }
+        xs[count] = point.x;
+        ys[count] = point.y;
+        flags[count] = point.on_curve ? ON_CURVE_POINT : 0;
+        count++;
+
+        if (point.contour_end) {
+            outline_points points = { xs, ys, flags };
+            result = mode == RASTER_FIXED
+                     ? flatten_contour_fixed(&points, 0, (uint16_t)(count - 1), ppem_26_6, units_per_em, x_shift_26_6, path)
+                     : flatten_contour(&points, 0, (uint16_t)(count - 1), scale, x_shift, path);
+            count = 0;
+        }
+    }
+
+    free(heap);
+    return result;
+}
+
+void init_raster_canvas(raster_canvas *canvas) {
+    memset(canvas, 0, sizeof(raster_canvas));
+}
+
+void free_raster_canvas(raster_canvas *canvas) {
+    free(canvas->accum);
+    free(canvas->cover);
+    memset(canvas, 0, sizeof(raster_canvas));
+}
+
+int reset_raster_canvas(raster_canvas *canvas, raster_mode mode, uint32_t width, uint32_t height) {
+    size_t cells = (size_t)width * height + 2;
+    if (mode == RASTER_FIXED) {
+        if (cells > canvas->cover_capacity) {
+            free(canvas->cover);
+            canvas->cover_capacity = 0;
+            if (!(canvas->cover = malloc(cells * sizeof(int32_t)))) {
+                return -1;
+            }
+            canvas->cover_capacity = cells;
+        }
+        memset(canvas->cover, 0, cells * sizeof(int32_t));
+    } else {
+        if (cells > canvas->capacity) {
+            free(canvas->accum);
+            canvas->capacity = 0;
+            if (!(canvas->accum = malloc(cells * sizeof(float)))) {
+                return -1;
+            }
+            canvas->capacity = cells;
+        }
+        memset(canvas->accum, 0, cells * sizeof(float));
+    }
+    canvas->width = width;
+    canvas->height = height;
+    return 0;
+}
+
+// Each line adds the signed area it covers to the cells it crosses; a prefix sum over
+// the buffer in resolve_coverage then yields the coverage of every pixel.
+void accumulate_line(raster_canvas *canvas, float x0, float y0, float x1, float y1) {
+    if (y0 == y1) {
+        return;
+    }
+
+    float dir = 1.0f;
+    if (y0 > y1) {
+        dir = -1.0f;
+        float t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float x = x0;
+    if (y0 < 0.0f) {
+        x -= y0 * dxdy;
+    }
+
+    uint32_t width = canvas->width;
+    float *accum = canvas->accum;
+    int32_t y_start = y0 > 0.0f ? (int32_t)y0 : 0;
+    int32_t y_end = (int32_t)ceilf(y1);
+    if (y_end > (int32_t)canvas->height) {
+        y_end = (int32_t)canvas->height;
+    }
+
+    for (int32_t y = y_start; y < y_end; y++) {
+        size_t line = (size_t)y * width;
+        float dy = fminf((float)(y + 1), y1) - fmaxf((float)y, y0);
+        float x_next = x + dxdy * dy;
+        float d = dy * dir;
+
+        float left = fmaxf(fminf(x, x_next), 0.0f);
+        float right = fminf(fmaxf(x, x_next), (float)width);
+        float left_floor = floorf(left);
+        int32_t left_i = (int32_t)left_floor;
+        float right_ceil = ceilf(right);
+        int32_t right_i = (int32_t)right_ceil;
+
+        if (right_i <= left_i + 1) {
+            float xmf = 0.5f * (left + right) - left_floor;
+            accum[line + left_i] += d - d * xmf;
+            accum[line + left_i + 1] += d * xmf;
+        } else {
+            float s = 1.0f / (right - left);
+            float left_f = left - left_floor;
+            float a0 = 0.5f * s * (1.0f - left_f) * (1.0f - left_f);
+            float right_f = right - right_ceil + 1.0f;
+            float am = 0.5f * s * right_f * right_f;
+
+            accum[line + left_i] += d * a0;
+            if (right_i == left_i + 2) {
+                accum[line + left_i + 1] += d * (1.0f - a0 - am);
+            } else {
+                float a1 = s * (1.5f - left_f);
+                accum[line + left_i + 1] += d * (a1 - a0);
+                for (int32_t xi = left_i + 2; xi < right_i - 1; xi++) {
+                    accum[line + xi] += d * s;
+                }
+                float a2 = a1 + (right_i - left_i - 3) * s;
+                accum[line + right_i - 1] += d * (1.0f - a2 - am);
+            }
+            accum[line + right_i] += d * am;
+        }
+        x = x_next;
+    }
+}
+
+// Splits one scanline's piece of a line at every pixel boundary; each piece adds its
+// trapezoid area to its cell and the remainder to the next, summing to dy * 64.
+static void accumulate_row_fixed(int32_t *cells, int32_t xa, int32_t xb, int32_t dy, int32_t dir, int32_t width64) {
+    xa = xa < 0 ? 0 : (xa > width64 ? width64 : xa);
+    xb = xb < 0 ? 0 : (xb > width64 ? width64 : xb);
+    if (xa > xb) {
+        int32_t t = xa; xa = xb; xb = t;
+    }
+
+    if (xa == xb) {
+        int32_t cell = xa >> 6;
+        int32_t fx = xa - cell * 64;
+        int32_t d = dy * dir;
+        int32_t spill = d * fx;
+        cells[cell] += d * 64 - spill;
+        cells[cell + 1] += spill;
+        return;
+    }
+
+    int32_t x = xa;
+    int32_t y = 0;
+    while (x < xb) {
+        int32_t cell = x >> 6;
+        int32_t x_next = (cell + 1) * 64 < xb ? (cell + 1) * 64 : xb;
+        int32_t y_next = mul_div_round(x_next - xa, dy, xb - xa);
+        int32_t d = (y_next - y) * dir;
+        int32_t spill = d * (x - cell * 64 + x_next - cell * 64) / 2;
+        cells[cell] += d * 64 - spill;
+        cells[cell + 1] += spill;
+        x = x_next;
+        y = y_next;
+    }
+}
+
+void accumulate_line_fixed(raster_canvas *canvas, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    if (y0 == y1) {
+        return;
+    }
+
+    int32_t dir = 1;
+    if (y0 > y1) {
+        dir = -1;
+        int32_t t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    int32_t width64 = (int32_t)canvas->width * 64;
+    int32_t y_start = y0 > 0 ? y0 : 0;
+    int32_t y_end = y1 < (int32_t)canvas->height * 64 ? y1 : (int32_t)canvas->height * 64;
+
+    // x is always evaluated at the same scanline boundaries so adjacent rows agree exactly
+    for (int32_t row = y_start >> 6; row * 64 < y_end; row++) {
+        int32_t top = row * 64 > y0 ? row * 64 : y0;
+        int32_t bottom = row * 64 + 64 < y1 ? row * 64 + 64 : y1;
+        if (top >= bottom) {
+            continue;
+        }
+        int32_t xa = x0 + mul_div_round(x1 - x0, top - y0, y1 - y0);
+        int32_t xb = x0 + mul_div_round(x1 - x0, bottom - y0, y1 - y0);
+        accumulate_row_fixed(canvas->cover + (size_t)row * canvas->width, xa, xb, bottom - top, dir, width64);
+    }
+}
+
+void resolve_coverage_fixed(const raster_canvas *canvas, const uint8_t *lut, uint8_t *pixels) {
+    size_t cells = (size_t)canvas->width * canvas->height;
+    int32_t sum = 0;
+    for (size_t i = 0; i < cells; i++) {
+        sum += canvas->cover[i];
+        int32_t coverage = sum < 0 ? -sum : sum;
+        coverage = coverage < RASTER_FIXED_ONE ? coverage : RASTER_FIXED_ONE;
+        uint8_t value = (uint8_t)((coverage * 255 + RASTER_FIXED_ONE / 2) / RASTER_FIXED_ONE);
+        pixels[i] = lut ? lut[value] : value;
+    }
+}
+
+void resolve_coverage(const raster_canvas *canvas, const uint8_t *lut, uint8_t *pixels) {
+    size_t cells = (size_t)canvas->width * canvas->height;
+    float sum = 0.0f;
+    for (size_t i = 0; i < cells; i++) {
+        sum += canvas->accum[i];
+        float coverage = fminf(fabsf(sum), 1.0f);
+        uint8_t value = (uint8_t)(coverage * 255.0f + 0.5f);
+        pixels[i] = lut ? lut[value] : value;
+    }
+}
+
+int render_path(const raster_path *path, raster_canvas *canvas, raster_bitmap *bitmap) {
+    bitmap->width = path->width;
+    bitmap->height = path->height;
+    bitmap->left = path->left;
+    bitmap->top = path->top;
+    bitmap->pixels = malloc((size_t)path->width * path->height);
+    if (!bitmap->pixels) {
+        return -1;
+    }
+
+    const uint8_t *lut = path->tone ? path->tone->lut : NULL;
+    if (reset_raster_canvas(canvas, path->mode, path->width, path->height)) {
+        free_raster_bitmap(bitmap);
+        return -1;
+    }
+    if (path->mode == RASTER_FIXED) {
+        for (uint32_t i = 0; i < path->count; i++) {
+            const raster_fixed_line *line = &path->fixed_lines[i];
+            accumulate_line_fixed(canvas, line->x0, line->y0, line->x1, line->y1);
+        }
+        resolve_coverage_fixed(canvas, lut, bitmap->pixels);
+    } else {
+        for (uint32_t i = 0; i < path->count; i++) {
+            const raster_line *line = &path->lines[i];
+            accumulate_line(canvas, line->x0, line->y0, line->x1, line->y1);
+        }
+        resolve_coverage(canvas, lut, bitmap->pixels);
+    }
+    return 0;
+}
+
+void free_raster_bitmap(raster_bitmap *bitmap) {
+    free(bitmap->pixels);
+    bitmap->pixels = NULL;
+}
+
+typedef struct band_job {
+    const raster_path *path;
+    uint32_t band_height;
+    uint32_t first_band;
+    uint32_t *band_starts;
+    uint32_t *band_lines;
+    raster_canvas *canvases;
+    uint8_t **pixels;
+    atomic_bool failed;
+} band_job;
+
+static uint32_t band_rows(const raster_path *path, uint32_t band_height, uint32_t band) {
+    uint32_t y = band * band_height;
+    return path->height - y < band_height ? path->height - y : band_height;
+}
+
+static void render_band_range(uint32_t begin, uint32_t end, void *arg) {
+    band_job *job = arg;
+    for (uint32_t slot = begin; slot < end; slot++) {
+        uint32_t band = job->first_band + slot;
+        uint32_t y_offset = band * job->band_height;
+        raster_canvas *canvas = &job->canvases[slot];
+        const raster_path *path = job->path;
+        const uint8_t *lut = path->tone ? path->tone->lut : NULL;
+
+        if (reset_raster_canvas(canvas, path->mode, path->width, band_rows(path, job->band_height, band))) {
+            atomic_store_explicit(&job->failed, true, memory_order_relaxed);
+            continue;
+        }
+        if (path->mode == RASTER_FIXED) {
+            int32_t offset = (int32_t)y_offset * 64;
+            for (uint32_t i = job->band_starts[band]; i < job->band_starts[band + 1]; i++) {
+                const raster_fixed_line *line = &path->fixed_lines[job->band_lines[i]];
+                accumulate_line_fixed(canvas, line->x0, line->y0 - offset, line->x1, line->y1 - offset);
+            }
+            resolve_coverage_fixed(canvas, lut, job->pixels[slot]);
+        } else {
+            float offset = (float)y_offset;
+            for (uint32_t i = job->band_starts[band]; i < job->band_starts[band + 1]; i++) {
+                const raster_line *line = &path->lines[job->band_lines[i]];
+                accumulate_line(canvas, line->x0, line->y0 - offset, line->x1, line->y1 - offset);
+            }
+            resolve_coverage(canvas, lut, job->pixels[slot]);
+        }
+    }
+}
+
+// Lines are binned into every band they touch, then bands are rasterized a window at a time
+// and handed to the sink in order, so at most one window of rows is ever resident.
+int render_path_banded(const raster_path *path, uint32_t band_height, thread_pool *pool, band_sink_fn sink, void *user) {
+    if (band_height == 0) {
+        band_height = RASTER_BAND_HEIGHT;
+    }
+    uint32_t band_count = (path->height + band_height - 1) / band_height;
+    uint32_t window = pool ? pool->worker_count * 2 : 1;
+    if (window > band_count) {
+        window = band_count;
+    }
+
+    band_job job = { .path = path, .band_height = band_height };
+    atomic_init(&job.failed, false);
+    job.band_starts = calloc(band_count + 1, sizeof(uint32_t));
+    if (!job.band_starts) {
+        return -1;
+    }
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        uint32_t *cursor = NULL;
+        if (pass == 1) {
+            for (uint32_t b = 0; b < band_count; b++) {
+                job.band_starts[b + 1] += job.band_starts[b];
+            }
+            job.band_lines = malloc((job.band_starts[band_count] + 1) * sizeof(uint32_t));
+            cursor = malloc((band_count + 1) * sizeof(uint32_t));
+            if (!job.band_lines || !cursor) {
+                free(cursor);
+                free(job.band_lines);
+                free(job.band_starts);
+                return -1;
+            }
+            memcpy(cursor, job.band_starts, band_count * sizeof(uint32_t));
+        }
+
+        for (uint32_t i = 0; i < path->count; i++) {
+            float top, bottom;
+            if (path->mode == RASTER_FIXED) {
+                const raster_fixed_line *line = &path->fixed_lines[i];
+                top = (line->y0 < line->y1 ? line->y0 : line->y1) / 64.0f;
+                bottom = (line->y0 > line->y1 ? line->y0 : line->y1) / 64.0f;
+            } else {
+                const raster_line *line = &path->lines[i];
+                top = fminf(line->y0, line->y1);
+                bottom = fmaxf(line->y0, line->y1);
+            }
+            top = fmaxf(top, 0.0f);
+            bottom = fminf(bottom, (float)path->height);
+            if (top >= bottom) {
+                continue;
+            }
+            uint32_t first = (uint32_t)top / band_height;
+            uint32_t last = ((uint32_t)ceilf(bottom) - 1) / band_height;
+            for (uint32_t b = first; b <= last && b < band_count; b++) {
+                if (pass == 0) {
+                    job.band_starts[b + 1]++;
+                } else {
+                    job.band_lines[cursor[b]++] = i;
+                }
+            }
+        }
+        free(cursor);
+    }
+
+    // a window of canvases and band buffers is the only per-render memory besides the bins
+    int result = 0;
+    job.canvases = calloc(window, sizeof(raster_canvas));
+    job.pixels = calloc(window, sizeof(uint8_t*));
+    if (!job.canvases || !job.pixels) {
+        result = -1;
+    }
+    for (uint32_t slot = 0; slot < window && result == 0; slot++) {
+        if (!(job.pixels[slot] = malloc((size_t)path->width * band_height))) {
+            result = -1;
+        }
+    }
+
+    for (uint32_t band = 0; band < band_count && result == 0; band += window) {
+        uint32_t slots = band_count - band < window ? band_count - band : window;
+        job.first_band = band;
+        parallel_for(pool, 0, slots, 1, render_band_range, &job);
+        if (atomic_load_explicit(&job.failed, memory_order_relaxed)) {
+            result = -1;
+            break;
+        }
+
+        for (uint32_t slot = 0; slot < slots && result == 0; slot++) {
+            uint32_t y = (band + slot) * band_height;
+            result = sink(job.pixels[slot], y, band_rows(path, band_height, band + slot), path->width, user);
+        }
+    }
+
+    for (uint32_t slot = 0; slot < window && job.canvases && job.pixels; slot++) {
+        free_raster_canvas(&job.canvases[slot]);
+        free(job.pixels[slot]);
+    }
+    free(job.canvases);
+    free(job.pixels);
+    free(job.band_starts);
+    free(job.band_lines);
+    return result;
+}
+
+static int copy_band(const uint8_t *pixels, uint32_t y, uint32_t rows, uint32_t width, void *user) {
+    raster_bitmap *bitmap = user;
+    memcpy(bitmap->pixels + (size_t)y * width, pixels, (size_t)rows * width);
+    return 0;
+}
+
+int render_path_tiled(const raster_path *path, uint32_t band_height, thread_pool *pool, raster_bitmap *bitmap) {
+    bitmap->width = path->width;
+    bitmap->height = path->height;
+    bitmap->left = path->left;
+    bitmap->top = path->top;
+    bitmap->pixels = malloc((size_t)path->width * path->height);
+    if (!bitmap->pixels) {
+        return -1;
+    }
+    if (render_path_banded(path, band_height, pool, copy_band, bitmap)) {
+        free_raster_bitmap(bitmap);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#ifndef RASTER
+#define RASTER
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "glyph.h"
+#include "pool.h"
+#include "tone.h"
+
+#define RASTER_BAND_HEIGHT 64
+
+// flattening tolerance for quadratic segments, in squared pixels
+#define RASTER_CURVE_TOLERANCE 3.0f
+
+// 26.6 coverage of a fully covered pixel, 64 * 64
+#define RASTER_FIXED_ONE 4096
+
+// contour points flatten_glyph_iter gathers on the stack before it needs the heap
+#define RASTER_CONTOUR_POINTS 256
+
+typedef enum raster_mode {
+    RASTER_FLOAT,
+    RASTER_FIXED
+} raster_mode;
+
+typedef struct raster_line {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+} raster_line;
+
+// F26.6 pixel coordinates
+typedef struct raster_fixed_line {
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+} raster_fixed_line;
+
+// Lines are in bitmap pixels with y pointing down; left and top place the
+// bitmap relative to the glyph origin the way FreeType's bitmap_left/top do.
+// A tone, when set, is applied to coverage by every resolve of the path.
+typedef struct raster_path {
+    raster_mode mode;
+    const raster_tone *tone;
+    union {
+        raster_line *lines;
+        raster_fixed_line *fixed_lines;
+    };
+    uint32_t count;
+    uint32_t capacity;
+    int32_t left;
+    int32_t top;
+    uint32_t width;
+    uint32_t height;
+} raster_path;
+
+typedef struct raster_bitmap {
+    uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    int32_t left;
+    int32_t top;
+} raster_bitmap;
+
+// signed area accumulation buffers, one spare cell for the rightmost spill;
+// cover holds the fixed path's integer areas in RASTER_FIXED_ONE units
+typedef struct raster_canvas {
+    float *accum;
+    int32_t *cover;
+    size_t cover_capacity;
+    uint32_t width;
+    uint32_t height;
+    size_t capacity;
+} raster_canvas;
+
+// receives rows [y, y + rows) of a banded render, always in top to bottom order
+typedef int (*band_sink_fn)(const uint8_t *pixels, uint32_t y, uint32_t rows, uint32_t width, void *user);
+
+void init_raster_path(raster_path *path);
+void free_raster_path(raster_path *path);
+// The flatteners return -1 when the path cannot grow, its lines are then incomplete.
+// x_shift moves the outline right by a fraction of a pixel before it is placed on the grid
+int flatten_glyph(const glyph_t *glyph, float scale, float x_shift, raster_path *path);
+int flatten_glyph_fixed(const glyph_t *glyph, int32_t ppem_26_6, uint16_t units_per_em, int32_t x_shift_26_6, raster_path *path);
+// tone may be NULL; with emboldening on, the outline is darkened for ppem before flattening
+int flatten_glyph_at(const glyph_t *glyph, float ppem, uint16_t units_per_em, float x_shift,
+                      raster_mode mode, const raster_tone *tone, raster_path *path);
+// Flattens a simple glyph straight from its glyf bytes, giving the same lines as
+// flatten_glyph_at on the decoded glyph; the outline is never emboldened.
+int flatten_glyph_iter(glyph_iter *iter, float ppem, uint16_t units_per_em, float x_shift,
+                       raster_mode mode, const raster_tone *tone, raster_path *path);
+
+void init_raster_canvas(raster_canvas *canvas);
+void free_raster_canvas(raster_canvas *canvas);
+// -1 when the buffers cannot grow
+int reset_raster_canvas(raster_canvas *canvas, raster_mode mode, uint32_t width, uint32_t height);
+void accumulate_line(raster_canvas *canvas, float x0, float y0, float x1, float y1);
+void accumulate_line_fixed(raster_canvas *canvas, int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+// lut is a tone's table or NULL for linear coverage
+void resolve_coverage(const raster_canvas *canvas, const uint8_t *lut, uint8_t *pixels);
+void resolve_coverage_fixed(const raster_canvas *canvas, const uint8_t *lut, uint8_t *pixels);
+
+int render_path(const raster_path *path, raster_canvas *canvas, raster_bitmap *bitmap);
+void free_raster_bitmap(raster_bitmap *bitmap);
+
+int render_path_banded(const raster_path *path, uint32_t band_height, thread_pool *pool, band_sink_fn sink, void *user);
+int render_path_tiled(const raster_path *path, uint32_t band_height, thread_pool *pool, raster_bitmap *bitmap);
+
+#endif
@@ -0,0 +1,219 @@
+#include <math.h>
+
+#include "simplify.h"
+
+typedef struct simplify_point {
+    float x;
+    float y;
+    bool on;
+} simplify_point;
+
+static float segment_distance(simplify_point p, simplify_point a, simplify_point b) {
+    float dx = b.x - a.x, dy = b.y - a.y;
+    float length = dx * dx + dy * dy;
+    float t = length > 0.0f ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length : 0.0f;
+    t = fminf(fmaxf(t, 0.0f), 1.0f);
+    return hypotf(p.x - a.x - t * dx, p.y - a.y - t * dy);
+}
+
+// makes the on-curve points between consecutive off-curve points explicit and
+// starts the contour on an on-curve point, so every curve is a single quadratic
+static uint32_t expand_contour(const glyph_t *glyph, uint16_t start, uint16_t end, simplify_point *scratch, simplify_point *out) {
+    uint32_t n = end - start + 1, count = 0, first = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t a = start + i, b = start + (i + 1) % n;
+        bool a_on = glyph->flags[a] & ON_CURVE_POINT, b_on = glyph->flags[b] & ON_CURVE_POINT;
+        scratch[count++] = (simplify_point){ glyph->x_poss[a], glyph->y_poss[a], a_on };
+        if (!a_on && !b_on) {
+            scratch[count++] = (simplify_point){
+                (glyph->x_poss[a] + glyph->x_poss[b]) * 0.5f, (glyph->y_poss[a] + glyph->y_poss[b]) * 0.5f, true
+            };
+        }
+    }
+    while (!scratch[first].on) {
+        first++;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = scratch[(first + i) % count];
+    }
+    return count;
+}
+
+// a quadratic strays from its chord by at most half its control point's distance
+static uint32_t collapse_curves(simplify_point *points, uint32_t count, float tolerance) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!points[i].on && segment_distance(points[i], points[i - 1], points[(i + 1) % count]) * 0.5f <= tolerance) {
+            continue;
+        }
+        points[kept++] = points[i];
+    }
+    return kept;
+}
+
+// Walks the contour from its first point and skips on-curve points between lines
+// while the line from the last kept point to the next one stays within tolerance
+// of everything skipped; segment rather than line distance keeps spikes.
+static uint32_t merge_lines(const simplify_point *points, uint32_t count, float tolerance, simplify_point *out) {
+    uint32_t kept = 1, skipped = 1;
+    out[0] = points[0];
+    for (uint32_t i = 1; i < count; i++) {
+        simplify_point anchor = out[kept - 1], next = points[(i + 1) % count];
+        if (points[i].on && anchor.on && next.on) {
+            bool close = true;
+            for (uint32_t j = skipped; j <= i && close; j++) {
+                close = segment_distance(points[j], anchor, next) <= tolerance;
+            }
+            if (close) {
+                continue;
+            }
+        }
+        out[kept++] = points[i];
+        skipped = i + 1;
+    }
+    return kept;
+}
+
+static int16_t round_unit(float value) {
+    value = roundf(value);
+    return (int16_t)fminf(fmaxf(value, INT16_MIN), INT16_MAX);
+}
+
+glyph_t* simplify_glyph(const glyph_t *glyph, float tolerance) {
+    if (tolerance <= 0.0f || glyph->numberOfContours <= 0 || glyph->count == 0) {
+        return copy_glyph(glyph);
+    }
+
+    glyph_t *simple = calloc(1, sizeof(glyph_t));
+    simplify_point *scratch = malloc(4 * (size_t)glyph->count * sizeof(simplify_point));
+    if (!simple || !scratch) {
+        free(simple);
+        free(scratch);
+        return NULL;
+    }
+    simplify_point *points = scratch + 2 * (size_t)glyph->count;
+    simplify_point *merged = scratch;
+    simple->xMin = glyph->xMin;
+    simple->yMin = glyph->yMin;
+    simple->xMax = glyph->xMax;
+    simple->yMax = glyph->yMax;
+    simple->flags = malloc(glyph->count);
+    simple->x_poss = malloc(glyph->count * sizeof(int16_t));
+    simple->y_poss = malloc(glyph->count * sizeof(int16_t));
+    simple->endPtsOfContours = malloc(glyph->numberOfContours * sizeof(uint16_t));
+    simple->owns_end_points = true;
+    if (!simple->flags || !simple->x_poss || !simple->y_poss || !simple->endPtsOfContours) {
+        free(scratch);
+        free_glyph(simple);
+        return NULL;
+    }
+
+    uint16_t start = 0;
+    for (int16_t c = 0; c < glyph->numberOfContours; c++) {
+        uint16_t end = ntohs(glyph->endPtsOfContours[c]);
+        if (end >= glyph->count || end < start) {
+            break;
+        }
+        uint32_t count = expand_contour(glyph, start, end, scratch, points);
+        count = collapse_curves(points, count, tolerance);
+        count = merge_lines(points, count, tolerance, merged);
+        start = end + 1;
+
+        // on-curve points halfway between two off-curve ones are implied again,
+        // at most the original count survives since each one stands for a dropped point
+        uint16_t first = simple->count;
+        for (uint32_t i = 0; i < count; i++) {
+            simplify_point p = merged[i], prev = merged[(i + count - 1) % count], next = merged[(i + 1) % count];
+            if (p.on && !prev.on && !next.on && p.x == (prev.x + next.x) * 0.5f && p.y == (prev.y + next.y) * 0.5f) {
+                continue;
+            }
+            if (simple->count == glyph->count) {
+                break;
+            }
+            simple->flags[simple->count] = p.on ? ON_CURVE_POINT : 0;
+            simple->x_poss[simple->count] = round_unit(p.x);
+            simple->y_poss[simple->count] = round_unit(p.y);
+            simple->count++;
+        }
+        if (simple->count - first < 3) {
+            simple->count = first;
+            continue;
+        }
+        simple->endPtsOfContours[simple->numberOfContours++] = htons(simple->count - 1);
+    }
+    free(scratch);
+
+    if (simple->numberOfContours == 0) {
+        free_glyph(simple);
+        return copy_glyph(glyph);
+    }
+    return simple;
+}
+
+void init_simplify_cache(simplify_cache *cache, ttf_font *font, float tolerance) {
+    cache->font = font;
+    cache->tolerance = tolerance;
+    for (uint32_t i = 0; i <= SIMPLIFY_MAX_PPEM; i++) {
+        atomic_init(&cache->sizes[i], NULL);
+    }
+}
+
+void free_simplify_cache(simplify_cache *cache) {
+    for (uint32_t i = 0; i <= SIMPLIFY_MAX_PPEM; i++) {
+        _Atomic(glyph_t*) *slots = atomic_load(&cache->sizes[i]);
+        if (!slots) {
+            continue;
+        }
+        for (uint16_t g = 0; g < cache->font->glyph_count; g++) {
+            free_glyph(atomic_load(&slots[g]));
+        }
+        free(slots);
+        atomic_store(&cache->sizes[i], NULL);
+    }
+}
+
+static _Atomic(glyph_t*)* size_slots(simplify_cache *cache, uint32_t size) {
+    _Atomic(glyph_t*) *slots = atomic_load_explicit(&cache->sizes[size], memory_order_acquire);
+    if (!slots) {
+        _Atomic(glyph_t*) *fresh = calloc(cache->font->glyph_count, sizeof(_Atomic(glyph_t*)));
+        if (!fresh) {
+            return NULL;
+        }
+        if (atomic_compare_exchange_strong_explicit(&cache->sizes[size], &slots, fresh,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            slots = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+    return slots;
+}
+
+const glyph_t* get_simplified_glyph(simplify_cache *cache, uint16_t index, float ppem) {
+    const glyph_t *glyph = get_font_glyph(cache->font, index);
+    if (!glyph || !(ppem > 0.0f) || ppem > SIMPLIFY_MAX_PPEM) {
+        return glyph;
+    }
+
+    // rounding up errs towards a smaller tolerance in font units
+    uint32_t size = (uint32_t)ceilf(ppem);
+    _Atomic(glyph_t*) *slots = size_slots(cache, size);
+    if (!slots) {
+        return glyph;
+    }
+
+    glyph_t *simple = atomic_load_explicit(&slots[index], memory_order_acquire);
+    if (!simple) {
+        glyph_t *made = simplify_glyph(glyph, cache->tolerance * get_units_per_em(cache->font->head) / size);
+        if (!made) {
+            return glyph;
+        }
+        if (atomic_compare_exchange_strong_explicit(&slots[index], &simple, made,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            simple = made;
+        } else {
+            free_glyph(made);
+        }
+    }
+    return simple;
+}
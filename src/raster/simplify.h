@@ -0,0 +1,38 @@
+#ifndef SIMPLIFY
+#define SIMPLIFY
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "font.h"
+#include "glyph.h"
+
+// tolerance in pixels a simplified outline may move from the original
+#define SIMPLIFY_TOLERANCE 0.125f
+// above this size every point is worth its cost and glyphs are drawn as they are
+#define SIMPLIFY_MAX_PPEM 32
+
+// Drops off-curve points whose curves stay within tolerance font units of their
+// chord, then on-curve points between lines that stay within tolerance of the line
+// that replaces them, which also takes out near-duplicates. Contours that end up
+// with fewer than three points are dropped. The result owns its endPtsOfContours.
+glyph_t* simplify_glyph(const glyph_t *glyph, float tolerance);
+
+// Simplified glyphs per whole ppem, published lock-free the way get_font_glyph
+// publishes decoded ones; a ppem's slots are allocated on its first lookup.
+typedef struct simplify_cache {
+    ttf_font *font;
+    float tolerance;
+    _Atomic(_Atomic(glyph_t*)*) sizes[SIMPLIFY_MAX_PPEM + 1];
+} simplify_cache;
+
+// tolerance is in pixels, the font has to outlive the cache
+void init_simplify_cache(simplify_cache *cache, ttf_font *font, float tolerance);
+void free_simplify_cache(simplify_cache *cache);
+
+// ppem is rounded up to whole pixels; sizes above SIMPLIFY_MAX_PPEM get the
+// font's own glyph, NULL means the glyph has no outline
+const glyph_t* get_simplified_glyph(simplify_cache *cache, uint16_t index, float ppem);
+
+#endif
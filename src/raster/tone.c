@@ -0,0 +1,104 @@
+#include <math.h>
+
+#include "tone.h"
+
+void init_raster_tone(raster_tone *tone, float gamma, float darkening, bool embolden) {
+    tone->gamma = gamma > 0.0f ? gamma : 1.0f;
+    tone->darkening = fminf(fmaxf(darkening, 0.0f), 1.0f);
+    tone->embolden = embolden;
+
+    // darkening lifts partial coverage the most and leaves 0 and 1 in place
+    for (uint32_t i = 0; i < 256; i++) {
+        float c = powf(i / 255.0f, 1.0f / tone->gamma);
+        c += tone->darkening * c * (1.0f - c);
+        tone->lut[i] = (uint8_t)(fminf(c, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+float stem_darkening_strength(float ppem) {
+    if (ppem <= TONE_DARKEN_MIN_PPEM) {
+        return TONE_DARKEN_MAX_STRENGTH;
+    }
+    if (ppem >= TONE_DARKEN_MAX_PPEM) {
+        return 0.0f;
+    }
+    float t = (ppem - TONE_DARKEN_MIN_PPEM) / (TONE_DARKEN_MAX_PPEM - TONE_DARKEN_MIN_PPEM);
+    return TONE_DARKEN_MAX_STRENGTH * (1.0f - t);
+}
+
+static int16_t clamp_unit(float value) {
+    value = roundf(value);
+    return (int16_t)fminf(fmaxf(value, INT16_MIN), INT16_MAX);
+}
+
+glyph_t* embolden_glyph(const glyph_t *glyph, float strength) {
+    glyph_t *bold = calloc(1, sizeof(glyph_t));
+    if (!bold) {
+        return NULL;
+    }
+    *bold = *glyph;
+    bold->owns_end_points = false;
+    bold->flags = malloc(glyph->count);
+    bold->x_poss = malloc(glyph->count * sizeof(int16_t));
+    bold->y_poss = malloc(glyph->count * sizeof(int16_t));
+    if (!bold->flags || !bold->x_poss || !bold->y_poss) {
+        free_glyph(bold);
+        return NULL;
+    }
+    memcpy(bold->flags, glyph->flags, glyph->count);
+    memcpy(bold->x_poss, glyph->x_poss, glyph->count * sizeof(int16_t));
+    memcpy(bold->y_poss, glyph->y_poss, glyph->count * sizeof(int16_t));
+
+    // filled TrueType contours run clockwise, a font drawn the other way flips every normal
+    float area = 0.0f;
+    uint16_t start = 0;
+    for (int16_t c = 0; c < glyph->numberOfContours; c++) {
+        uint16_t end = ntohs(glyph->endPtsOfContours[c]);
+        if (end >= glyph->count || end < start) {
+            break;
+        }
+        for (uint16_t i = start; i <= end; i++) {
+            uint16_t next = i == end ? start : i + 1;
+            area += (float)glyph->x_poss[i] * glyph->y_poss[next] - (float)glyph->x_poss[next] * glyph->y_poss[i];
+        }
+        start = end + 1;
+    }
+    float half = (area > 0.0f ? -strength : strength) * 0.5f;
+
+    start = 0;
+    for (int16_t c = 0; c < glyph->numberOfContours; c++) {
+        uint16_t end = ntohs(glyph->endPtsOfContours[c]);
+        if (end >= glyph->count || end < start) {
+            break;
+        }
+        for (uint16_t i = start; i <= end; i++) {
+            uint16_t prev = i == start ? end : i - 1;
+            uint16_t next = i == end ? start : i + 1;
+            float ix = glyph->x_poss[i] - glyph->x_poss[prev], iy = glyph->y_poss[i] - glyph->y_poss[prev];
+            float ox = glyph->x_poss[next] - glyph->x_poss[i], oy = glyph->y_poss[next] - glyph->y_poss[i];
+            float il = sqrtf(ix * ix + iy * iy), ol = sqrtf(ox * ox + oy * oy);
+            if (il == 0.0f || ol == 0.0f) {
+                continue;
+            }
+            // outward normals of a clockwise contour are (-dy, dx)
+            float nx = -iy / il - oy / ol;
+            float ny = ix / il + ox / ol;
+            float d = 1.0f + (ix * ox + iy * oy) / (il * ol);
+            // near-reversals would shoot the point out, they only get the plain shift
+            if (d < 0.25f) {
+                d = 0.25f;
+            }
+            bold->x_poss[i] = clamp_unit(glyph->x_poss[i] + nx * half / d);
+            bold->y_poss[i] = clamp_unit(glyph->y_poss[i] + ny * half / d);
+        }
+        start = end + 1;
+    }
+
+    // the bisector shift is capped at twice the edge shift, which bounds the box growth
+    int32_t grow = (int32_t)ceilf(fabsf(strength) * 2.0f);
+    bold->xMin = clamp_unit(glyph->xMin - grow);
+    bold->yMin = clamp_unit(glyph->yMin - grow);
+    bold->xMax = clamp_unit(glyph->xMax + grow);
+    bold->yMax = clamp_unit(glyph->yMax + grow);
+    return bold;
+}
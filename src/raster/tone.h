@@ -0,0 +1,34 @@
+#ifndef TONE
+#define TONE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "glyph.h"
+
+// emboldening in pixels at or below the first size, fading to none at the last
+#define TONE_DARKEN_MIN_PPEM 9.0f
+#define TONE_DARKEN_MAX_PPEM 48.0f
+#define TONE_DARKEN_MAX_STRENGTH 0.5f
+
+// Everything a small-size rendering setting needs, built once per configuration:
+// lut maps resolved coverage through gamma and stem darkening, embolden thickens
+// the outline itself by an amount that depends on ppem.
+typedef struct raster_tone {
+    uint8_t lut[256];
+    float gamma;
+    float darkening;
+    bool embolden;
+} raster_tone;
+
+// gamma 1 and darkening 0 give the identity table, darkening is 0 to 1
+void init_raster_tone(raster_tone *tone, float gamma, float darkening, bool embolden);
+
+// total stroke growth in pixels for a ppem, 0 above TONE_DARKEN_MAX_PPEM
+float stem_darkening_strength(float ppem);
+
+// Moves every point along the bisector of its edges' normals so each stem grows by
+// strength font units; endPtsOfContours is shared with the source glyph.
+glyph_t* embolden_glyph(const glyph_t *glyph, float strength);
+
+#endif
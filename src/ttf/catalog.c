@@ -0,0 +1,428 @@
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <dirent.h>
+
+#include "catalog.h"
+#include "cmap.h"
+#include "validate.h"
+
+int open_catalog(catalog *cat, const char *index_path) {
+    memset(cat, 0, sizeof(catalog));
+
+    ttf_source source = {0};
+    if (load_ttf_source(&source, index_path)) {
+        return -1;
+    }
+
+    catalog_header *header = (catalog_header*)source.data;
+    if (source.size < sizeof(catalog_header)
+        || memcmp(header->magic, CATALOG_MAGIC, 4) != 0
+        || header->version != CATALOG_VERSION
+        || header->pages_offset % sizeof(uint32_t) != 0
+        || sizeof(catalog_header) + (size_t)header->record_count * sizeof(catalog_record) > source.size
+        || (size_t)header->strings_offset + header->strings_size > source.size
+        || (size_t)header->pages_offset + (size_t)header->page_count * sizeof(catalog_page) > source.size) {
+        unload_ttf_source(&source);
+        return -1;
+    }
+
+    // a stale or corrupt index must not send lookups outside the string pool or page table
+    char *strings = (char*)source.data + header->strings_offset;
+    catalog_record *records = (catalog_record*)((uint8_t*)source.data + sizeof(catalog_header));
+    bool valid = header->strings_size > 0 && strings[header->strings_size - 1] == '\0';
+    for (uint32_t i = 0; i < header->record_count && valid; i++) {
+        catalog_record *record = &records[i];
+        valid = record->path < header->strings_size
+            && record->family < header->strings_size
+            && record->style < header->strings_size
+            && (uint64_t)record->first_page + record->page_count <= header->page_count;
+    }
+    if (!valid) {
+        unload_ttf_source(&source);
+        return -1;
+    }
+
+    cat->source = source;
+    cat->header = header;
+    cat->records = records;
+    cat->strings = strings;
+    cat->pages = (catalog_page*)((uint8_t*)source.data + header->pages_offset);
+
+    return 0;
+}
+
+void close_catalog(catalog *cat) {
+    unload_ttf_source(&cat->source);
+    memset(cat, 0, sizeof(catalog));
+}
+
+const char* catalog_string(const catalog *cat, uint32_t offset) {
+    return offset < cat->header->strings_size ? cat->strings + offset : "";
+}
+
+bool catalog_covers(const catalog *cat, const catalog_record *record, uint32_t unicode) {
+    uint32_t page = unicode / CATALOG_PAGE_BITS;
+    uint32_t bit = unicode % CATALOG_PAGE_BITS;
+    catalog_page *pages = cat->pages + record->first_page;
+
+    int lo = 0, hi = (int)record->page_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (pages[mid].page == page) {
+            return pages[mid].bits[bit >> 3] & (1 << (bit & 7));
+        }
+        if (pages[mid].page < page) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return false;
+}
+
+size_t catalog_find_covering(const catalog *cat, const char *family, uint32_t unicode,
+                             const catalog_record **results, size_t max_results) {
+    size_t found = 0;
+
+    for (uint32_t i = 0; i < cat->header->record_count && found < max_results; i++) {
+        const catalog_record *record = &cat->records[i];
+        if (record->flags & CATALOG_RECORD_FAILED) {
+            continue;
+        }
+        if (family && strcasecmp(catalog_string(cat, record->family), family) != 0) {
+            continue;
+        }
+        if (catalog_covers(cat, record, unicode)) {
+            results[found++] = record;
+        }
+    }
+
+    return found;
+}
+
+typedef struct catalog_builder {
+    catalog_record *records;
+    size_t record_count;
+    size_t record_capacity;
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+    catalog_page *pages;
+    size_t page_count;
+    size_t page_capacity;
+    bool failed;
+} catalog_builder;
+
+// a failed allocation marks the builder and the index is not written
+static uint32_t add_string(catalog_builder *b, const char *str) {
+    size_t len = strlen(str) + 1;
+    if (b->failed) {
+        return 0;
+    }
+    if (b->strings_size + len > b->strings_capacity) {
+        size_t capacity = b->strings_capacity ? b->strings_capacity : 4096;
+        while (b->strings_size + len > capacity) {
+            capacity *= 2;
+        }
+        char *strings = realloc(b->strings, capacity);
+        if (!strings) {
+            b->failed = true;
+            return 0;
+        }
+        b->strings = strings;
+        b->strings_capacity = capacity;
+    }
+    memcpy(b->strings + b->strings_size, str, len);
+    b->strings_size += len;
+    return (uint32_t)(b->strings_size - len);
+}
+
+static catalog_page* add_page(catalog_builder *b) {
+    if (b->failed) {
+        return NULL;
+    }
+    if (b->page_count == b->page_capacity) {
+        size_t capacity = b->page_capacity ? b->page_capacity * 2 : 256;
+        catalog_page *pages = realloc(b->pages, capacity * sizeof(catalog_page));
+        if (!pages) {
+            b->failed = true;
+            return NULL;
+        }
+        b->pages = pages;
+        b->page_capacity = capacity;
+    }
+    return &b->pages[b->page_count++];
+}
+
+static catalog_record* add_record(catalog_builder *b) {
+    if (b->failed) {
+        return NULL;
+    }
+    if (b->record_count == b->record_capacity) {
+        size_t capacity = b->record_capacity ? b->record_capacity * 2 : 64;
+        catalog_record *records = realloc(b->records, capacity * sizeof(catalog_record));
+        if (!records) {
+            b->failed = true;
+            return NULL;
+        }
+        b->records = records;
+        b->record_capacity = capacity;
+    }
+    catalog_record *record = &b->records[b->record_count++];
+    memset(record, 0, sizeof(catalog_record));
+    return record;
+}
+
+// records are written in path order, so the previous index can be searched
+static const catalog_record* find_unchanged(const catalog *old, const char *path, const struct stat *info) {
+    if (!old->source.data) {
+        return NULL;
+    }
+
+    int lo = 0, hi = (int)old->header->record_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const catalog_record *record = &old->records[mid];
+        int cmp = strcmp(catalog_string(old, record->path), path);
+
+        if (cmp == 0) {
+            bool same = record->mtime == (int64_t)info->st_mtime && record->size == (uint64_t)info->st_size;
+            return same ? record : NULL;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+static void copy_record(catalog_builder *b, const catalog *old, const catalog_record *from) {
+    catalog_record *record = add_record(b);
+    if (!record) {
+        return;
+    }
+    *record = *from;
+    record->path = add_string(b, catalog_string(old, from->path));
+    record->family = add_string(b, catalog_string(old, from->family));
+    record->style = add_string(b, catalog_string(old, from->style));
+    record->first_page = (uint32_t)b->page_count;
+
+    for (uint32_t i = 0; i < from->page_count; i++) {
+        catalog_page *page = add_page(b);
+        if (!page) {
+            return;
+        }
+        *page = old->pages[from->first_page + i];
+    }
+}
+
+static void add_failed_record(catalog_builder *b, const char *path, const struct stat *info) {
+    catalog_record *record = add_record(b);
+    if (!record) {
+        return;
+    }
+    record->path = add_string(b, path);
+    record->flags = CATALOG_RECORD_FAILED;
+    record->mtime = (int64_t)info->st_mtime;
+    record->size = (uint64_t)info->st_size;
+    record->first_page = (uint32_t)b->page_count;
+}
+
+static int parse_record(catalog_builder *b, const char *path) {
+    font_entry entry = {0};
+    if (probe_font_file(path, &entry)) {
+        return -1;
+    }
+
+    ttf_source source = {0};
+    if (load_ttf_source(&source, path)) {
+        return -1;
+    }
+
+    uint8_t *subtable = NULL;
+    if (validate_ttf_source(&source, NULL) || load_cmap_subtable(&source, &subtable, NULL)) {
+        unload_ttf_source(&source);
+        return -1;
+    }
+
+    uint8_t *coverage = malloc(CMAP_COVERAGE_BYTES);
+    if (!coverage) {
+        unload_ttf_source(&source);
+        return -1;
+    }
+    get_coverage_format4(subtable, coverage);
+    unload_ttf_source(&source);
+
+    catalog_record *record = add_record(b);
+    if (!record) {
+        free(coverage);
+        return -1;
+    }
+    record->path = add_string(b, path);
+    record->family = add_string(b, entry.family);
+    record->style = add_string(b, entry.style);
+    record->weight = entry.weight;
+    record->italic = entry.italic;
+    record->mtime = (int64_t)entry.mtime;
+    record->size = (uint64_t)entry.file_size;
+    record->first_page = (uint32_t)b->page_count;
+
+    const size_t page_bytes = CATALOG_PAGE_BITS / 8;
+    for (uint32_t page = 0; page < CMAP_COVERAGE_BYTES / page_bytes; page++) {
+        uint8_t *bits = coverage + page * page_bytes;
+        bool empty = true;
+        for (size_t i = 0; i < page_bytes && empty; i++) {
+            empty = bits[i] == 0;
+        }
+        if (empty) {
+            continue;
+        }
+
+        catalog_page *p = add_page(b);
+        if (!p) {
+            break;
+        }
+        p->page = page;
+        memcpy(p->bits, bits, page_bytes);
+        record->page_count++;
+    }
+
+    free(coverage);
+    return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int write_catalog(catalog_builder *b, const char *index_path) {
+    size_t tmp_size = strlen(index_path) + 5;
+    char *tmp_path = malloc(tmp_size);
+    if (!tmp_path) {
+        return -1;
+    }
+    snprintf(tmp_path, tmp_size, "%s.tmp", index_path);
+
+    catalog_header header = {0};
+    memcpy(header.magic, CATALOG_MAGIC, 4);
+    header.version = CATALOG_VERSION;
+    header.record_count = (uint32_t)b->record_count;
+    header.strings_offset = (uint32_t)(sizeof(catalog_header) + b->record_count * sizeof(catalog_record));
+    header.strings_size = (uint32_t)b->strings_size;
+    header.pages_offset = header.strings_offset + (uint32_t)((b->strings_size + 7) & ~(size_t)7);
+    header.page_count = (uint32_t)b->page_count;
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(tmp_path);
+        return -1;
+    }
+
+    static const uint8_t padding[8] = {0};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(b->records, sizeof(catalog_record), b->record_count, f) == b->record_count
+        && fwrite(b->strings, 1, b->strings_size, f) == b->strings_size
+        && fwrite(padding, 1, header.pages_offset - header.strings_offset - b->strings_size, f)
+            == header.pages_offset - header.strings_offset - b->strings_size
+        && fwrite(b->pages, sizeof(catalog_page), b->page_count, f) == b->page_count;
+    ok = fclose(f) == 0 && ok;
+
+    if (!ok || rename(tmp_path, index_path)) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    free(tmp_path);
+    return 0;
+}
+
+// Rebuilds the index for dir, reusing every record whose path, mtime and size
+// are unchanged so only new or modified files are opened. Files that fail to
+// parse get a failed record too and are retried only once they change.
+int build_catalog(const char *index_path, const char *dir, size_t *reparsed) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return -1;
+    }
+
+    char **paths = NULL;
+    size_t path_count = 0, path_capacity = 0;
+    bool failed = false;
+    struct dirent *ent;
+    while (!failed && (ent = readdir(d)) != NULL) {
+        if (!is_font_file(ent->d_name)) {
+            continue;
+        }
+        if (path_count == path_capacity) {
+            size_t capacity = path_capacity ? path_capacity * 2 : 64;
+            char **grown = realloc(paths, capacity * sizeof(char*));
+            if (!grown) {
+                failed = true;
+                break;
+            }
+            paths = grown;
+            path_capacity = capacity;
+        }
+        size_t size = strlen(dir) + strlen(ent->d_name) + 2;
+        if (!(paths[path_count] = malloc(size))) {
+            failed = true;
+            break;
+        }
+        snprintf(paths[path_count], size, "%s/%s", dir, ent->d_name);
+        path_count++;
+    }
+    closedir(d);
+    if (failed) {
+        for (size_t i = 0; i < path_count; i++) {
+            free(paths[i]);
+        }
+        free(paths);
+        return -1;
+    }
+    qsort(paths, path_count, sizeof(char*), compare_names);
+
+    catalog old;
+    open_catalog(&old, index_path);
+
+    catalog_builder b = {0};
+    add_string(&b, "");
+    if (reparsed) {
+        *reparsed = 0;
+    }
+
+    for (size_t i = 0; i < path_count && !b.failed; i++) {
+        struct stat info;
+        if (stat(paths[i], &info) < 0) {
+            continue;
+        }
+
+        const catalog_record *unchanged = find_unchanged(&old, paths[i], &info);
+        if (unchanged) {
+            copy_record(&b, &old, unchanged);
+            continue;
+        }
+        if (parse_record(&b, paths[i])) {
+            add_failed_record(&b, paths[i], &info);
+        }
+        if (reparsed) {
+            (*reparsed)++;
+        }
+    }
+
+    close_catalog(&old);
+    int result = b.failed ? -1 : write_catalog(&b, index_path);
+
+    for (size_t i = 0; i < path_count; i++) {
+        free(paths[i]);
+    }
+    free(paths);
+    free(b.records);
+    free(b.strings);
+    free(b.pages);
+
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef CATALOG
+#define CATALOG
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "registry.h"
+
+#define CATALOG_MAGIC "RCAT"
+#define CATALOG_VERSION 3
+#define CATALOG_PAGE_BITS 256
+
+// the file did not parse as a font, kept so an unchanged file is not reopened
+#define CATALOG_RECORD_FAILED 0x01
+
+// On-disk layout, native byte order: header, records, string pool, coverage pages.
+// Coverage is stored sparsely as the non-empty 256 code point pages of each font.
+// The header is a multiple of 8 bytes so the records' 64-bit fields stay aligned
+// in the mapping.
+
+typedef struct catalog_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t record_count;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint32_t pages_offset;
+    uint32_t page_count;
+    uint32_t reserved;
+} catalog_header;
+
+typedef struct catalog_record {
+    uint32_t path;
+    uint32_t family;
+    uint32_t style;
+    uint16_t weight;
+    uint8_t italic;
+    uint8_t flags;
+    int64_t mtime;
+    uint64_t size;
+    uint32_t first_page;
+    uint32_t page_count;
+} catalog_record;
+
+typedef struct catalog_page {
+    uint32_t page;
+    uint8_t bits[CATALOG_PAGE_BITS / 8];
+} catalog_page;
+
+typedef struct catalog {
+    ttf_source source;
+    catalog_header *header;
+    catalog_record *records;
+    char *strings;
+    catalog_page *pages;
+} catalog;
+
+int open_catalog(catalog *cat, const char *index_path);
+void close_catalog(catalog *cat);
+int build_catalog(const char *index_path, const char *dir, size_t *reparsed);
+
+const char* catalog_string(const catalog *cat, uint32_t offset);
+bool catalog_covers(const catalog *cat, const catalog_record *record, uint32_t unicode);
+size_t catalog_find_covering(const catalog *cat, const char *family, uint32_t unicode,
+                             const catalog_record **results, size_t max_results);
+
+#endif
@@ -1,18 +1,40 @@
 #include "cmap.h"
 
-uint16_t get_glyph_index(ttf_source *source, uint32_t unicode) {
+ttf_status load_cmap_subtable(ttf_source *source, uint8_t **subtable, ttf_error *error) {
     ttf_table_record cmap_record = {0};
-    try_load_table_record(source, &cmap_record, CMAP_TAG);
+    ttf_status status = load_table_record(source, &cmap_record, CMAP_TAG, error);
+    if (status) {
+        return status;
+    }
 
     cmap_header *cmap = (cmap_header*)((char*)source->data + htonl(cmap_record.offset));
-    uint16_t numTables = ntohs(cmap->numTables);
     cmap_encoding_record *record = (cmap_encoding_record*)((char*)cmap + sizeof(cmap_header));
+    if (ntohs(cmap->numTables) == 0) {
+        return ttf_fail(error, TTF_ERR_MALFORMED, "cmap has no encoding records");
+    }
 
     uint32_t cmap_offset = ntohl(cmap_record.offset);
     uint32_t record_offset = ntohl(record->subtableOffset);
-    uint8_t *subtable = source->data + cmap_offset + record_offset;
+    uint8_t *table = (uint8_t*)source->data + cmap_offset + record_offset;
+
+    uint16_t format = ntohs(*(uint16_t*)table);
+    if (format != 4) {
+        return ttf_fail(error, TTF_ERR_UNSUPPORTED, "cmap subtable format %u is not supported", format);
+    }
 
-    return get_glyph_index_format4(subtable, unicode);
+    *subtable = table;
+    return TTF_OK;
+}
+
+ttf_status lookup_glyph_index(ttf_source *source, uint32_t unicode, uint16_t *index, ttf_error *error) {
+    uint8_t *subtable = NULL;
+    ttf_status status = load_cmap_subtable(source, &subtable, error);
+    if (status) {
+        return status;
+    }
+
+    *index = get_glyph_index_format4(subtable, unicode);
+    return TTF_OK;
 }
 
 uint16_t get_glyph_index_format4(uint8_t *table, uint32_t unicode)
@@ -47,3 +69,40 @@ uint16_t get_glyph_index_format4(uint8_t *table, uint32_t unicode)
     }
     return 0;
 }
+
+// Marks every BMP code point that maps to a real glyph in a 0x10000 bit bitmap,
+// decoding each segment in place rather than looking code points up one by one.
+void get_coverage_format4(uint8_t *table, uint8_t *bitmap)
+{
+    uint8_t *p = table;
+    uint16_t segCount = ntohs(*(uint16_t *)(p + 6)) / 2;
+    uint16_t *endCode = (uint16_t *)(p + 14);
+    uint16_t *startCode = endCode + segCount + 1;
+    int16_t  *idDelta = (int16_t *)(startCode + segCount);
+    uint16_t *idRangeOffset = (uint16_t *)(idDelta + segCount);
+
+    memset(bitmap, 0, CMAP_COVERAGE_BYTES);
+
+    for (int i = 0; i < segCount; i++) {
+        uint16_t start = ntohs(startCode[i]);
+        uint16_t end = ntohs(endCode[i]);
+        int16_t delta = ntohs(idDelta[i]);
+        uint16_t range = ntohs(idRangeOffset[i]);
+        uint16_t *glyphs = (uint16_t *)((uint8_t *)&idRangeOffset[i] + range);
+
+        for (uint32_t unicode = start; unicode <= end && unicode < 0xFFFF; unicode++) {
+            uint16_t glyph;
+            if (range == 0) {
+                glyph = (unicode + delta) & 0xFFFF;
+            } else {
+                glyph = ntohs(glyphs[unicode - start]);
+                if (glyph != 0) {
+                    glyph = (glyph + delta) & 0xFFFF;
+                }
+            }
+            if (glyph != 0) {
+                bitmap[unicode >> 3] |= 1 << (unicode & 7);
+            }
+        }
+    }
+}
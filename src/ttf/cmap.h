@@ -3,12 +3,14 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <arpa/inet.h>
 
 #include "source.h"
 #include "ttf.h"
 
 #define CMAP_TAG "cmap"
+#define CMAP_COVERAGE_BYTES (0x10000 / 8)
 
 #pragma pack(1)
 
@@ -25,7 +27,9 @@ typedef struct cmap_encoding_record {
 
 #pragma pack()
 
-uint16_t get_glyph_index(ttf_source *source, uint32_t unicode);
+ttf_status load_cmap_subtable(ttf_source *source, uint8_t **subtable, ttf_error *error);
+ttf_status lookup_glyph_index(ttf_source *source, uint32_t unicode, uint16_t *index, ttf_error *error);
 uint16_t get_glyph_index_format4(uint8_t *table, uint32_t unicode);
+void get_coverage_format4(uint8_t *table, uint8_t *bitmap);
 
 #endif
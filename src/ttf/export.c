@@ -0,0 +1,366 @@
+#include <stdarg.h>
+
+#include "export.h"
+
+typedef struct export_slice {
+    ttf_font *font;
+    export_format format;
+    uint16_t begin;
+    uint16_t end;
+    int32_t pitch;
+    int32_t ascender;
+    export_buffer buffer;
+    glyph_point *points;
+    uint32_t capacity;
+} export_slice;
+
+// x' = xx x + yx y + dx and y' = xy x + yy y + dy, laid out like SVG's matrix()
+typedef struct export_matrix {
+    double xx, xy, yx, yy, dx, dy;
+} export_matrix;
+
+static bool reserve(export_buffer *buffer, size_t extra) {
+    if (buffer->failed) {
+        return false;
+    }
+    if (buffer->length + extra <= buffer->capacity) {
+        return true;
+    }
+    size_t capacity = buffer->capacity ? buffer->capacity : EXPORT_BUFFER_SIZE;
+    while (capacity < buffer->length + extra) {
+        capacity *= 2;
+    }
+    char *data = realloc(buffer->data, capacity);
+    if (!data) {
+        buffer->failed = true;
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static void append_text(export_buffer *buffer, const char *text) {
+    size_t length = strlen(text);
+    if (reserve(buffer, length)) {
+        memcpy(buffer->data + buffer->length, text, length);
+        buffer->length += length;
+    }
+}
+
+// coordinates are the bulk of the output, so they skip printf
+static void append_int(export_buffer *buffer, int32_t value) {
+    if (!reserve(buffer, 12)) {
+        return;
+    }
+    char digits[12];
+    uint32_t count = 0, magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        buffer->data[buffer->length++] = '-';
+    }
+    while (count) {
+        buffer->data[buffer->length++] = digits[--count];
+    }
+}
+
+// implied on-curve points sit halfway between integers, they come in as doubled values
+static void append_half(export_buffer *buffer, int32_t doubled) {
+    if (doubled % 2 == 0) {
+        append_int(buffer, doubled / 2);
+        return;
+    }
+    if (doubled < 0) {
+        append_text(buffer, "-");
+        doubled = -doubled;
+    }
+    append_int(buffer, doubled / 2);
+    append_text(buffer, ".5");
+}
+
+static void append_format(export_buffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0 || !reserve(buffer, (size_t)length + 1)) {
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+    va_end(args);
+    buffer->length += (size_t)length;
+}
+
+static void append_point(export_buffer *buffer, const char *command, int32_t x2, int32_t y2) {
+    append_text(buffer, command);
+    append_half(buffer, x2);
+    append_text(buffer, " ");
+    append_half(buffer, y2);
+}
+
+// same walk as the rasterizer's: start on an on-curve point, or between the last
+// and first points when there is none, and make implied points explicit
+static void append_contour_path(export_buffer *buffer, const glyph_point *points, uint32_t count) {
+    uint32_t begin = count;
+    for (uint32_t i = 0; i < count; i++) {
+        if (points[i].on_curve) {
+            begin = i;
+            break;
+        }
+    }
+    int32_t origin_x, origin_y;
+    if (begin < count) {
+        origin_x = 2 * points[begin].x;
+        origin_y = 2 * points[begin].y;
+    } else {
+        begin = count - 1;
+        origin_x = points[count - 1].x + points[0].x;
+        origin_y = points[count - 1].y + points[0].y;
+    }
+    append_point(buffer, "M", origin_x, origin_y);
+
+    bool has_control = false;
+    int32_t control_x = 0, control_y = 0;
+    for (uint32_t j = 1; j <= count; j++) {
+        const glyph_point *point = &points[(begin + j) % count];
+        if (point->on_curve) {
+            if (has_control) {
+                append_point(buffer, "Q", control_x, control_y);
+                append_point(buffer, " ", 2 * point->x, 2 * point->y);
+            } else if (j < count) {
+                append_point(buffer, "L", 2 * point->x, 2 * point->y);
+            }
+            has_control = false;
+        } else {
+            if (has_control) {
+                append_point(buffer, "Q", control_x, control_y);
+                append_point(buffer, " ", (control_x + 2 * point->x) / 2, (control_y + 2 * point->y) / 2);
+            }
+            control_x = 2 * point->x;
+            control_y = 2 * point->y;
+            has_control = true;
+        }
+    }
+    if (has_control) {
+        append_point(buffer, "Q", control_x, control_y);
+        append_point(buffer, " ", origin_x, origin_y);
+    }
+    append_text(buffer, "Z");
+}
+
+// one subpath per contour of a simple glyph, in the glyph's own units
+static void append_simple_paths(export_slice *slice, glyph_iter *iter) {
+    export_buffer *buffer = &slice->buffer;
+    uint32_t count = 0;
+    glyph_point point;
+    while (next_glyph_point(iter, &point)) {
+        if (count == slice->capacity) {
+            slice->capacity = slice->capacity ? slice->capacity * 2 : 256;
+            glyph_point *points = realloc(slice->points, slice->capacity * sizeof(glyph_point));
+            if (!points) {
+                buffer->failed = true;
+                return;
+            }
+            slice->points = points;
+        }
+        slice->points[count++] = point;
+        if (point.contour_end) {
+            append_contour_path(buffer, slice->points, count);
+            count = 0;
+        }
+    }
+}
+
+static export_matrix component_matrix(const export_matrix *parent, const glyph_component *component) {
+    double xx = component->x_scale / 16384.0, xy = component->scale01 / 16384.0;
+    double yx = component->scale10 / 16384.0, yy = component->y_scale / 16384.0;
+    double dx = (component->flags & ARGS_ARE_XY_VALUES) ? component->arg1 : 0.0;
+    double dy = (component->flags & ARGS_ARE_XY_VALUES) ? component->arg2 : 0.0;
+    return (export_matrix){
+        parent->xx * xx + parent->yx * xy, parent->xy * xx + parent->yy * xy,
+        parent->xx * yx + parent->yx * yy, parent->xy * yx + parent->yy * yy,
+        parent->xx * dx + parent->yx * dy + parent->dx, parent->xy * dx + parent->yy * dy + parent->dy
+    };
+}
+
+// Draws a composite as the paths of its simple leaves, each under the product of
+// the transforms on the way down. Components anchored by point numbers instead of
+// an offset are drawn unshifted.
+static void append_component_paths(export_slice *slice, uint16_t index, const export_matrix *matrix, uint32_t depth) {
+    ttf_font *font = slice->font;
+    if (index >= font->glyph_count || depth > EXPORT_MAX_COMPONENT_DEPTH || slice->buffer.failed) {
+        return;
+    }
+    uint32_t glyph_offset = font->locations[index];
+    uint32_t glyph_length = font->locations[index + 1] - glyph_offset;
+
+    glyph_iter iter;
+    if (!init_glyph_iter(&font->source, glyph_offset, glyph_length, &iter, NULL)) {
+        append_format(&slice->buffer, "<path transform=\"matrix(%g %g %g %g %g %g)\" d=\"", matrix->xx, matrix->xy,
+                      matrix->yx, matrix->yy, matrix->dx, matrix->dy);
+        append_simple_paths(slice, &iter);
+        append_text(&slice->buffer, "\"/>");
+        return;
+    }
+
+    component_iter components;
+    glyph_component component;
+    if (init_component_iter(&font->source, glyph_offset, glyph_length, &components, NULL)) {
+        return;
+    }
+    while (next_glyph_component(&components, &component)) {
+        export_matrix child = component_matrix(matrix, &component);
+        append_component_paths(slice, component.glyph, &child, depth + 1);
+    }
+}
+
+// component records as stored: offset or anchor points, and the transform when there is one
+static void append_components_json(export_buffer *buffer, component_iter *components) {
+    append_text(buffer, ",\"components\":[");
+    glyph_component component;
+    bool first = true;
+    while (next_glyph_component(components, &component)) {
+        append_format(buffer, "%s{\"glyph\":%u", first ? "" : ",", component.glyph);
+        if (component.flags & ARGS_ARE_XY_VALUES) {
+            append_format(buffer, ",\"x\":%d,\"y\":%d", component.arg1, component.arg2);
+        } else {
+            append_format(buffer, ",\"points\":[%d,%d]", component.arg1, component.arg2);
+        }
+        if (component.flags & (WE_HAVE_A_SCALE | WE_HAVE_AN_X_AND_Y_SCALE | WE_HAVE_A_TWO_BY_TWO)) {
+            append_format(buffer, ",\"transform\":[%g,%g,%g,%g]", component.x_scale / 16384.0, component.scale01 / 16384.0,
+                          component.scale10 / 16384.0, component.y_scale / 16384.0);
+        }
+        append_text(buffer, "}");
+        first = false;
+    }
+    append_text(buffer, "]");
+}
+
+static void export_glyph(export_slice *slice, uint16_t index) {
+    ttf_font *font = slice->font;
+    export_buffer *buffer = &slice->buffer;
+    uint32_t glyph_offset = font->locations[index];
+    uint32_t glyph_length = font->locations[index + 1] - glyph_offset;
+    glyph_metrics metrics;
+    load_glyph_metrics(&font->source, glyph_offset, glyph_length, &metrics, NULL);
+    glyph_iter iter;
+    bool simple = metrics.numberOfContours > 0 && !init_glyph_iter(&font->source, glyph_offset, glyph_length, &iter, NULL);
+    component_iter components;
+    bool composite = metrics.numberOfContours < 0
+        && !init_component_iter(&font->source, glyph_offset, glyph_length, &components, NULL);
+
+    if (slice->format == EXPORT_JSON) {
+        append_format(buffer, "{\"id\":%u,\"advance\":%u,\"bbox\":[%d,%d,%d,%d]%s,\"contours\":[", index,
+                      font_advance_width(font, index), metrics.xMin, metrics.yMin, metrics.xMax, metrics.yMax,
+                      metrics.numberOfContours < 0 ? ",\"composite\":true" : "");
+        glyph_point point;
+        bool contour_open = false;
+        while (simple && next_glyph_point(&iter, &point)) {
+            append_text(buffer, contour_open ? ",[" : (iter.index > 1 ? ",[[" : "[["));
+            append_int(buffer, point.x);
+            append_text(buffer, ",");
+            append_int(buffer, point.y);
+            append_text(buffer, point.on_curve ? ",1]" : ",0]");
+            contour_open = !point.contour_end;
+            if (point.contour_end) {
+                append_text(buffer, "]");
+            }
+        }
+        append_text(buffer, "]");
+        if (composite) {
+            append_components_json(buffer, &components);
+        }
+        append_text(buffer, index + 1 < font->glyph_count ? "},\n" : "}\n");
+        return;
+    }
+
+    uint32_t column = index % EXPORT_SVG_COLUMNS, row = index / EXPORT_SVG_COLUMNS;
+    if (composite) {
+        append_format(buffer, "<g id=\"glyph-%u\" data-advance=\"%u\" data-bbox=\"%d %d %d %d\" data-components=\"",
+                      index, font_advance_width(font, index), metrics.xMin, metrics.yMin, metrics.xMax, metrics.yMax);
+        component_iter ids = components;
+        glyph_component component;
+        for (bool first = true; next_glyph_component(&ids, &component); first = false) {
+            append_format(buffer, first ? "%u" : " %u", component.glyph);
+        }
+        append_format(buffer, "\" transform=\"translate(%u %d) scale(1 -1)\">", column * get_units_per_em(font->head),
+                      (int32_t)row * slice->pitch + slice->ascender);
+        export_matrix identity = { 1.0, 0.0, 0.0, 1.0, 0.0, 0.0 };
+        while (next_glyph_component(&components, &component)) {
+            export_matrix child = component_matrix(&identity, &component);
+            append_component_paths(slice, component.glyph, &child, 1);
+        }
+        append_text(buffer, "</g>\n");
+        return;
+    }
+
+    append_format(buffer, "<path id=\"glyph-%u\" data-advance=\"%u\" data-bbox=\"%d %d %d %d\" transform=\"translate(%u %d) scale(1 -1)\" d=\"",
+                  index, font_advance_width(font, index), metrics.xMin, metrics.yMin, metrics.xMax, metrics.yMax,
+                  column * get_units_per_em(font->head), (int32_t)row * slice->pitch + slice->ascender);
+    if (simple) {
+        append_simple_paths(slice, &iter);
+    }
+    append_text(buffer, "\"/>\n");
+}
+
+static void export_slice_task(void *arg) {
+    export_slice *slice = arg;
+    for (uint32_t index = slice->begin; index < slice->end && !slice->buffer.failed; index++) {
+        export_glyph(slice, (uint16_t)index);
+    }
+}
+
+ttf_status export_font_outlines(ttf_font *font, export_format format, thread_pool *pool, FILE *out, ttf_error *error) {
+    uint32_t slice_count = pool && pool->worker_count ? pool->worker_count : 1;
+    if (slice_count > font->glyph_count) {
+        slice_count = font->glyph_count ? font->glyph_count : 1;
+    }
+    export_slice *slices = calloc(slice_count, sizeof(export_slice));
+    if (!slices) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory exporting outlines");
+    }
+
+    int32_t ascender = (int16_t)ntohs(font->hhea->ascender);
+    int32_t pitch = ascender - (int16_t)ntohs(font->hhea->descender);
+    uint16_t units_per_em = get_units_per_em(font->head);
+    task_group group;
+    init_task_group(&group);
+    for (uint32_t s = 0; s < slice_count; s++) {
+        slices[s].font = font;
+        slices[s].format = format;
+        slices[s].begin = (uint16_t)((uint64_t)font->glyph_count * s / slice_count);
+        slices[s].end = (uint16_t)((uint64_t)font->glyph_count * (s + 1) / slice_count);
+        slices[s].pitch = pitch;
+        slices[s].ascender = ascender;
+        pool_submit(pool, &group, export_slice_task, &slices[s]);
+    }
+    task_group_wait(pool, &group);
+
+    if (format == EXPORT_JSON) {
+        fprintf(out, "{\"unitsPerEm\":%u,\"ascender\":%d,\"descender\":%d,\"glyphCount\":%u,\"glyphs\":[\n",
+                units_per_em, ascender, ascender - pitch, font->glyph_count);
+    } else {
+        uint32_t rows = (font->glyph_count + EXPORT_SVG_COLUMNS - 1) / EXPORT_SVG_COLUMNS;
+        fprintf(out, "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 %u %d\" data-units-per-em=\"%u\">\n",
+                EXPORT_SVG_COLUMNS * units_per_em, (int32_t)rows * pitch, units_per_em);
+    }
+
+    ttf_status status = TTF_OK;
+    for (uint32_t s = 0; s < slice_count; s++) {
+        if (slices[s].buffer.failed) {
+            status = ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory exporting glyphs %u-%u", slices[s].begin, slices[s].end);
+        } else if (!status && fwrite(slices[s].buffer.data, 1, slices[s].buffer.length, out) != slices[s].buffer.length) {
+            status = ttf_fail(error, TTF_ERR_IO, "short write exporting glyphs %u-%u", slices[s].begin, slices[s].end);
+        }
+        free(slices[s].buffer.data);
+        free(slices[s].points);
+    }
+    free(slices);
+
+    fputs(format == EXPORT_JSON ? "]}\n" : "</svg>\n", out);
+    return status;
+}
@@ -0,0 +1,37 @@
+#ifndef EXPORT
+#define EXPORT
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "font.h"
+#include "pool.h"
+
+#define EXPORT_SVG_COLUMNS 32
+#define EXPORT_BUFFER_SIZE (64 << 10)
+#define EXPORT_MAX_COMPONENT_DEPTH 8
+
+typedef enum export_format {
+    EXPORT_JSON,
+    EXPORT_SVG
+} export_format;
+
+// growable text buffer, each export worker appends to its own
+typedef struct export_buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} export_buffer;
+
+// Writes every glyph's outline read straight from glyf: JSON lists the raw points
+// with their on-curve flags per contour and a composite's component records, SVG
+// lays glyphs out in a grid as quadratic paths with one subpath per contour and
+// draws composites from their transformed components. Both carry each glyph's bbox
+// and advance and put one glyph per line, in glyph order, so two exports diff
+// cleanly. The glyph range is split into one slice per pool worker, or exported
+// inline without a pool, and written out once all are done.
+ttf_status export_font_outlines(ttf_font *font, export_format format, thread_pool *pool, FILE *out, ttf_error *error);
+
+#endif
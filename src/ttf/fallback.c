@@ -0,0 +1,117 @@
+#include <string.h>
+
+#include "fallback.h"
+
+static void reset_slots(fallback_slot *slots, size_t capacity) {
+    for (size_t i = 0; i < capacity; i++) {
+        slots[i].unicode = FALLBACK_EMPTY_SLOT;
+    }
+}
+
+ttf_status init_font_chain(font_chain *chain, ttf_source **fonts, uint16_t font_count, ttf_error *error) {
+    memset(chain, 0, sizeof(font_chain));
+    if (font_count == 0) {
+        return ttf_fail(error, TTF_ERR_RANGE, "font chain needs at least one font");
+    }
+
+    chain->fonts = malloc(font_count * sizeof(ttf_source*));
+    chain->subtables = malloc(font_count * sizeof(uint8_t*));
+    if (!chain->fonts || !chain->subtables) {
+        free_font_chain(chain);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building a font chain");
+    }
+    chain->font_count = font_count;
+    memcpy(chain->fonts, fonts, font_count * sizeof(ttf_source*));
+
+    for (uint16_t i = 0; i < font_count; i++) {
+        ttf_status status = load_cmap_subtable(fonts[i], &chain->subtables[i], error);
+        if (status) {
+            free_font_chain(chain);
+            return status;
+        }
+    }
+
+    chain->capacity = FALLBACK_INITIAL_CAPACITY;
+    chain->slots = malloc(chain->capacity * sizeof(fallback_slot));
+    if (!chain->slots) {
+        free_font_chain(chain);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building a font chain");
+    }
+    reset_slots(chain->slots, chain->capacity);
+
+    return TTF_OK;
+}
+
+void free_font_chain(font_chain *chain) {
+    free(chain->fonts);
+    free(chain->subtables);
+    free(chain->slots);
+    memset(chain, 0, sizeof(font_chain));
+}
+
+static size_t slot_index(uint32_t unicode, size_t capacity) {
+    return (unicode * 2654435761u) & (capacity - 1);
+}
+
+static void insert_slot(fallback_slot *slots, size_t capacity, uint32_t unicode, glyph_ref ref) {
+    size_t i = slot_index(unicode, capacity);
+    while (slots[i].unicode != FALLBACK_EMPTY_SLOT) {
+        i = (i + 1) & (capacity - 1);
+    }
+    slots[i].unicode = unicode;
+    slots[i].ref = ref;
+}
+
+static bool grow_slots(font_chain *chain) {
+    size_t capacity = chain->capacity * 2;
+    fallback_slot *slots = malloc(capacity * sizeof(fallback_slot));
+    if (!slots) {
+        return false;
+    }
+    reset_slots(slots, capacity);
+
+    for (size_t i = 0; i < chain->capacity; i++) {
+        if (chain->slots[i].unicode != FALLBACK_EMPTY_SLOT) {
+            insert_slot(slots, capacity, chain->slots[i].unicode, chain->slots[i].ref);
+        }
+    }
+
+    free(chain->slots);
+    chain->slots = slots;
+    chain->capacity = capacity;
+    return true;
+}
+
+// First font with a non-notdef mapping wins; a code point nobody covers
+// resolves to notdef of the primary font. Either way the answer is memoized,
+// unless the table is full and cannot grow.
+glyph_ref resolve_glyph(font_chain *chain, uint32_t unicode) {
+    size_t i = slot_index(unicode, chain->capacity);
+    while (chain->slots[i].unicode != FALLBACK_EMPTY_SLOT) {
+        if (chain->slots[i].unicode == unicode) {
+            chain->hits++;
+            return chain->slots[i].ref;
+        }
+        i = (i + 1) & (chain->capacity - 1);
+    }
+
+    chain->misses++;
+    glyph_ref ref = {0, 0};
+    for (uint16_t f = 0; f < chain->font_count; f++) {
+        uint16_t glyph = get_glyph_index_format4(chain->subtables[f], unicode);
+        if (glyph != 0) {
+            ref.font = f;
+            ref.glyph = glyph;
+            break;
+        }
+    }
+
+    // one slot always stays empty so probing ends
+    if ((chain->count + 1) * 10 > chain->capacity * 7 && !grow_slots(chain) && chain->count + 2 > chain->capacity) {
+        return ref;
+    }
+    insert_slot(chain->slots, chain->capacity, unicode, ref);
+    chain->count++;
+
+    return ref;
+}
@@ -0,0 +1,39 @@
+#ifndef FALLBACK
+#define FALLBACK
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "source.h"
+#include "cmap.h"
+
+#define FALLBACK_INITIAL_CAPACITY 256
+#define FALLBACK_EMPTY_SLOT 0xFFFFFFFFu
+
+typedef struct glyph_ref {
+    uint16_t font;
+    uint16_t glyph;
+} glyph_ref;
+
+typedef struct fallback_slot {
+    uint32_t unicode;
+    glyph_ref ref;
+} fallback_slot;
+
+typedef struct font_chain {
+    ttf_source **fonts;
+    uint8_t **subtables;
+    uint16_t font_count;
+    fallback_slot *slots;
+    size_t capacity;
+    size_t count;
+    uint64_t hits;
+    uint64_t misses;
+} font_chain;
+
+ttf_status init_font_chain(font_chain *chain, ttf_source **fonts, uint16_t font_count, ttf_error *error);
+void free_font_chain(font_chain *chain);
+glyph_ref resolve_glyph(font_chain *chain, uint32_t unicode);
+
+#endif
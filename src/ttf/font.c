@@ -0,0 +1,113 @@
+#include "font.h"
+#include "cmap.h"
+#include "maxp.h"
+#include "loca.h"
+#include "ttc.h"
+#include "validate.h"
+
+// marks glyphs without an outline so failed decodes are not retried
+static glyph_t no_outline;
+
+ttf_status load_font(ttf_font *font, const char *filename, uint32_t face_index, ttf_error *error) {
+    memset(font, 0, sizeof(ttf_font));
+
+    if (load_ttf_source(&font->source, filename)) {
+        return ttf_fail(error, TTF_ERR_IO, "cannot load '%s'", filename);
+    }
+
+    ttf_validation validation = {0};
+    if (select_ttf_face(&font->source, face_index)) {
+        free_font(font);
+        return ttf_fail(error, TTF_ERR_RANGE, "no face %u in '%s'", face_index, filename);
+    }
+    if (validate_ttf_source(&font->source, &validation)) {
+        free_font(font);
+        return ttf_fail(error, TTF_ERR_MALFORMED, "rejected '%s' : %s", filename, validation.reason);
+    }
+
+    maxp_table *maxp = NULL;
+    ttf_status status;
+    if ((status = load_head_table(&font->source, &font->head, error))
+        || (status = load_maxp_table(&font->source, &maxp, error))
+        || (status = load_hhea_table(&font->source, &font->hhea, error))
+        || (status = load_hmtx_table(&font->source, &font->hmtx, error))
+        || (status = load_cmap_subtable(&font->source, &font->cmap_subtable, error))) {
+        free_font(font);
+        return status;
+    }
+
+    // loca is decoded up front so readers never touch the table format again
+    font->glyph_count = get_num_glyphs(maxp);
+    font->locations = malloc((font->glyph_count + 1) * sizeof(uint32_t));
+    font->glyphs = calloc(font->glyph_count, sizeof(_Atomic(glyph_t*)));
+    if (!font->locations || !font->glyphs) {
+        free_font(font);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory indexing '%s'", filename);
+    }
+
+    font->locations[0] = 0;
+    for (uint16_t i = 0; i < font->glyph_count; i++) {
+        uint32_t glyph_offset, glyph_length;
+        if ((status = load_glyph_location(&font->source, font->head, i, &glyph_offset, &glyph_length, error))) {
+            free_font(font);
+            return status;
+        }
+        font->locations[i] = glyph_offset;
+        font->locations[i + 1] = glyph_offset + glyph_length;
+    }
+
+    return TTF_OK;
+}
+
+void free_font(ttf_font *font) {
+    if (font->glyphs) {
+        for (uint16_t i = 0; i < font->glyph_count; i++) {
+            glyph_t *glyph = atomic_load_explicit(&font->glyphs[i], memory_order_relaxed);
+            if (glyph != &no_outline) {
+                free_glyph(glyph);
+            }
+        }
+    }
+    free(font->glyphs);
+    free(font->locations);
+    unload_ttf_source(&font->source);
+    memset(font, 0, sizeof(ttf_font));
+}
+
+uint16_t font_glyph_index(const ttf_font *font, uint32_t unicode) {
+    return get_glyph_index_format4(font->cmap_subtable, unicode);
+}
+
+uint16_t font_advance_width(const ttf_font *font, uint16_t index) {
+    if (index >= font->glyph_count) {
+        return 0;
+    }
+    return get_advance_width(font->hhea, font->hmtx, index);
+}
+
+// Readers race to decode a missing glyph; the first CAS publishes it
+// and the losers free their copy, so lookups never take a lock.
+const glyph_t* get_font_glyph(ttf_font *font, uint16_t index) {
+    if (index >= font->glyph_count) {
+        return NULL;
+    }
+
+    glyph_t *glyph = atomic_load_explicit(&font->glyphs[index], memory_order_acquire);
+    if (!glyph) {
+        glyph_t *decoded = NULL;
+        uint32_t glyph_offset = font->locations[index];
+        uint32_t glyph_length = font->locations[index + 1] - glyph_offset;
+        if (load_glyph(&font->source, glyph_offset, glyph_length, &decoded, NULL)) {
+            decoded = &no_outline;
+        }
+
+        if (atomic_compare_exchange_strong_explicit(&font->glyphs[index], &glyph, decoded,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            glyph = decoded;
+        } else if (decoded != &no_outline) {
+            free_glyph(decoded);
+        }
+    }
+
+    return glyph == &no_outline ? NULL : glyph;
+}
@@ -0,0 +1,33 @@
+#ifndef FONT
+#define FONT
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+#include "hmtx.h"
+#include "glyph.h"
+
+// Everything but the glyph slots is resolved by load_font and never written again,
+// so one ttf_font can be shared by any number of reader threads.
+typedef struct ttf_font {
+    ttf_source source;
+    head_table *head;
+    hhea_table *hhea;
+    long_hor_metric *hmtx;
+    uint8_t *cmap_subtable;
+    uint16_t glyph_count;
+    uint32_t *locations;
+    _Atomic(glyph_t*) *glyphs;
+} ttf_font;
+
+ttf_status load_font(ttf_font *font, const char *filename, uint32_t face_index, ttf_error *error);
+void free_font(ttf_font *font);
+
+uint16_t font_glyph_index(const ttf_font *font, uint32_t unicode);
+uint16_t font_advance_width(const ttf_font *font, uint16_t index);
+const glyph_t* get_font_glyph(ttf_font *font, uint16_t index);
+
+#endif
@@ -0,0 +1,116 @@
+#include <string.h>
+#include <math.h>
+
+#include "fvar.h"
+
+static float fixed_to_float(fixed_t value) {
+    return (int32_t)ntohl(value) / 65536.0f;
+}
+
+int load_fvar(ttf_source *source, fvar_info *fvar) {
+    ttf_table_record fvar_record = {0};
+    ttf_table_record avar_record = {0};
+    memset(fvar, 0, sizeof(fvar_info));
+
+    if (find_table_record(source, &fvar_record, FVAR_TAG)) {
+        return -1;
+    }
+
+    uint8_t *table = (uint8_t*)source->data + ntohl(fvar_record.offset);
+    fvar_header *header = (fvar_header*)table;
+    uint16_t axis_count = ntohs(header->axisCount);
+    uint16_t axis_size = ntohs(header->axisSize);
+
+    if (axis_count == 0 || axis_count > TTF_MAX_AXES) {
+        return -1;
+    }
+
+    uint8_t *axes = table + ntohs(header->axesArrayOffset);
+    for (uint16_t i = 0; i < axis_count; i++) {
+        fvar_axis_record *rec = (fvar_axis_record*)(axes + i * axis_size);
+        memcpy(fvar->axes[i].tag, rec->axisTag, 4);
+        fvar->axes[i].min = fixed_to_float(rec->minValue);
+        fvar->axes[i].def = fixed_to_float(rec->defaultValue);
+        fvar->axes[i].max = fixed_to_float(rec->maxValue);
+    }
+    fvar->axis_count = axis_count;
+
+    if (!find_table_record(source, &avar_record, AVAR_TAG)) {
+        fvar->avar = (uint8_t*)source->data + ntohl(avar_record.offset);
+    }
+
+    return 0;
+}
+
+int find_axis(const fvar_info *fvar, const char tag[4]) {
+    for (uint16_t i = 0; i < fvar->axis_count; i++) {
+        if (memcmp(fvar->axes[i].tag, tag, 4) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// avar segment maps are piecewise linear over F2Dot14 values
+static int16_t apply_segment_map(uint16_t *map, uint16_t pair_count, int16_t value) {
+    int16_t *pairs = (int16_t*)map;
+
+    if (pair_count == 0) {
+        return value;
+    }
+
+    int16_t from_prev = (int16_t)ntohs(pairs[0]);
+    int16_t to_prev = (int16_t)ntohs(pairs[1]);
+    if (value <= from_prev) {
+        return to_prev;
+    }
+
+    for (uint16_t i = 1; i < pair_count; i++) {
+        int16_t from = (int16_t)ntohs(pairs[i * 2]);
+        int16_t to = (int16_t)ntohs(pairs[i * 2 + 1]);
+
+        if (value == from) {
+            return to;
+        }
+        if (value < from) {
+            int32_t span = from - from_prev;
+            return (int16_t)(to_prev + ((int32_t)(value - from_prev) * (to - to_prev) + span / 2) / span);
+        }
+        from_prev = from;
+        to_prev = to;
+    }
+
+    return to_prev;
+}
+
+void normalize_axis_coords(const fvar_info *fvar, const float *user_coords, int16_t *normalized) {
+    for (uint16_t i = 0; i < fvar->axis_count; i++) {
+        const fvar_axis *axis = &fvar->axes[i];
+        float v = user_coords[i];
+        float n = 0.0f;
+
+        if (v < axis->min) v = axis->min;
+        if (v > axis->max) v = axis->max;
+
+        if (v < axis->def && axis->def > axis->min) {
+            n = (v - axis->def) / (axis->def - axis->min);
+        } else if (v > axis->def && axis->max > axis->def) {
+            n = (v - axis->def) / (axis->max - axis->def);
+        }
+
+        normalized[i] = (int16_t)floorf(n * 16384.0f + 0.5f);
+    }
+
+    if (!fvar->avar) {
+        return;
+    }
+
+    // avar: version(4), reserved(2), axisCount(2), then one segment map per axis
+    uint16_t *map = (uint16_t*)(fvar->avar + 8);
+    uint16_t avar_axes = ntohs(*(uint16_t*)(fvar->avar + 6));
+    for (uint16_t i = 0; i < avar_axes && i < fvar->axis_count; i++) {
+        uint16_t pair_count = ntohs(map[0]);
+        normalized[i] = apply_segment_map(map + 1, pair_count, normalized[i]);
+        map += 1 + pair_count * 2;
+    }
+}
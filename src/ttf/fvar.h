@@ -0,0 +1,57 @@
+#ifndef FVAR
+#define FVAR
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+
+#define FVAR_TAG "fvar"
+#define AVAR_TAG "avar"
+
+#define TTF_MAX_AXES 16
+
+#pragma pack(1)
+
+typedef struct fvar_header {
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+    uint16_t axesArrayOffset;
+    uint16_t reserved;
+    uint16_t axisCount;
+    uint16_t axisSize;
+    uint16_t instanceCount;
+    uint16_t instanceSize;
+} fvar_header;
+
+typedef struct fvar_axis_record {
+    char axisTag[4];
+    fixed_t minValue;
+    fixed_t defaultValue;
+    fixed_t maxValue;
+    uint16_t flags;
+    uint16_t axisNameID;
+} fvar_axis_record;
+
+#pragma pack()
+
+typedef struct fvar_axis {
+    char tag[4];
+    float min;
+    float def;
+    float max;
+} fvar_axis;
+
+typedef struct fvar_info {
+    uint16_t axis_count;
+    fvar_axis axes[TTF_MAX_AXES];
+    uint8_t *avar;
+} fvar_info;
+
+int load_fvar(ttf_source *source, fvar_info *fvar);
+int find_axis(const fvar_info *fvar, const char tag[4]);
+void normalize_axis_coords(const fvar_info *fvar, const float *user_coords, int16_t *normalized);
+
+#endif
@@ -1,35 +1,78 @@
 #include "glyph.h"
+#include "validate.h"
 
 
-glyph_t* try_load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length) {
-    
+// trusted sources were validated whole, everything else is checked glyph by glyph
+static ttf_status check_untrusted_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, ttf_error *error) {
+    ttf_validation validation;
+    if (!source->trusted && validate_glyph(source, glyph_offset, glyph_length, &validation)) {
+        return ttf_fail(error, TTF_ERR_MALFORMED, "glyph rejected : %s", validation.reason);
+    }
+    return TTF_OK;
+}
+
+// shared by the decoder and the iterator: locates the end points and the flag stream
+static ttf_status find_simple_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_header **header, uint8_t **flags, ttf_error *error) {
     ttf_table_record glyf_record = {0};
-    try_load_table_record(source, &glyf_record, FLYPH_TAG);
+    ttf_status status = load_table_record(source, &glyf_record, FLYPH_TAG, error);
+    if (status) {
+        return status;
+    }
 
-    uint8_t *glyf_table = (uint8_t*)source->data + ntohl(glyf_record.offset);
-    uint8_t *glyph_data = glyf_table + glyph_offset;
+    if (glyph_length == 0) {
+        return ttf_fail(error, TTF_ERR_EMPTY_GLYPH, "glyph has no outline data");
+    }
+    status = check_untrusted_glyph(source, glyph_offset, glyph_length, error);
+    if (status) {
+        return status;
+    }
 
-    glyph_header *gh = (glyph_header*)glyph_data;
+    uint8_t *glyf_table = (uint8_t*)source->data + ntohl(glyf_record.offset);
+    glyph_header *gh = (glyph_header*)(glyf_table + glyph_offset);
     int16_t numberOfContours = (int16_t)ntohs(gh->numberOfContours);
 
+    if (numberOfContours == 0) {
+        return ttf_fail(error, TTF_ERR_EMPTY_GLYPH, "glyph has zero contours");
+    }
+    if (numberOfContours < 0) {
+        return ttf_fail(error, TTF_ERR_UNSUPPORTED, "composite glyphs are not decoded");
+    }
+
+    uint8_t *ptr = (uint8_t*)(gh + 1) + numberOfContours * sizeof(uint16_t);
+    uint16_t instructionLength = ntohs(*(uint16_t*)ptr);
+
+    *header = gh;
+    *flags = ptr + 2 + instructionLength;
+    return TTF_OK;
+}
 
-    if (numberOfContours <= 0) {
-        elog("glyph has zero contours");
+ttf_status load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_t **out, ttf_error *error) {
+    glyph_header *gh;
+    uint8_t *ptr;
+    ttf_status status = find_simple_glyph(source, glyph_offset, glyph_length, &gh, &ptr, error);
+    if (status) {
+        return status;
     }
 
-    uint16_t *endPtsOfContours = (uint16_t*)(glyph_data + sizeof(glyph_header));
+    int16_t numberOfContours = (int16_t)ntohs(gh->numberOfContours);
+    uint16_t *endPtsOfContours = (uint16_t*)(gh + 1);
     uint16_t numPoints = ntohs(endPtsOfContours[numberOfContours - 1]) + 1;
-    
-    uint8_t *ptr = (uint8_t*)(endPtsOfContours + numberOfContours);
-    uint16_t instructionLength = ntohs(*(uint16_t*)ptr);
-    ptr += 2 + instructionLength;
-    
 
-    glyph_t *glyph = (glyph_t*)malloc(sizeof(glyph_t));
+
+    glyph_t *glyph = (glyph_t*)calloc(1, sizeof(glyph_t));
+    if (!glyph) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory decoding glyph");
+    }
     glyph->count = numPoints;
 
     // Read flags
     glyph->flags = malloc(numPoints);
+    glyph->x_poss = malloc(numPoints * sizeof(int16_t));
+    glyph->y_poss = malloc(numPoints * sizeof(int16_t));
+    if (!glyph->flags || !glyph->x_poss || !glyph->y_poss) {
+        free_glyph(glyph);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory decoding glyph");
+    }
     int flag_idx = 0;
     while (flag_idx < numPoints) {
         uint8_t flag = *ptr++;
@@ -44,7 +87,6 @@ glyph_t* try_load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyp
     }
     
     // Read X coordinates
-    glyph->x_poss = malloc(numPoints * sizeof(int16_t));
     int16_t x = 0;
     for (int i = 0; i < numPoints; i++) {
         uint8_t flag = glyph->flags[i];
@@ -62,7 +104,6 @@ glyph_t* try_load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyp
     }
     
     // Read Y coordinates
-    glyph->y_poss = malloc(numPoints * sizeof(int16_t));
     int16_t y = 0;
     for (int i = 0; i < numPoints; i++) {
         uint8_t flag = glyph->flags[i];
@@ -87,5 +128,307 @@ glyph_t* try_load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyp
     glyph->endPtsOfContours = endPtsOfContours;
     glyph->numberOfContours = numberOfContours;
 
-    return glyph;
+    *out = glyph;
+    return TTF_OK;
+}
+
+// the glyph program of a simple glyph, code points into the glyf table
+ttf_status load_glyph_instructions(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, const uint8_t **code, uint16_t *length, ttf_error *error) {
+    glyph_header *gh;
+    uint8_t *flags;
+    ttf_status status = find_simple_glyph(source, glyph_offset, glyph_length, &gh, &flags, error);
+    if (status) {
+        return status;
+    }
+    if ((size_t)(flags - (uint8_t*)gh) > glyph_length) {
+        return ttf_fail(error, TTF_ERR_MALFORMED, "glyph instructions run past the glyph");
+    }
+
+    uint8_t *lengthPtr = (uint8_t*)(gh + 1) + (int16_t)ntohs(gh->numberOfContours) * sizeof(uint16_t);
+    *length = ntohs(*(uint16_t*)lengthPtr);
+    *code = lengthPtr + 2;
+    return TTF_OK;
+}
+
+ttf_status init_glyph_iter(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_iter *iter, ttf_error *error) {
+    glyph_header *gh;
+    uint8_t *ptr;
+    ttf_status status = find_simple_glyph(source, glyph_offset, glyph_length, &gh, &ptr, error);
+    if (status) {
+        return status;
+    }
+
+    memset(iter, 0, sizeof(glyph_iter));
+    iter->xMin = (int16_t)ntohs(gh->xMin);
+    iter->yMin = (int16_t)ntohs(gh->yMin);
+    iter->xMax = (int16_t)ntohs(gh->xMax);
+    iter->yMax = (int16_t)ntohs(gh->yMax);
+    int16_t numberOfContours = (int16_t)ntohs(gh->numberOfContours);
+    iter->endPtsOfContours = (uint16_t*)(gh + 1);
+    iter->count = ntohs(iter->endPtsOfContours[numberOfContours - 1]) + 1;
+    iter->flags = ptr;
+
+    // one pass over the flags sizes the x stream, nothing is stored
+    uint32_t x_bytes = 0;
+    uint16_t seen = 0;
+    while (seen < iter->count) {
+        uint8_t flag = *ptr++;
+        uint16_t run = 1;
+        if (flag & REPEAT_FLAG) {
+            run += *ptr++;
+        }
+        if (flag & X_SHORT_VECTOR) {
+            x_bytes += run;
+        } else if (!(flag & X_IS_SAME_OR_POSITIVE)) {
+            x_bytes += run * 2;
+        }
+        seen += run;
+    }
+
+    iter->xs = ptr;
+    iter->ys = ptr + x_bytes;
+    return TTF_OK;
+}
+
+bool next_glyph_point(glyph_iter *iter, glyph_point *point) {
+    if (iter->index >= iter->count) {
+        return false;
+    }
+
+    if (iter->repeat) {
+        iter->repeat--;
+    } else {
+        iter->flag = *iter->flags++;
+        if (iter->flag & REPEAT_FLAG) {
+            iter->repeat = *iter->flags++;
+        }
+    }
+    uint8_t flag = iter->flag;
+
+    if (flag & X_SHORT_VECTOR) {
+        uint8_t val = *iter->xs++;
+        iter->x += (flag & X_IS_SAME_OR_POSITIVE) ? val : -val;
+    } else if (!(flag & X_IS_SAME_OR_POSITIVE)) {
+        iter->x += (int16_t)ntohs(*(uint16_t*)iter->xs);
+        iter->xs += 2;
+    }
+
+    if (flag & Y_SHORT_VECTOR) {
+        uint8_t val = *iter->ys++;
+        iter->y += (flag & Y_IS_SAME_OR_POSITIVE) ? val : -val;
+    } else if (!(flag & Y_IS_SAME_OR_POSITIVE)) {
+        iter->y += (int16_t)ntohs(*(uint16_t*)iter->ys);
+        iter->ys += 2;
+    }
+
+    point->x = iter->x;
+    point->y = iter->y;
+    point->on_curve = flag & ON_CURVE_POINT;
+    point->contour_end = iter->index == ntohs(iter->endPtsOfContours[iter->contour]);
+    if (point->contour_end) {
+        iter->contour++;
+    }
+    iter->index++;
+    return true;
+}
+
+// component records are only read once the glyph passed validation, which
+// checked that every record and its arguments fit in the glyph
+ttf_status init_component_iter(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, component_iter *iter, ttf_error *error) {
+    ttf_table_record glyf_record = {0};
+    ttf_status status = load_table_record(source, &glyf_record, FLYPH_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    if (glyph_length == 0) {
+        return ttf_fail(error, TTF_ERR_EMPTY_GLYPH, "glyph has no outline data");
+    }
+    status = check_untrusted_glyph(source, glyph_offset, glyph_length, error);
+    if (status) {
+        return status;
+    }
+
+    glyph_header *gh = (glyph_header*)((uint8_t*)source->data + ntohl(glyf_record.offset) + glyph_offset);
+    if ((int16_t)ntohs(gh->numberOfContours) >= 0) {
+        return ttf_fail(error, TTF_ERR_UNSUPPORTED, "glyph is not a composite");
+    }
+
+    iter->cursor = (uint8_t*)(gh + 1);
+    iter->more = true;
+    return TTF_OK;
+}
+
+bool next_glyph_component(component_iter *iter, glyph_component *component) {
+    if (!iter->more) {
+        return false;
+    }
+
+    uint8_t *ptr = iter->cursor;
+    uint16_t flags = ntohs(*(uint16_t*)ptr);
+    component->flags = flags;
+    component->glyph = ntohs(*(uint16_t*)(ptr + 2));
+    ptr += 4;
+
+    if (flags & ARG_1_AND_2_ARE_WORDS) {
+        uint16_t arg1 = ntohs(*(uint16_t*)ptr), arg2 = ntohs(*(uint16_t*)(ptr + 2));
+        component->arg1 = (flags & ARGS_ARE_XY_VALUES) ? (int16_t)arg1 : arg1;
+        component->arg2 = (flags & ARGS_ARE_XY_VALUES) ? (int16_t)arg2 : arg2;
+        ptr += 4;
+    } else {
+        component->arg1 = (flags & ARGS_ARE_XY_VALUES) ? (int8_t)ptr[0] : ptr[0];
+        component->arg2 = (flags & ARGS_ARE_XY_VALUES) ? (int8_t)ptr[1] : ptr[1];
+        ptr += 2;
+    }
+
+    component->x_scale = component->y_scale = 0x4000;
+    component->scale01 = component->scale10 = 0;
+    if (flags & WE_HAVE_A_SCALE) {
+        component->x_scale = component->y_scale = (int16_t)ntohs(*(uint16_t*)ptr);
+        ptr += 2;
+    } else if (flags & WE_HAVE_AN_X_AND_Y_SCALE) {
+        component->x_scale = (int16_t)ntohs(*(uint16_t*)ptr);
+        component->y_scale = (int16_t)ntohs(*(uint16_t*)(ptr + 2));
+        ptr += 4;
+    } else if (flags & WE_HAVE_A_TWO_BY_TWO) {
+        component->x_scale = (int16_t)ntohs(*(uint16_t*)ptr);
+        component->scale01 = (int16_t)ntohs(*(uint16_t*)(ptr + 2));
+        component->scale10 = (int16_t)ntohs(*(uint16_t*)(ptr + 4));
+        component->y_scale = (int16_t)ntohs(*(uint16_t*)(ptr + 6));
+        ptr += 8;
+    }
+
+    iter->cursor = ptr;
+    iter->more = flags & MORE_COMPONENTS;
+    return true;
+}
+
+static void read_glyph_metrics(uint8_t *glyph_data, uint32_t glyph_length, glyph_metrics *metrics) {
+    memset(metrics, 0, sizeof(glyph_metrics));
+    if (glyph_length < sizeof(glyph_header)) {
+        return;
+    }
+
+    glyph_header *gh = (glyph_header*)glyph_data;
+    metrics->xMin = (int16_t)ntohs(gh->xMin);
+    metrics->yMin = (int16_t)ntohs(gh->yMin);
+    metrics->xMax = (int16_t)ntohs(gh->xMax);
+    metrics->yMax = (int16_t)ntohs(gh->yMax);
+    metrics->numberOfContours = (int16_t)ntohs(gh->numberOfContours);
+
+    // the last end point is the only part of the outline we need
+    if (metrics->numberOfContours > 0) {
+        uint16_t *endPtsOfContours = (uint16_t*)(glyph_data + sizeof(glyph_header));
+        metrics->count = ntohs(endPtsOfContours[metrics->numberOfContours - 1]) + 1;
+    }
+}
+
+ttf_status load_glyph_metrics(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_metrics *metrics, ttf_error *error) {
+    ttf_table_record glyf_record = {0};
+    ttf_status status = load_table_record(source, &glyf_record, FLYPH_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    status = check_untrusted_glyph(source, glyph_offset, glyph_length, error);
+    if (status) {
+        return status;
+    }
+
+    uint8_t *glyf_table = (uint8_t*)source->data + ntohl(glyf_record.offset);
+    read_glyph_metrics(glyf_table + glyph_offset, glyph_length, metrics);
+    return TTF_OK;
+}
+
+ttf_status load_glyph_metrics_batch(ttf_source *source, head_table *head, const uint16_t *indices, uint32_t count, glyph_metrics_batch *batch, ttf_error *error) {
+    ttf_table_record glyf_record = {0};
+    ttf_table_record loca_record = {0};
+    ttf_status status;
+    if ((status = load_table_record(source, &glyf_record, FLYPH_TAG, error))
+        || (status = load_table_record(source, &loca_record, LOCA_TAG, error))) {
+        return status;
+    }
+
+    // tables are resolved once, then every glyph costs two loca reads and a header
+    uint8_t *glyf_table = (uint8_t*)source->data + ntohl(glyf_record.offset);
+    uint8_t *loca_table = (uint8_t*)source->data + ntohl(loca_record.offset);
+    bool short_format = is_short_format(head);
+    uint32_t entries = ntohl(loca_record.length) / (short_format ? 2 : 4);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t index = indices[i];
+        if ((uint32_t)index + 1 >= entries) {
+            return ttf_fail(error, TTF_ERR_RANGE, "glyph %u has no loca entry", index);
+        }
+
+        uint32_t start, end;
+        if (short_format) {
+            start = ntohs(((uint16_t*)loca_table)[index]) * 2u;
+            end = ntohs(((uint16_t*)loca_table)[index + 1]) * 2u;
+        } else {
+            start = ntohl(((uint32_t*)loca_table)[index]);
+            end = ntohl(((uint32_t*)loca_table)[index + 1]);
+        }
+
+        uint32_t length = end > start ? end - start : 0;
+        if ((status = check_untrusted_glyph(source, start, length, error))) {
+            return status;
+        }
+
+        glyph_metrics metrics;
+        read_glyph_metrics(glyf_table + start, length, &metrics);
+        batch->xMin[i] = metrics.xMin;
+        batch->yMin[i] = metrics.yMin;
+        batch->xMax[i] = metrics.xMax;
+        batch->yMax[i] = metrics.yMax;
+        batch->numberOfContours[i] = metrics.numberOfContours;
+        batch->count[i] = metrics.count;
+    }
+
+    return TTF_OK;
+}
+
+glyph_t* copy_glyph(const glyph_t *glyph) {
+    glyph_t *copy = (glyph_t*)malloc(sizeof(glyph_t));
+    if (!copy) {
+        return NULL;
+    }
+    *copy = *glyph;
+    copy->owns_end_points = false;
+
+    copy->flags = malloc(glyph->count);
+    copy->x_poss = malloc(glyph->count * sizeof(int16_t));
+    copy->y_poss = malloc(glyph->count * sizeof(int16_t));
+    if (!copy->flags || !copy->x_poss || !copy->y_poss) {
+        free_glyph(copy);
+        return NULL;
+    }
+    memcpy(copy->flags, glyph->flags, glyph->count);
+    memcpy(copy->x_poss, glyph->x_poss, glyph->count * sizeof(int16_t));
+    memcpy(copy->y_poss, glyph->y_poss, glyph->count * sizeof(int16_t));
+
+    return copy;
+}
+
+void free_glyph(glyph_t *glyph) {
+    if (!glyph) {
+        return;
+    }
+    free(glyph->flags);
+    free(glyph->x_poss);
+    free(glyph->y_poss);
+    if (glyph->owns_end_points) {
+        free(glyph->endPtsOfContours);
+    }
+    free(glyph);
+}
+
+int16_t get_contour_count(ttf_source *source, uint32_t glyph_offset) {
+    ttf_table_record glyf_record = {0};
+    if (find_table_record(source, &glyf_record, FLYPH_TAG)) {
+        return 0;
+    }
+
+    glyph_header *gh = (glyph_header*)((uint8_t*)source->data + ntohl(glyf_record.offset) + glyph_offset);
+    return (int16_t)ntohs(gh->numberOfContours);
 }
@@ -2,15 +2,33 @@
 #define GLYPH
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "source.h"
 #include "ttf.h"
+#include "loca.h"
 #include "logger.h"
 
 #define FLYPH_TAG "glyf"
 
+#define ON_CURVE_POINT 0x01
+#define X_SHORT_VECTOR 0x02
+#define Y_SHORT_VECTOR 0x04
+#define REPEAT_FLAG 0x08
+#define X_IS_SAME_OR_POSITIVE 0x10
+#define Y_IS_SAME_OR_POSITIVE 0x20
+
+#define ARG_1_AND_2_ARE_WORDS 0x0001
+#define ARGS_ARE_XY_VALUES 0x0002
+#define WE_HAVE_A_SCALE 0x0008
+#define MORE_COMPONENTS 0x0020
+#define WE_HAVE_AN_X_AND_Y_SCALE 0x0040
+#define WE_HAVE_A_TWO_BY_TWO 0x0080
+#define WE_HAVE_INSTRUCTIONS 0x0100
+
 #pragma pack(1)
 
 typedef struct glyph_header {
@@ -33,9 +51,89 @@ typedef struct glyph_t {
     int16_t *y_poss;
     uint16_t count;
     int16_t numberOfContours;
+    // big-endian; points into the glyf table unless the glyph was rebuilt with
+    // fewer points, copies always share it
     uint16_t *endPtsOfContours;
+    bool owns_end_points;
 } glyph_t;
 
-glyph_t* try_load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length);
+// bounding box and sizes read from the glyph header without decoding points,
+// count stays 0 for composite and empty glyphs
+typedef struct glyph_metrics {
+    int16_t xMin;
+    int16_t yMin;
+    int16_t xMax;
+    int16_t yMax;
+    int16_t numberOfContours;
+    uint16_t count;
+} glyph_metrics;
+
+// walks a simple glyph's points straight from the glyf bytes,
+// x and y cursors start where the flag and x streams end; the box is the header's
+typedef struct glyph_iter {
+    int16_t xMin;
+    int16_t yMin;
+    int16_t xMax;
+    int16_t yMax;
+    uint8_t *flags;
+    uint8_t *xs;
+    uint8_t *ys;
+    uint16_t *endPtsOfContours;
+    uint16_t count;
+    uint16_t index;
+    uint16_t contour;
+    uint8_t flag;
+    uint8_t repeat;
+    int16_t x;
+    int16_t y;
+} glyph_iter;
+
+typedef struct glyph_point {
+    int16_t x;
+    int16_t y;
+    bool on_curve;
+    bool contour_end;
+} glyph_point;
+
+// one component record of a composite glyph; args are an x/y offset when
+// ARGS_ARE_XY_VALUES is set and point numbers otherwise, the transform is
+// F2Dot14 in the spec's order and defaults to identity
+typedef struct glyph_component {
+    uint16_t flags;
+    uint16_t glyph;
+    int32_t arg1;
+    int32_t arg2;
+    int16_t x_scale;
+    int16_t scale01;
+    int16_t scale10;
+    int16_t y_scale;
+} glyph_component;
+
+typedef struct component_iter {
+    uint8_t *cursor;
+    bool more;
+} component_iter;
+
+// caller-owned arrays, one slot per requested glyph id
+typedef struct glyph_metrics_batch {
+    int16_t *xMin;
+    int16_t *yMin;
+    int16_t *xMax;
+    int16_t *yMax;
+    int16_t *numberOfContours;
+    uint16_t *count;
+} glyph_metrics_batch;
+
+ttf_status load_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_t **glyph, ttf_error *error);
+ttf_status load_glyph_metrics(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_metrics *metrics, ttf_error *error);
+ttf_status load_glyph_metrics_batch(ttf_source *source, head_table *head, const uint16_t *indices, uint32_t count, glyph_metrics_batch *batch, ttf_error *error);
+ttf_status load_glyph_instructions(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, const uint8_t **code, uint16_t *length, ttf_error *error);
+ttf_status init_glyph_iter(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, glyph_iter *iter, ttf_error *error);
+bool next_glyph_point(glyph_iter *iter, glyph_point *point);
+ttf_status init_component_iter(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, component_iter *iter, ttf_error *error);
+bool next_glyph_component(component_iter *iter, glyph_component *component);
+glyph_t* copy_glyph(const glyph_t *glyph);
+void free_glyph(glyph_t *glyph);
+int16_t get_contour_count(ttf_source *source, uint32_t glyph_offset);
 
 #endif
@@ -0,0 +1,346 @@
+#include <string.h>
+
+#include "gvar.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define POINTS_ARE_WORDS 0x80
+#define POINT_RUN_COUNT_MASK 0x7F
+#define DELTAS_ARE_ZERO 0x80
+#define DELTAS_ARE_WORDS 0x40
+#define DELTA_RUN_COUNT_MASK 0x3F
+
+int load_gvar(ttf_source *source, gvar_table *gvar) {
+    ttf_table_record gvar_record = {0};
+    memset(gvar, 0, sizeof(gvar_table));
+
+    if (find_table_record(source, &gvar_record, GVAR_TAG)) {
+        return -1;
+    }
+
+    uint8_t *table = (uint8_t*)source->data + ntohl(gvar_record.offset);
+    gvar_header *header = (gvar_header*)table;
+
+    gvar->table = table;
+    gvar->axis_count = ntohs(header->axisCount);
+    gvar->shared_tuple_count = ntohs(header->sharedTupleCount);
+    gvar->glyph_count = ntohs(header->glyphCount);
+    gvar->shared_tuples = (int16_t*)(table + ntohl(header->sharedTuplesOffset));
+    gvar->variation_data = table + ntohl(header->glyphVariationDataArrayOffset);
+    gvar->offsets = table + sizeof(gvar_header);
+    gvar->long_offsets = ntohs(header->flags) & GVAR_LONG_OFFSETS;
+
+    return 0;
+}
+
+// peak/start/end point at big-endian F2Dot14 arrays inside the table
+float tuple_scalar(const int16_t *coords, uint16_t axis_count, const int16_t *peak, const int16_t *start, const int16_t *end) {
+    float scalar = 1.0f;
+
+    for (uint16_t i = 0; i < axis_count; i++) {
+        int16_t p = (int16_t)ntohs(peak[i]);
+        int16_t v = coords[i];
+
+        if (p == 0 || v == p) {
+            continue;
+        }
+
+        if (start && end) {
+            int16_t s = (int16_t)ntohs(start[i]);
+            int16_t e = (int16_t)ntohs(end[i]);
+
+            if (s > p || p > e || (s < 0 && e > 0)) {
+                continue;
+            }
+            if (v < s || v > e) {
+                return 0.0f;
+            }
+            if (v < p) {
+                scalar *= (float)(v - s) / (float)(p - s);
+            } else {
+                scalar *= (float)(e - v) / (float)(e - p);
+            }
+        } else {
+            if (v == 0 || (v < 0) != (p < 0) || (p > 0 ? v > p : v < p)) {
+                return 0.0f;
+            }
+            scalar *= (float)v / (float)p;
+        }
+    }
+
+    return scalar;
+}
+
+void compute_shared_scalars(const gvar_table *gvar, const int16_t *coords, float *scalars) {
+    for (uint16_t i = 0; i < gvar->shared_tuple_count; i++) {
+        const int16_t *peak = gvar->shared_tuples + i * gvar->axis_count;
+        scalars[i] = tuple_scalar(coords, gvar->axis_count, peak, NULL, NULL);
+    }
+}
+
+void accumulate_deltas(float *acc, const float *delta, float scalar, size_t count) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    __m128 s = _mm_set1_ps(scalar);
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps(acc + i);
+        __m128 d = _mm_loadu_ps(delta + i);
+        _mm_storeu_ps(acc + i, _mm_add_ps(a, _mm_mul_ps(s, d)));
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t s = vdupq_n_f32(scalar);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t a = vld1q_f32(acc + i);
+        float32x4_t d = vld1q_f32(delta + i);
+        vst1q_f32(acc + i, vmlaq_f32(a, s, d));
+    }
+#endif
+
+    for (; i < count; i++) {
+        acc[i] += scalar * delta[i];
+    }
+}
+
+static uint8_t* decode_packed_points(uint8_t *p, uint16_t *points, uint16_t capacity, uint16_t *count) {
+    uint16_t total = *p++;
+    if (total & POINTS_ARE_WORDS) {
+        total = ((total & POINT_RUN_COUNT_MASK) << 8) | *p++;
+    }
+
+    // zero means every point of the glyph, phantom points included
+    *count = 0;
+    if (total == 0) {
+        return p;
+    }
+
+    uint16_t point = 0;
+    uint16_t n = 0;
+    while (n < total) {
+        uint8_t control = *p++;
+        uint16_t run = (control & POINT_RUN_COUNT_MASK) + 1;
+
+        for (uint16_t i = 0; i < run && n < total; i++) {
+            if (control & POINTS_ARE_WORDS) {
+                point += ntohs(*(uint16_t*)p);
+                p += 2;
+            } else {
+                point += *p++;
+            }
+            if (n < capacity) {
+                points[n] = point;
+            }
+            n++;
+        }
+    }
+
+    *count = n < capacity ? n : capacity;
+    return p;
+}
+
+static uint8_t* decode_packed_deltas(uint8_t *p, float *deltas, uint16_t count) {
+    uint16_t n = 0;
+
+    while (n < count) {
+        uint8_t control = *p++;
+        uint16_t run = (control & DELTA_RUN_COUNT_MASK) + 1;
+
+        for (uint16_t i = 0; i < run && n < count; i++) {
+            if (control & DELTAS_ARE_ZERO) {
+                deltas[n++] = 0.0f;
+            } else if (control & DELTAS_ARE_WORDS) {
+                deltas[n++] = (int16_t)ntohs(*(uint16_t*)p);
+                p += 2;
+            } else {
+                deltas[n++] = (int8_t)*p++;
+            }
+        }
+    }
+
+    return p;
+}
+
+static void interpolate_untouched(const int16_t *coords, float *deltas, const bool *touched, int first, int last) {
+    int start = -1;
+    for (int i = first; i <= last; i++) {
+        if (touched[i]) {
+            start = i;
+            break;
+        }
+    }
+    if (start < 0) {
+        return;
+    }
+
+    int count = last - first + 1;
+    int ref = start;
+    do {
+        int next = ref;
+        do {
+            next = next == last ? first : next + 1;
+        } while (!touched[next]);
+
+        float c1 = coords[ref], c2 = coords[next];
+        float d1 = deltas[ref], d2 = deltas[next];
+        if (c1 > c2) {
+            float t = c1; c1 = c2; c2 = t;
+            t = d1; d1 = d2; d2 = t;
+        }
+
+        for (int i = ref == last ? first : ref + 1; i != next; i = i == last ? first : i + 1) {
+            float c = coords[i];
+            if (c1 == c2) {
+                deltas[i] = d1 == d2 ? d1 : 0.0f;
+            } else if (c <= c1) {
+                deltas[i] = d1;
+            } else if (c >= c2) {
+                deltas[i] = d2;
+            } else {
+                deltas[i] = d1 + (c - c1) * (d2 - d1) / (c2 - c1);
+            }
+        }
+
+        ref = next;
+        count--;
+    } while (ref != start && count > 0);
+}
+
+// Adds the scaled deltas of every active tuple to acc_x/acc_y (base->count entries each).
+// Sparse tuples are expanded with IUP against the base outline first. Returns -1 for an
+// index past the table or when the scratch buffers cannot be allocated.
+int apply_glyph_variations(const gvar_table *gvar, uint16_t glyph_index, const int16_t *coords,
+                           const float *shared_scalars, const glyph_t *base, float *acc_x, float *acc_y) {
+    if (glyph_index >= gvar->glyph_count) {
+        return -1;
+    }
+
+    uint32_t start, end;
+    if (gvar->long_offsets) {
+        uint32_t *offsets = (uint32_t*)gvar->offsets;
+        start = ntohl(offsets[glyph_index]);
+        end = ntohl(offsets[glyph_index + 1]);
+    } else {
+        uint16_t *offsets = (uint16_t*)gvar->offsets;
+        start = ntohs(offsets[glyph_index]) * 2;
+        end = ntohs(offsets[glyph_index + 1]) * 2;
+    }
+    if (end <= start) {
+        return 0;
+    }
+
+    uint8_t *data = gvar->variation_data + start;
+    uint16_t tuple_info = ntohs(*(uint16_t*)data);
+    uint16_t tuple_count = tuple_info & TUPLE_COUNT_MASK;
+    uint8_t *header = data + 4;
+    uint8_t *serialized = data + ntohs(*(uint16_t*)(data + 2));
+
+    uint16_t count = base->count;
+    uint16_t total = count + GVAR_PHANTOM_POINTS;
+
+    uint16_t *shared_points = malloc(total * sizeof(uint16_t) * 2);
+    uint16_t *private_points = shared_points + total;
+    float *dx = malloc(total * sizeof(float) * 2);
+    float *dy = dx + total;
+    bool *touched = malloc(total);
+    if (!shared_points || !dx || !touched) {
+        free(shared_points);
+        free(dx);
+        free(touched);
+        return -1;
+    }
+
+    uint16_t shared_count = 0;
+    if (tuple_info & TUPLES_SHARE_POINT_NUMBERS) {
+        serialized = decode_packed_points(serialized, shared_points, total, &shared_count);
+    }
+
+    for (uint16_t t = 0; t < tuple_count; t++) {
+        uint16_t data_size = ntohs(*(uint16_t*)header);
+        uint16_t tuple_index = ntohs(*(uint16_t*)(header + 2));
+        header += 4;
+
+        const int16_t *peak;
+        if (tuple_index & EMBEDDED_PEAK_TUPLE) {
+            peak = (int16_t*)header;
+            header += gvar->axis_count * 2;
+        } else {
+            peak = gvar->shared_tuples + (tuple_index & TUPLE_INDEX_MASK) * gvar->axis_count;
+        }
+
+        const int16_t *inter_start = NULL, *inter_end = NULL;
+        if (tuple_index & INTERMEDIATE_REGION) {
+            inter_start = (int16_t*)header;
+            inter_end = inter_start + gvar->axis_count;
+            header += gvar->axis_count * 4;
+        }
+
+        uint8_t *tuple_data = serialized;
+        serialized += data_size;
+
+        float scalar;
+        if (shared_scalars && !(tuple_index & (EMBEDDED_PEAK_TUPLE | INTERMEDIATE_REGION))) {
+            scalar = shared_scalars[tuple_index & TUPLE_INDEX_MASK];
+        } else {
+            scalar = tuple_scalar(coords, gvar->axis_count, peak, inter_start, inter_end);
+        }
+        if (scalar == 0.0f) {
+            continue;
+        }
+
+        uint16_t *points = shared_points;
+        uint16_t point_count = shared_count;
+        if (tuple_index & PRIVATE_POINT_NUMBERS) {
+            tuple_data = decode_packed_points(tuple_data, private_points, total, &point_count);
+            points = private_points;
+        }
+
+        if (point_count == 0) {
+            tuple_data = decode_packed_deltas(tuple_data, dx, total);
+            decode_packed_deltas(tuple_data, dy, total);
+        } else {
+            float *sparse_x = malloc(point_count * sizeof(float) * 2);
+            if (!sparse_x) {
+                free(shared_points);
+                free(dx);
+                free(touched);
+                return -1;
+            }
+            float *sparse_y = sparse_x + point_count;
+            tuple_data = decode_packed_deltas(tuple_data, sparse_x, point_count);
+            decode_packed_deltas(tuple_data, sparse_y, point_count);
+
+            memset(dx, 0, count * sizeof(float));
+            memset(dy, 0, count * sizeof(float));
+            memset(touched, 0, count);
+            for (uint16_t i = 0; i < point_count; i++) {
+                if (points[i] < count) {
+                    dx[points[i]] = sparse_x[i];
+                    dy[points[i]] = sparse_y[i];
+                    touched[points[i]] = true;
+                }
+            }
+            free(sparse_x);
+
+            int first = 0;
+            for (int16_t c = 0; c < base->numberOfContours; c++) {
+                int last = ntohs(base->endPtsOfContours[c]);
+                interpolate_untouched(base->x_poss, dx, touched, first, last);
+                interpolate_untouched(base->y_poss, dy, touched, first, last);
+                first = last + 1;
+            }
+        }
+
+        accumulate_deltas(acc_x, dx, scalar, count);
+        accumulate_deltas(acc_y, dy, scalar, count);
+    }
+
+    free(shared_points);
+    free(dx);
+    free(touched);
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef GVAR
+#define GVAR
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "glyph.h"
+
+#define GVAR_TAG "gvar"
+
+#define GVAR_LONG_OFFSETS 0x0001
+
+#define TUPLES_SHARE_POINT_NUMBERS 0x8000
+#define TUPLE_COUNT_MASK 0x0FFF
+#define EMBEDDED_PEAK_TUPLE 0x8000
+#define INTERMEDIATE_REGION 0x4000
+#define PRIVATE_POINT_NUMBERS 0x2000
+#define TUPLE_INDEX_MASK 0x0FFF
+
+#define GVAR_PHANTOM_POINTS 4
+
+#pragma pack(1)
+
+typedef struct gvar_header {
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+    uint16_t axisCount;
+    uint16_t sharedTupleCount;
+    uint32_t sharedTuplesOffset;
+    uint16_t glyphCount;
+    uint16_t flags;
+    uint32_t glyphVariationDataArrayOffset;
+} gvar_header;
+
+#pragma pack()
+
+typedef struct gvar_table {
+    uint8_t *table;
+    uint16_t axis_count;
+    uint16_t shared_tuple_count;
+    uint16_t glyph_count;
+    int16_t *shared_tuples;
+    uint8_t *variation_data;
+    void *offsets;
+    bool long_offsets;
+} gvar_table;
+
+int load_gvar(ttf_source *source, gvar_table *gvar);
+float tuple_scalar(const int16_t *coords, uint16_t axis_count, const int16_t *peak, const int16_t *start, const int16_t *end);
+void compute_shared_scalars(const gvar_table *gvar, const int16_t *coords, float *scalars);
+int apply_glyph_variations(const gvar_table *gvar, uint16_t glyph_index, const int16_t *coords,
+                           const float *shared_scalars, const glyph_t *base, float *acc_x, float *acc_y);
+void accumulate_deltas(float *acc, const float *delta, float scalar, size_t count);
+
+#endif
@@ -1,14 +1,24 @@
 #include "head.h"
 
-head_table* try_load_head_table(ttf_source *source) {
-    
+ttf_status load_head_table(ttf_source *source, head_table **head, ttf_error *error) {
+
     ttf_table_record head_record = {0};
-    try_load_table_record(source, &head_record, HEAD_TAG);
+    ttf_status status = load_table_record(source, &head_record, HEAD_TAG, error);
+    if (status) {
+        return status;
+    }
 
-    return (head_table *)((uint8_t*)source->data + htonl(head_record.offset));
+    *head = (head_table *)((uint8_t*)source->data + htonl(head_record.offset));
+    return TTF_OK;
 }
 
 bool is_short_format(head_table *head) {
     int16_t indexToLocFormat = (int16_t)ntohs(head->indexToLocFormat);
     return indexToLocFormat == 0;
 }
+
+// a zero unitsPerEm would make every scale divide by zero, fall back to the common 1000
+uint16_t get_units_per_em(head_table *head) {
+    uint16_t unitsPerEm = ntohs(head->unitsPerEm);
+    return unitsPerEm ? unitsPerEm : 1000;
+}
@@ -36,6 +36,7 @@ typedef struct head_table {
 
 #pragma pack()
 
-head_table* try_load_head_table(ttf_source *source);
+ttf_status load_head_table(ttf_source *source, head_table **head, ttf_error *error);
 bool is_short_format(head_table *head);
+uint16_t get_units_per_em(head_table *head);
 #endif
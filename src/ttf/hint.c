@@ -0,0 +1,1711 @@
+#include <math.h>
+
+#include "hint.h"
+
+#define PACK(pops, pushes) (((pops) << 4) | (pushes))
+
+// stack arity of every opcode, instructions that pop a loop count or inline data
+// handle the variable part themselves
+static const uint8_t opcode_arity[256] = {
+    /* 0x00 SVTCA..SFVTL, SPVFS, SFVFS, GPV, GFV, SFVTPV, ISECT */
+    PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(2, 0), PACK(2, 0),
+    PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(0, 2), PACK(0, 2), PACK(0, 0), PACK(5, 0),
+    /* 0x10 SRP0..2, SZP0..2, SZPS, SLOOP, RTG, RTHG, SMD, ELSE, JMPR, SCVTCI, SSWCI, SSW */
+    PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+    PACK(0, 0), PACK(0, 0), PACK(1, 0), PACK(0, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+    /* 0x20 DUP, POP, CLEAR, SWAP, DEPTH, CINDEX, MINDEX, ALIGNPTS, -, UTP, LOOPCALL, CALL, FDEF, ENDF, MDAP */
+    PACK(1, 2), PACK(1, 0), PACK(0, 0), PACK(2, 2), PACK(0, 1), PACK(1, 1), PACK(1, 0), PACK(2, 0),
+    PACK(0, 0), PACK(1, 0), PACK(2, 0), PACK(1, 0), PACK(1, 0), PACK(0, 0), PACK(1, 0), PACK(1, 0),
+    /* 0x30 IUP, SHP, SHC, SHZ, SHPIX, IP, MSIRP, ALIGNRP, RTDG, MIAP */
+    PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+    PACK(1, 0), PACK(0, 0), PACK(2, 0), PACK(2, 0), PACK(0, 0), PACK(0, 0), PACK(2, 0), PACK(2, 0),
+    /* 0x40 NPUSHB, NPUSHW, WS, RS, WCVTP, RCVT, GC, SCFS, MD, MPPEM, MPS, FLIPON, FLIPOFF, DEBUG */
+    PACK(0, 0), PACK(0, 0), PACK(2, 0), PACK(1, 1), PACK(2, 0), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+    PACK(2, 0), PACK(2, 1), PACK(2, 1), PACK(0, 1), PACK(0, 1), PACK(0, 0), PACK(0, 0), PACK(1, 0),
+    /* 0x50 LT..NEQ, ODD, EVEN, IF, EIF, AND, OR, NOT, DELTAP1, SDB, SDS */
+    PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(1, 1), PACK(1, 1),
+    PACK(1, 0), PACK(0, 0), PACK(2, 1), PACK(2, 1), PACK(1, 1), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+    /* 0x60 ADD, SUB, DIV, MUL, ABS, NEG, FLOOR, CEILING, ROUND, NROUND */
+    PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+    PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+    /* 0x70 WCVTF, DELTAP2, DELTAP3, DELTAC1..3, SROUND, S45ROUND, JROT, JROF, ROFF, -, RUTG, RDTG, SANGW, AA */
+    PACK(2, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+    PACK(2, 0), PACK(2, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(1, 0), PACK(1, 0),
+    /* 0x80 FLIPPT, FLIPRGON, FLIPRGOFF, -, -, SCANCTRL, SDPVTL, GETINFO, IDEF, ROLL, MAX, MIN, SCANTYPE, INSTCTRL */
+    PACK(0, 0), PACK(2, 0), PACK(2, 0), PACK(0, 0), PACK(0, 0), PACK(1, 0), PACK(2, 0), PACK(2, 0),
+    PACK(1, 1), PACK(1, 0), PACK(3, 3), PACK(2, 1), PACK(2, 1), PACK(1, 0), PACK(2, 0), PACK(0, 0),
+};
+
+static const hint_graphics_state default_state = {
+    .projection = { 0x4000, 0 },
+    .freedom = { 0x4000, 0 },
+    .dual = { 0x4000, 0 },
+    .zp0 = 1,
+    .zp1 = 1,
+    .zp2 = 1,
+    .loop = 1,
+    .minimum_distance = 64,
+    .control_value_cutin = 68,
+    .delta_base = 9,
+    .delta_shift = 3,
+    .auto_flip = true,
+    .round_state = ROUND_TO_GRID,
+    .period = 64,
+    .threshold = 32
+};
+
+// marks glyphs without an outline so they are not looked up again
+static hinted_glyph no_outline;
+
+typedef struct hint_exec {
+    ttf_hinter *hinter;
+    hint_graphics_state gs;
+    hint_zone zones[2];
+    hint_zone *zp0;
+    hint_zone *zp1;
+    hint_zone *zp2;
+    int32_t *stack;
+    uint32_t top;
+    uint32_t stack_size;
+    int32_t *storage;
+    int32_t *cvt;
+    hint_function *functions;
+    hint_function *idefs;
+    int32_t scale;
+    uint16_t ppem;
+    int32_t f_dot_p;
+    uint32_t instructions;
+    uint32_t depth;
+    bool in_fpgm;
+    bool in_glyph;
+    ttf_error *error;
+} hint_exec;
+
+// FreeType's FT_MulDiv: rounded, with the sign applied to the magnitude
+static int32_t mul_div(int64_t a, int64_t b, int64_t c) {
+    int sign = 1;
+    if (a < 0) { a = -a; sign = -sign; }
+    if (b < 0) { b = -b; sign = -sign; }
+    if (c < 0) { c = -c; sign = -sign; }
+    int64_t d = c > 0 ? (a * b + (c >> 1)) / c : 0x7FFFFFFF;
+    return (int32_t)(sign * d);
+}
+
+static int32_t mul_div_no_round(int64_t a, int64_t b, int64_t c) {
+    int sign = 1;
+    if (a < 0) { a = -a; sign = -sign; }
+    if (b < 0) { b = -b; sign = -sign; }
+    if (c < 0) { c = -c; sign = -sign; }
+    int64_t d = c > 0 ? a * b / c : 0x7FFFFFFF;
+    return (int32_t)(sign * d);
+}
+
+// stack values come straight from bytecode, so sums and negations wrap
+// instead of overflowing, like FreeType's ADD_LONG and SUB_LONG
+static int32_t add_long(int32_t a, int32_t b) {
+    return (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+static int32_t sub_long(int32_t a, int32_t b) {
+    return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+static int32_t neg_long(int32_t a) {
+    return (int32_t)(0u - (uint32_t)a);
+}
+
+static int32_t abs_long(int32_t a) {
+    return a < 0 ? neg_long(a) : a;
+}
+
+static int32_t mul_fix(int32_t a, int32_t b) {
+    return mul_div(a, b, 0x10000);
+}
+
+static int32_t dot_fix14(int32_t ax, int32_t ay, int32_t bx, int32_t by) {
+    int64_t p = (int64_t)ax * bx + (int64_t)ay * by;
+    return (int32_t)((p + 0x2000 - (p < 0)) >> 14);
+}
+
+static int32_t mul_fix14(int32_t a, int32_t b) {
+    return dot_fix14(a, 0, b, 0);
+}
+
+static hint_vector normalize(int32_t x, int32_t y) {
+    double length = sqrt((double)x * x + (double)y * y);
+    if (length == 0.0) {
+        return (hint_vector){ 0x4000, 0 };
+    }
+    return (hint_vector){ (int32_t)lround(x * 16384.0 / length), (int32_t)lround(y * 16384.0 / length) };
+}
+
+static int32_t project(const hint_exec *exec, hint_vector a, hint_vector b) {
+    return dot_fix14(a.x - b.x, a.y - b.y, exec->gs.projection.x, exec->gs.projection.y);
+}
+
+static int32_t dual_project(const hint_exec *exec, hint_vector a, hint_vector b) {
+    return dot_fix14(a.x - b.x, a.y - b.y, exec->gs.dual.x, exec->gs.dual.y);
+}
+
+static void update_vectors(hint_exec *exec) {
+    int64_t dot = ((int64_t)exec->gs.projection.x * exec->gs.freedom.x + (int64_t)exec->gs.projection.y * exec->gs.freedom.y) >> 14;
+    exec->f_dot_p = dot > -0x400 && dot < 0x400 ? 0x4000 : (int32_t)dot;
+}
+
+static void update_zones(hint_exec *exec) {
+    exec->zp0 = &exec->zones[exec->gs.zp0];
+    exec->zp1 = &exec->zones[exec->gs.zp1];
+    exec->zp2 = &exec->zones[exec->gs.zp2];
+}
+
+static bool bad_point(const hint_zone *zone, int32_t point) {
+    return point < 0 || point >= zone->point_count;
+}
+
+// moves a point along the freedom vector so its projection changes by distance
+static void move_point(hint_exec *exec, hint_zone *zone, uint16_t point, int32_t distance) {
+    if (exec->gs.freedom.x) {
+        zone->cur[point].x += mul_div(distance, exec->gs.freedom.x, exec->f_dot_p);
+        zone->tags[point] |= HINT_TOUCHED_X;
+    }
+    if (exec->gs.freedom.y) {
+        zone->cur[point].y += mul_div(distance, exec->gs.freedom.y, exec->f_dot_p);
+        zone->tags[point] |= HINT_TOUCHED_Y;
+    }
+}
+
+static void move_original(hint_exec *exec, hint_zone *zone, uint16_t point, int32_t distance) {
+    if (exec->gs.freedom.x) {
+        zone->org[point].x += mul_div(distance, exec->gs.freedom.x, exec->f_dot_p);
+    }
+    if (exec->gs.freedom.y) {
+        zone->org[point].y += mul_div(distance, exec->gs.freedom.y, exec->f_dot_p);
+    }
+}
+
+static void shift_point(hint_exec *exec, uint16_t point, int32_t dx, int32_t dy, bool touch) {
+    hint_zone *zone = exec->zp2;
+    if (exec->gs.freedom.x) {
+        zone->cur[point].x += dx;
+        zone->tags[point] |= touch ? HINT_TOUCHED_X : 0;
+    }
+    if (exec->gs.freedom.y) {
+        zone->cur[point].y += dy;
+        zone->tags[point] |= touch ? HINT_TOUCHED_Y : 0;
+    }
+}
+
+static int32_t round_value(const hint_exec *exec, int32_t d) {
+    const hint_graphics_state *gs = &exec->gs;
+    int32_t v;
+    switch (gs->round_state) {
+    case ROUND_TO_HALF_GRID:
+        if (d >= 0) {
+            v = add_long(d & -64, 32);
+            return v < 0 ? 32 : v;
+        }
+        v = neg_long(add_long(neg_long(d) & -64, 32));
+        return v > 0 ? -32 : v;
+    case ROUND_TO_GRID:
+        if (d >= 0) {
+            v = add_long(d, 32) & -64;
+            return v < 0 ? 0 : v;
+        }
+        v = neg_long(add_long(neg_long(d), 32) & -64);
+        return v > 0 ? 0 : v;
+    case ROUND_TO_DOUBLE_GRID:
+        if (d >= 0) {
+            v = add_long(d, 16) & -32;
+            return v < 0 ? 0 : v;
+        }
+        v = neg_long(add_long(neg_long(d), 16) & -32);
+        return v > 0 ? 0 : v;
+    case ROUND_DOWN_TO_GRID:
+        return d >= 0 ? d & -64 : neg_long(neg_long(d) & -64);
+    case ROUND_UP_TO_GRID:
+        if (d >= 0) {
+            v = add_long(d, 63) & -64;
+            return v < 0 ? 0 : v;
+        }
+        v = neg_long(add_long(neg_long(d), 63) & -64);
+        return v > 0 ? 0 : v;
+    case ROUND_SUPER:
+        if (d >= 0) {
+            v = add_long(add_long(d, gs->threshold - gs->phase) & -gs->period, gs->phase);
+            return v < 0 ? gs->phase : v;
+        }
+        v = sub_long(neg_long(sub_long(gs->threshold - gs->phase, d) & -gs->period), gs->phase);
+        return v > 0 ? -gs->phase : v;
+    case ROUND_SUPER_45:
+        if (d >= 0) {
+            v = add_long(add_long(d, gs->threshold - gs->phase) / gs->period * gs->period, gs->phase);
+            return v < 0 ? gs->phase : v;
+        }
+        v = sub_long(neg_long(sub_long(gs->threshold - gs->phase, d) / gs->period * gs->period), gs->phase);
+        return v > 0 ? -gs->phase : v;
+    default:
+        return d;
+    }
+}
+
+// grid_period is in F26.6 with 8 extra bits, sqrt(2)/2 pixel for S45ROUND
+static void set_super_round(hint_exec *exec, int32_t grid_period, int32_t selector) {
+    hint_graphics_state *gs = &exec->gs;
+    switch (selector & 0xC0) {
+    case 0x00:
+        gs->period = grid_period / 2;
+        break;
+    case 0x80:
+        gs->period = grid_period * 2;
+        break;
+    default:
+        gs->period = grid_period;
+        break;
+    }
+    switch (selector & 0x30) {
+    case 0x00:
+        gs->phase = 0;
+        break;
+    case 0x10:
+        gs->phase = gs->period / 4;
+        break;
+    case 0x20:
+        gs->phase = gs->period / 2;
+        break;
+    default:
+        gs->phase = gs->period * 3 / 4;
+        break;
+    }
+    gs->threshold = (selector & 0x0F) == 0 ? gs->period - 1 : ((selector & 0x0F) - 4) * gs->period / 8;
+    gs->period >>= 8;
+    gs->phase >>= 8;
+    gs->threshold >>= 8;
+    if (gs->period == 0) {
+        gs->period = 1;
+    }
+}
+
+static uint32_t instruction_size(const uint8_t *code, uint32_t ip, uint32_t length) {
+    uint8_t op = code[ip];
+    uint32_t size = 1;
+    if (op == 0x40 || op == 0x41) {
+        if (ip + 1 >= length) {
+            return 0;
+        }
+        size = 2 + code[ip + 1] * (op == 0x41 ? 2 : 1);
+    } else if (op >= 0xB0 && op <= 0xB7) {
+        size = 1 + (op - 0xAF);
+    } else if (op >= 0xB8 && op <= 0xBF) {
+        size = 1 + 2 * (op - 0xB7);
+    }
+    return ip + size <= length ? size : 0;
+}
+
+// skips to just past the ELSE or EIF closing the current block, ELSE only counts
+// when stop_at_else and at the outermost level
+static bool skip_block(const uint8_t *code, uint32_t length, uint32_t *ip, bool stop_at_else) {
+    uint32_t level = 1;
+    while (*ip < length) {
+        uint8_t op = code[*ip];
+        uint32_t size = instruction_size(code, *ip, length);
+        if (size == 0) {
+            return false;
+        }
+        *ip += size;
+        if (op == 0x58) {
+            level++;
+        } else if (op == 0x1B && stop_at_else && level == 1) {
+            return true;
+        } else if (op == 0x59 && --level == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static ttf_status fail(hint_exec *exec, uint8_t op, const char *reason) {
+    return ttf_fail(exec->error, TTF_ERR_MALFORMED, "hinting : %s at opcode 0x%02X", reason, op);
+}
+
+static int32_t read_cvt(const hint_exec *exec, int32_t index) {
+    return index >= 0 && (uint32_t)index < exec->hinter->cvt_count ? exec->cvt[index] : 0;
+}
+
+static int32_t pop_value(hint_exec *exec, bool *ok) {
+    if (exec->top == 0) {
+        *ok = false;
+        return 0;
+    }
+    return exec->stack[--exec->top];
+}
+
+static ttf_status run_code(hint_exec *exec, const uint8_t *code, uint32_t length);
+
+static ttf_status call_function(hint_exec *exec, const hint_function *function, uint8_t op) {
+    if (!function->defined) {
+        return fail(exec, op, "call to an undefined function");
+    }
+    // each call is charged, so LOOPCALL over an empty function still runs out of budget
+    if (++exec->instructions > HINT_MAX_INSTRUCTIONS) {
+        return fail(exec, op, "instruction budget exhausted");
+    }
+    if (++exec->depth > HINT_MAX_CALL_DEPTH) {
+        return fail(exec, op, "call stack overflow");
+    }
+    ttf_status status = run_code(exec, function->code, function->length);
+    exec->depth--;
+    return status;
+}
+
+static ttf_status define_function(hint_exec *exec, hint_function *function, const uint8_t *code,
+                                  uint32_t length, uint32_t *ip, uint8_t op) {
+    uint32_t start = *ip;
+    while (*ip < length) {
+        uint8_t inner = code[*ip];
+        uint32_t size = instruction_size(code, *ip, length);
+        if (size == 0 || inner == 0x2C || inner == 0x89) {
+            return fail(exec, op, "unterminated function definition");
+        }
+        if (inner == 0x2D) {
+            function->code = code + start;
+            function->length = *ip - start;
+            function->defined = true;
+            *ip += 1;
+            return TTF_OK;
+        }
+        *ip += size;
+    }
+    return fail(exec, op, "unterminated function definition");
+}
+
+static void shift_displacement(hint_exec *exec, uint8_t op, int32_t *dx, int32_t *dy, hint_zone **zone, uint16_t *reference, bool *ok) {
+    if (op & 1) {
+        *zone = exec->zp0;
+        *reference = exec->gs.rp1;
+    } else {
+        *zone = exec->zp1;
+        *reference = exec->gs.rp2;
+    }
+    if (bad_point(*zone, *reference)) {
+        *ok = false;
+        return;
+    }
+    int32_t d = project(exec, (*zone)->cur[*reference], (*zone)->org[*reference]);
+    *dx = mul_div(d, exec->gs.freedom.x, exec->f_dot_p);
+    *dy = mul_div(d, exec->gs.freedom.y, exec->f_dot_p);
+    *ok = true;
+}
+
+typedef struct iup_axis {
+    hint_zone *zone;
+    bool x;
+} iup_axis;
+
+static int32_t iup_coord(const hint_vector *v, bool x) {
+    return x ? v->x : v->y;
+}
+
+static void iup_set(hint_vector *v, bool x, int32_t value) {
+    if (x) {
+        v->x = value;
+    } else {
+        v->y = value;
+    }
+}
+
+static void iup_shift(iup_axis *w, uint16_t p1, uint16_t p2, uint16_t p) {
+    int32_t delta = iup_coord(&w->zone->cur[p], w->x) - iup_coord(&w->zone->org[p], w->x);
+    if (delta == 0) {
+        return;
+    }
+    for (uint16_t i = p1; i <= p2; i++) {
+        if (i != p) {
+            iup_set(&w->zone->cur[i], w->x, iup_coord(&w->zone->cur[i], w->x) + delta);
+        }
+    }
+}
+
+// untouched points between two touched ones keep their relative position in font
+// units, points outside the pair's range move with the nearer one
+static void iup_interpolate(iup_axis *w, int32_t p1, int32_t p2, uint16_t ref1, uint16_t ref2) {
+    if (p1 > p2) {
+        return;
+    }
+    hint_zone *zone = w->zone;
+    int32_t orus1 = iup_coord(&zone->orus[ref1], w->x);
+    int32_t orus2 = iup_coord(&zone->orus[ref2], w->x);
+    if (orus1 > orus2) {
+        int32_t t = orus1; orus1 = orus2; orus2 = t;
+        uint16_t r = ref1; ref1 = ref2; ref2 = r;
+    }
+
+    int32_t org1 = iup_coord(&zone->org[ref1], w->x), org2 = iup_coord(&zone->org[ref2], w->x);
+    int32_t cur1 = iup_coord(&zone->cur[ref1], w->x), cur2 = iup_coord(&zone->cur[ref2], w->x);
+    int32_t delta1 = cur1 - org1, delta2 = cur2 - org2;
+    bool flat = cur1 == cur2 || orus1 == orus2;
+    int32_t scale = flat ? 0 : mul_div(cur2 - cur1, 0x10000, orus2 - orus1);
+
+    for (int32_t i = p1; i <= p2; i++) {
+        int32_t x = iup_coord(&zone->org[i], w->x);
+        if (x <= org1) {
+            x += delta1;
+        } else if (x >= org2) {
+            x += delta2;
+        } else {
+            x = flat ? cur1 : cur1 + mul_fix(iup_coord(&zone->orus[i], w->x) - orus1, scale);
+        }
+        iup_set(&zone->cur[i], w->x, x);
+    }
+}
+
+static void interpolate_untouched(hint_exec *exec, bool x) {
+    hint_zone *zone = &exec->zones[1];
+    uint8_t mask = x ? HINT_TOUCHED_X : HINT_TOUCHED_Y;
+    iup_axis w = { zone, x };
+
+    uint16_t point = 0;
+    for (uint16_t contour = 0; contour < zone->contour_count; contour++) {
+        uint16_t end = zone->contours[contour];
+        uint16_t first = point;
+        if (end >= zone->point_count) {
+            end = zone->point_count - 1;
+        }
+        while (point <= end && !(zone->tags[point] & mask)) {
+            point++;
+        }
+        if (point <= end) {
+            uint16_t first_touched = point, current = point;
+            for (point++; point <= end; point++) {
+                if (zone->tags[point] & mask) {
+                    iup_interpolate(&w, current + 1, point - 1, current, point);
+                    current = point;
+                }
+            }
+            if (current == first_touched) {
+                iup_shift(&w, first, end, current);
+            } else {
+                iup_interpolate(&w, current + 1, end, current, first_touched);
+                if (first_touched > 0) {
+                    iup_interpolate(&w, first, first_touched - 1, current, first_touched);
+                }
+            }
+        }
+        point = end + 1;
+    }
+}
+
+// DELTAP and DELTAC share the ppem test and step decoding
+static bool delta_step(const hint_exec *exec, uint8_t op, int32_t arg, int32_t *step) {
+    int32_t ppem = ((arg & 0xF0) >> 4) + exec->gs.delta_base;
+    if (op == 0x71 || op == 0x74) {
+        ppem += 16;
+    } else if (op == 0x72 || op == 0x75) {
+        ppem += 32;
+    }
+    if (ppem != exec->ppem) {
+        return false;
+    }
+    int32_t s = (arg & 0xF) - 8;
+    if (s >= 0) {
+        s++;
+    }
+    *step = s * (1 << (6 - exec->gs.delta_shift));
+    return true;
+}
+
+static ttf_status run_code(hint_exec *exec, const uint8_t *code, uint32_t length) {
+    uint32_t ip = 0;
+    hint_graphics_state *gs = &exec->gs;
+
+    while (ip < length) {
+        uint8_t op = code[ip];
+        if (++exec->instructions > HINT_MAX_INSTRUCTIONS) {
+            return fail(exec, op, "instruction budget exhausted");
+        }
+        uint32_t size = instruction_size(code, ip, length);
+        if (size == 0) {
+            return fail(exec, op, "truncated instruction");
+        }
+
+        uint32_t pops = 0, pushes = 0;
+        if (op < 0x90) {
+            pops = opcode_arity[op] >> 4;
+            pushes = opcode_arity[op] & 0x0F;
+        } else if (op >= 0xC0) {
+            pops = op >= 0xE0 ? 2 : 1;
+        }
+        if (exec->top < pops) {
+            return fail(exec, op, "stack underflow");
+        }
+        if (exec->top - pops + pushes > exec->stack_size) {
+            return fail(exec, op, "stack overflow");
+        }
+        exec->top -= pops;
+        int32_t *args = exec->stack + exec->top;
+        uint32_t next = ip + size;
+        bool ok = true;
+
+        switch (op) {
+        case 0x00: case 0x01: case 0x02: case 0x03: case 0x04: case 0x05: {
+            // SVTCA, SPVTCA, SFVTCA; the low bit picks the x axis
+            hint_vector axis = (op & 1) ? (hint_vector){ 0x4000, 0 } : (hint_vector){ 0, 0x4000 };
+            if (op < 0x04) {
+                gs->projection = axis;
+                gs->dual = axis;
+            }
+            if (op < 0x02 || op >= 0x04) {
+                gs->freedom = axis;
+            }
+            update_vectors(exec);
+            break;
+        }
+        case 0x06: case 0x07: case 0x08: case 0x09: {
+            // SPVTL, SFVTL: line from point args[1] in zp2 to point args[0] in zp1
+            if (bad_point(exec->zp1, args[0]) || bad_point(exec->zp2, args[1])) {
+                break;
+            }
+            hint_vector p1 = exec->zp1->cur[args[0]], p2 = exec->zp2->cur[args[1]];
+            int32_t a = p1.x - p2.x, b = p1.y - p2.y;
+            bool rotate = op & 1;
+            if (a == 0 && b == 0) {
+                a = 0x4000;
+                rotate = false;
+            }
+            if (rotate) {
+                int32_t c = b; b = a; a = -c;
+            }
+            hint_vector v = normalize(a, b);
+            if (op < 0x08) {
+                gs->projection = v;
+                gs->dual = v;
+            } else {
+                gs->freedom = v;
+            }
+            update_vectors(exec);
+            break;
+        }
+        case 0x0A: // SPVFS
+            gs->projection = normalize((int16_t)args[0], (int16_t)args[1]);
+            gs->dual = gs->projection;
+            update_vectors(exec);
+            break;
+        case 0x0B: // SFVFS
+            gs->freedom = normalize((int16_t)args[0], (int16_t)args[1]);
+            update_vectors(exec);
+            break;
+        case 0x0C: // GPV
+            args[0] = gs->projection.x;
+            args[1] = gs->projection.y;
+            break;
+        case 0x0D: // GFV
+            args[0] = gs->freedom.x;
+            args[1] = gs->freedom.y;
+            break;
+        case 0x0E: // SFVTPV
+            gs->freedom = gs->projection;
+            update_vectors(exec);
+            break;
+        case 0x0F: { // ISECT
+            int32_t point = args[0], a0 = args[1], a1 = args[2], b0 = args[3], b1 = args[4];
+            if (bad_point(exec->zp2, point) || bad_point(exec->zp1, a0) || bad_point(exec->zp1, a1)
+                || bad_point(exec->zp0, b0) || bad_point(exec->zp0, b1)) {
+                break;
+            }
+            hint_vector pa0 = exec->zp1->cur[a0], pa1 = exec->zp1->cur[a1];
+            hint_vector pb0 = exec->zp0->cur[b0], pb1 = exec->zp0->cur[b1];
+            int32_t dbx = sub_long(pb1.x, pb0.x), dby = sub_long(pb1.y, pb0.y);
+            int32_t dax = sub_long(pa1.x, pa0.x), day = sub_long(pa1.y, pa0.y);
+            int32_t dx = sub_long(pb0.x, pa0.x), dy = sub_long(pb0.y, pa0.y);
+            int32_t discriminant = add_long(mul_div(dax, -(int64_t)dby, 0x40), mul_div(day, dbx, 0x40));
+            int32_t dot = add_long(mul_div(dax, dbx, 0x40), mul_div(day, dby, 0x40));
+            hint_vector *target = &exec->zp2->cur[point];
+            // nearly parallel lines meet at the middle of the four points
+            if (19 * (int64_t)abs_long(discriminant) > abs_long(dot)) {
+                int32_t v = add_long(mul_div(dx, -(int64_t)dby, 0x40), mul_div(dy, dbx, 0x40));
+                target->x = add_long(pa0.x, mul_div(v, dax, discriminant));
+                target->y = add_long(pa0.y, mul_div(v, day, discriminant));
+            } else {
+                target->x = (int32_t)(((int64_t)pa0.x + pa1.x + pb0.x + pb1.x) / 4);
+                target->y = (int32_t)(((int64_t)pa0.y + pa1.y + pb0.y + pb1.y) / 4);
+            }
+            exec->zp2->tags[point] |= HINT_TOUCHED_X | HINT_TOUCHED_Y;
+            break;
+        }
+        case 0x10:
+            gs->rp0 = (uint16_t)args[0];
+            break;
+        case 0x11:
+            gs->rp1 = (uint16_t)args[0];
+            break;
+        case 0x12:
+            gs->rp2 = (uint16_t)args[0];
+            break;
+        case 0x13: case 0x14: case 0x15: case 0x16:
+            if (args[0] != 0 && args[0] != 1) {
+                return fail(exec, op, "invalid zone");
+            }
+            if (op == 0x13 || op == 0x16) {
+                gs->zp0 = (uint8_t)args[0];
+            }
+            if (op == 0x14 || op == 0x16) {
+                gs->zp1 = (uint8_t)args[0];
+            }
+            if (op == 0x15 || op == 0x16) {
+                gs->zp2 = (uint8_t)args[0];
+            }
+            update_zones(exec);
+            break;
+        case 0x17: // SLOOP
+            if (args[0] < 0) {
+                return fail(exec, op, "negative loop count");
+            }
+            gs->loop = args[0] > 0xFFFF ? 0xFFFF : args[0];
+            break;
+        case 0x18:
+            gs->round_state = ROUND_TO_GRID;
+            break;
+        case 0x19:
+            gs->round_state = ROUND_TO_HALF_GRID;
+            break;
+        case 0x1A:
+            gs->minimum_distance = args[0];
+            break;
+        case 0x1B: // ELSE reached from a taken IF
+            if (!skip_block(code, length, &next, false)) {
+                return fail(exec, op, "unterminated ELSE");
+            }
+            break;
+        case 0x1C: case 0x78: case 0x79: { // JMPR, JROT, JROF
+            int32_t offset = args[0];
+            bool jump = op == 0x1C || (op == 0x78 ? args[1] != 0 : args[1] == 0);
+            if (jump) {
+                int64_t target = (int64_t)ip + offset;
+                if (offset == 0 || target < 0 || target > length) {
+                    return fail(exec, op, "jump out of range");
+                }
+                next = (uint32_t)target;
+            }
+            break;
+        }
+        case 0x1D:
+            gs->control_value_cutin = args[0];
+            break;
+        case 0x1E:
+            gs->single_width_cutin = args[0];
+            break;
+        case 0x1F:
+            gs->single_width_value = mul_fix(args[0], exec->scale);
+            break;
+        case 0x20: // DUP
+            args[1] = args[0];
+            break;
+        case 0x21: // POP
+            break;
+        case 0x22: // CLEAR
+            exec->top = 0;
+            break;
+        case 0x23: { // SWAP
+            int32_t t = args[0]; args[0] = args[1]; args[1] = t;
+            break;
+        }
+        case 0x24: // DEPTH
+            args[0] = (int32_t)exec->top;
+            break;
+        case 0x25: // CINDEX
+            if (args[0] <= 0 || (uint32_t)args[0] > exec->top) {
+                return fail(exec, op, "index out of range");
+            }
+            args[0] = exec->stack[exec->top - args[0]];
+            break;
+        case 0x26: { // MINDEX
+            if (args[0] <= 0 || (uint32_t)args[0] > exec->top) {
+                return fail(exec, op, "index out of range");
+            }
+            uint32_t from = exec->top - args[0];
+            int32_t value = exec->stack[from];
+            memmove(exec->stack + from, exec->stack + from + 1, (args[0] - 1) * sizeof(int32_t));
+            exec->stack[exec->top - 1] = value;
+            break;
+        }
+        case 0x27: { // ALIGNPTS
+            int32_t p1 = args[0], p2 = args[1];
+            if (bad_point(exec->zp1, p1) || bad_point(exec->zp0, p2)) {
+                break;
+            }
+            int32_t distance = project(exec, exec->zp0->cur[p2], exec->zp1->cur[p1]) / 2;
+            move_point(exec, exec->zp1, (uint16_t)p1, distance);
+            move_point(exec, exec->zp0, (uint16_t)p2, -distance);
+            break;
+        }
+        case 0x29: // UTP
+            if (!bad_point(exec->zp0, args[0])) {
+                uint8_t mask = 0xFF;
+                if (gs->freedom.x) {
+                    mask &= ~HINT_TOUCHED_X;
+                }
+                if (gs->freedom.y) {
+                    mask &= ~HINT_TOUCHED_Y;
+                }
+                exec->zp0->tags[args[0]] &= mask;
+            }
+            break;
+        case 0x2A: case 0x2B: { // LOOPCALL, CALL
+            int32_t index = op == 0x2B ? args[0] : args[1];
+            int32_t count = op == 0x2B ? 1 : args[0];
+            if (index < 0 || (uint32_t)index >= exec->hinter->max_functions) {
+                return fail(exec, op, "function index out of range");
+            }
+            for (int32_t i = 0; i < count; i++) {
+                ttf_status status = call_function(exec, &exec->functions[index], op);
+                if (status) {
+                    return status;
+                }
+            }
+            break;
+        }
+        case 0x2C: case 0x89: { // FDEF, IDEF
+            if (exec->in_glyph) {
+                return fail(exec, op, "definition in a glyph program");
+            }
+            hint_function *function;
+            if (op == 0x2C) {
+                if (args[0] < 0 || (uint32_t)args[0] >= exec->hinter->max_functions) {
+                    return fail(exec, op, "function index out of range");
+                }
+                function = &exec->functions[args[0]];
+            } else {
+                function = &exec->idefs[args[0] & 0xFF];
+            }
+            ttf_status status = define_function(exec, function, code, length, &next, op);
+            if (status) {
+                return status;
+            }
+            break;
+        }
+        case 0x2D: // ENDF outside a definition ends the program
+            return TTF_OK;
+        case 0x2E: case 0x2F: { // MDAP
+            int32_t point = args[0];
+            if (bad_point(exec->zp0, point)) {
+                break;
+            }
+            int32_t distance = 0;
+            if (op & 1) {
+                int32_t current = project(exec, exec->zp0->cur[point], (hint_vector){ 0, 0 });
+                distance = round_value(exec, current) - current;
+            }
+            move_point(exec, exec->zp0, (uint16_t)point, distance);
+            gs->rp0 = gs->rp1 = (uint16_t)point;
+            break;
+        }
+        case 0x30: case 0x31: // IUP
+            if (exec->in_glyph) {
+                interpolate_untouched(exec, op & 1);
+            }
+            break;
+        case 0x32: case 0x33: { // SHP
+            int32_t dx, dy;
+            hint_zone *zone;
+            uint16_t reference;
+            shift_displacement(exec, op, &dx, &dy, &zone, &reference, &ok);
+            for (; gs->loop > 0; gs->loop--) {
+                int32_t point = pop_value(exec, &ok);
+                if (!ok) {
+                    return fail(exec, op, "stack underflow");
+                }
+                if (!bad_point(exec->zp2, point) && !bad_point(zone, reference)) {
+                    shift_point(exec, (uint16_t)point, dx, dy, true);
+                }
+            }
+            gs->loop = 1;
+            ok = true;
+            break;
+        }
+        case 0x34: case 0x35: { // SHC
+            int32_t dx, dy;
+            hint_zone *zone;
+            uint16_t reference;
+            int32_t contour = args[0];
+            // the twilight zone counts as one contour holding all its points
+            bool twilight = gs->zp2 == 0;
+            if (contour < 0 || contour >= (twilight ? 1 : exec->zp2->contour_count)) {
+                break;
+            }
+            shift_displacement(exec, op, &dx, &dy, &zone, &reference, &ok);
+            if (!ok) {
+                ok = true;
+                break;
+            }
+            uint16_t start = twilight || contour == 0 ? 0 : exec->zp2->contours[contour - 1] + 1;
+            uint16_t limit = twilight ? exec->zp2->point_count : exec->zp2->contours[contour] + 1;
+            for (uint16_t i = start; i < limit && i < exec->zp2->point_count; i++) {
+                if (zone != exec->zp2 || i != reference) {
+                    shift_point(exec, i, dx, dy, true);
+                }
+            }
+            break;
+        }
+        case 0x36: case 0x37: { // SHZ, phantom points never move
+            int32_t dx, dy;
+            hint_zone *zone;
+            uint16_t reference;
+            if (args[0] != 0 && args[0] != 1) {
+                break;
+            }
+            shift_displacement(exec, op, &dx, &dy, &zone, &reference, &ok);
+            if (!ok) {
+                ok = true;
+                break;
+            }
+            uint16_t limit = exec->zp2 == &exec->zones[0] ? exec->zp2->point_count
+                : (exec->zp2->contour_count ? exec->zp2->contours[exec->zp2->contour_count - 1] + 1 : 0);
+            for (uint16_t i = 0; i < limit && i < exec->zp2->point_count; i++) {
+                if (zone != exec->zp2 || i != reference) {
+                    shift_point(exec, i, dx, dy, false);
+                }
+            }
+            break;
+        }
+        case 0x38: { // SHPIX
+            int32_t dx = mul_fix14(args[0], gs->freedom.x), dy = mul_fix14(args[0], gs->freedom.y);
+            for (; gs->loop > 0; gs->loop--) {
+                int32_t point = pop_value(exec, &ok);
+                if (!ok) {
+                    return fail(exec, op, "stack underflow");
+                }
+                if (!bad_point(exec->zp2, point)) {
+                    shift_point(exec, (uint16_t)point, dx, dy, true);
+                }
+            }
+            gs->loop = 1;
+            break;
+        }
+        case 0x39: { // IP, original distances only matter as ratios so orus stay unscaled
+            bool twilight = gs->zp0 == 0 || gs->zp1 == 0 || gs->zp2 == 0;
+            bool refs_ok = !bad_point(exec->zp0, gs->rp1);
+            hint_vector base = {0}, cur_base = {0};
+            int32_t old_range = 0, cur_range = 0;
+            if (refs_ok) {
+                base = twilight ? exec->zp0->org[gs->rp1] : exec->zp0->orus[gs->rp1];
+                cur_base = exec->zp0->cur[gs->rp1];
+            }
+            if (refs_ok && !bad_point(exec->zp1, gs->rp2)) {
+                old_range = dual_project(exec, twilight ? exec->zp1->org[gs->rp2] : exec->zp1->orus[gs->rp2], base);
+                cur_range = project(exec, exec->zp1->cur[gs->rp2], cur_base);
+            }
+            for (; gs->loop > 0; gs->loop--) {
+                int32_t point = pop_value(exec, &ok);
+                if (!ok) {
+                    return fail(exec, op, "stack underflow");
+                }
+                if (!refs_ok || bad_point(exec->zp2, point)) {
+                    continue;
+                }
+                int32_t org_dist = dual_project(exec, twilight ? exec->zp2->org[point] : exec->zp2->orus[point], base);
+                int32_t cur_dist = project(exec, exec->zp2->cur[point], cur_base);
+                int32_t new_dist = 0;
+                if (org_dist) {
+                    new_dist = old_range ? mul_div(org_dist, cur_range, old_range) : cur_dist;
+                }
+                move_point(exec, exec->zp2, (uint16_t)point, new_dist - cur_dist);
+            }
+            gs->loop = 1;
+            break;
+        }
+        case 0x3A: case 0x3B: { // MSIRP
+            int32_t point = args[0];
+            if (bad_point(exec->zp1, point) || bad_point(exec->zp0, gs->rp0)) {
+                break;
+            }
+            if (gs->zp1 == 0) {
+                exec->zp1->org[point] = exec->zp0->org[gs->rp0];
+                move_original(exec, exec->zp1, (uint16_t)point, args[1]);
+                exec->zp1->cur[point] = exec->zp1->org[point];
+            }
+            int32_t distance = project(exec, exec->zp1->cur[point], exec->zp0->cur[gs->rp0]);
+            move_point(exec, exec->zp1, (uint16_t)point, sub_long(args[1], distance));
+            gs->rp1 = gs->rp0;
+            gs->rp2 = (uint16_t)point;
+            if (op & 1) {
+                gs->rp0 = (uint16_t)point;
+            }
+            break;
+        }
+        case 0x3C: { // ALIGNRP
+            for (; gs->loop > 0; gs->loop--) {
+                int32_t point = pop_value(exec, &ok);
+                if (!ok) {
+                    return fail(exec, op, "stack underflow");
+                }
+                if (bad_point(exec->zp1, point) || bad_point(exec->zp0, gs->rp0)) {
+                    continue;
+                }
+                int32_t distance = project(exec, exec->zp1->cur[point], exec->zp0->cur[gs->rp0]);
+                move_point(exec, exec->zp1, (uint16_t)point, -distance);
+            }
+            gs->loop = 1;
+            break;
+        }
+        case 0x3D:
+            gs->round_state = ROUND_TO_DOUBLE_GRID;
+            break;
+        case 0x3E: case 0x3F: { // MIAP
+            int32_t point = args[0];
+            if (bad_point(exec->zp0, point)) {
+                break;
+            }
+            int32_t distance = read_cvt(exec, args[1]);
+            if (gs->zp0 == 0) {
+                exec->zp0->org[point].x = mul_fix14(distance, gs->freedom.x);
+                exec->zp0->org[point].y = mul_fix14(distance, gs->freedom.y);
+                exec->zp0->cur[point] = exec->zp0->org[point];
+            }
+            int32_t org_dist = project(exec, exec->zp0->cur[point], (hint_vector){ 0, 0 });
+            if (op & 1) {
+                if (abs_long(sub_long(distance, org_dist)) > gs->control_value_cutin) {
+                    distance = org_dist;
+                }
+                distance = round_value(exec, distance);
+            }
+            move_point(exec, exec->zp0, (uint16_t)point, distance - org_dist);
+            gs->rp0 = gs->rp1 = (uint16_t)point;
+            break;
+        }
+        case 0x40: case 0x41: case 0xB0: case 0xB1: case 0xB2: case 0xB3: case 0xB4: case 0xB5:
+        case 0xB6: case 0xB7: case 0xB8: case 0xB9: case 0xBA: case 0xBB: case 0xBC: case 0xBD:
+        case 0xBE: case 0xBF: {
+            bool words = op == 0x41 || op >= 0xB8;
+            uint32_t count = op == 0x40 || op == 0x41 ? code[ip + 1] : (uint32_t)(op & 7) + 1;
+            const uint8_t *data = code + ip + (op < 0x42 ? 2 : 1);
+            if (exec->top + count > exec->stack_size) {
+                return fail(exec, op, "stack overflow");
+            }
+            for (uint32_t i = 0; i < count; i++) {
+                exec->stack[exec->top++] = words ? (int16_t)((data[2 * i] << 8) | data[2 * i + 1]) : data[i];
+            }
+            break;
+        }
+        case 0x42: // WS
+            if (args[0] >= 0 && (uint32_t)args[0] < exec->hinter->max_storage) {
+                exec->storage[args[0]] = args[1];
+            }
+            break;
+        case 0x43: // RS
+            args[0] = args[0] >= 0 && (uint32_t)args[0] < exec->hinter->max_storage ? exec->storage[args[0]] : 0;
+            break;
+        case 0x44: case 0x70: // WCVTP, WCVTF
+            if (args[0] >= 0 && (uint32_t)args[0] < exec->hinter->cvt_count) {
+                exec->cvt[args[0]] = op == 0x44 ? args[1] : mul_fix(args[1], exec->scale);
+            }
+            break;
+        case 0x45: // RCVT
+            args[0] = read_cvt(exec, args[0]);
+            break;
+        case 0x46: case 0x47: // GC
+            if (bad_point(exec->zp2, args[0])) {
+                args[0] = 0;
+            } else if (op & 1) {
+                args[0] = dual_project(exec, exec->zp2->org[args[0]], (hint_vector){ 0, 0 });
+            } else {
+                args[0] = project(exec, exec->zp2->cur[args[0]], (hint_vector){ 0, 0 });
+            }
+            break;
+        case 0x48: { // SCFS
+            int32_t point = args[0];
+            if (bad_point(exec->zp2, point)) {
+                break;
+            }
+            int32_t current = project(exec, exec->zp2->cur[point], (hint_vector){ 0, 0 });
+            move_point(exec, exec->zp2, (uint16_t)point, sub_long(args[1], current));
+            if (gs->zp2 == 0) {
+                exec->zp2->org[point] = exec->zp2->cur[point];
+            }
+            break;
+        }
+        case 0x49: case 0x4A: { // MD, the grid-fitted variant is 0x4A like FreeType
+            int32_t l = args[0], k = args[1];
+            if (bad_point(exec->zp0, l) || bad_point(exec->zp1, k)) {
+                args[0] = 0;
+            } else if (op & 1) {
+                args[0] = project(exec, exec->zp0->cur[l], exec->zp1->cur[k]);
+            } else if (gs->zp0 == 0 || gs->zp1 == 0) {
+                args[0] = dual_project(exec, exec->zp0->org[l], exec->zp1->org[k]);
+            } else {
+                args[0] = mul_fix(dual_project(exec, exec->zp0->orus[l], exec->zp1->orus[k]), exec->scale);
+            }
+            break;
+        }
+        case 0x4B: case 0x4C: // MPPEM, MPS
+            args[0] = exec->ppem;
+            break;
+        case 0x4D:
+            gs->auto_flip = true;
+            break;
+        case 0x4E:
+            gs->auto_flip = false;
+            break;
+        case 0x4F: // DEBUG
+            break;
+        case 0x50:
+            args[0] = args[0] < args[1];
+            break;
+        case 0x51:
+            args[0] = args[0] <= args[1];
+            break;
+        case 0x52:
+            args[0] = args[0] > args[1];
+            break;
+        case 0x53:
+            args[0] = args[0] >= args[1];
+            break;
+        case 0x54:
+            args[0] = args[0] == args[1];
+            break;
+        case 0x55:
+            args[0] = args[0] != args[1];
+            break;
+        case 0x56:
+            args[0] = (round_value(exec, args[0]) & 127) == 64;
+            break;
+        case 0x57:
+            args[0] = (round_value(exec, args[0]) & 127) == 0;
+            break;
+        case 0x58: // IF
+            if (!args[0] && !skip_block(code, length, &next, true)) {
+                return fail(exec, op, "unterminated IF");
+            }
+            break;
+        case 0x59: // EIF
+            break;
+        case 0x5A:
+            args[0] = args[0] && args[1];
+            break;
+        case 0x5B:
+            args[0] = args[0] || args[1];
+            break;
+        case 0x5C:
+            args[0] = !args[0];
+            break;
+        case 0x5D: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: { // DELTAP1-3, DELTAC1-3
+            bool cvt = op >= 0x73;
+            for (int32_t i = 0; i < args[0]; i++) {
+                if (exec->top < 2) {
+                    return fail(exec, op, "stack underflow");
+                }
+                int32_t target = exec->stack[--exec->top];
+                int32_t arg = exec->stack[--exec->top];
+                int32_t step;
+                if (!delta_step(exec, op, arg, &step)) {
+                    continue;
+                }
+                if (cvt) {
+                    if (target >= 0 && (uint32_t)target < exec->hinter->cvt_count) {
+                        exec->cvt[target] += step;
+                    }
+                } else if (!bad_point(exec->zp0, target)) {
+                    move_point(exec, exec->zp0, (uint16_t)target, step);
+                }
+            }
+            break;
+        }
+        case 0x5E:
+            gs->delta_base = (uint16_t)args[0];
+            break;
+        case 0x5F:
+            if (args[0] < 0 || args[0] > 6) {
+                return fail(exec, op, "delta shift out of range");
+            }
+            gs->delta_shift = (uint16_t)args[0];
+            break;
+        case 0x60:
+            args[0] = add_long(args[0], args[1]);
+            break;
+        case 0x61:
+            args[0] = sub_long(args[0], args[1]);
+            break;
+        case 0x62:
+            if (args[1] == 0) {
+                return fail(exec, op, "division by zero");
+            }
+            args[0] = mul_div_no_round(args[0], 64, args[1]);
+            break;
+        case 0x63:
+            args[0] = mul_div(args[0], args[1], 64);
+            break;
+        case 0x64:
+            args[0] = abs_long(args[0]);
+            break;
+        case 0x65:
+            args[0] = neg_long(args[0]);
+            break;
+        case 0x66:
+            args[0] &= -64;
+            break;
+        case 0x67:
+            args[0] = add_long(args[0], 63) & -64;
+            break;
+        case 0x68: case 0x69: case 0x6A: case 0x6B:
+            args[0] = round_value(exec, args[0]);
+            break;
+        case 0x6C: case 0x6D: case 0x6E: case 0x6F: // NROUND, no engine compensation
+            break;
+        case 0x76:
+            set_super_round(exec, 0x4000, args[0]);
+            gs->round_state = ROUND_SUPER;
+            break;
+        case 0x77:
+            set_super_round(exec, 0x2D41, args[0]);
+            gs->round_state = ROUND_SUPER_45;
+            break;
+        case 0x7A:
+            gs->round_state = ROUND_OFF;
+            break;
+        case 0x7C:
+            gs->round_state = ROUND_UP_TO_GRID;
+            break;
+        case 0x7D:
+            gs->round_state = ROUND_DOWN_TO_GRID;
+            break;
+        case 0x7E: case 0x7F: // SANGW, AA
+            break;
+        case 0x80: { // FLIPPT
+            hint_zone *zone = &exec->zones[1];
+            for (; gs->loop > 0; gs->loop--) {
+                int32_t point = pop_value(exec, &ok);
+                if (!ok) {
+                    return fail(exec, op, "stack underflow");
+                }
+                if (!bad_point(zone, point)) {
+                    zone->tags[point] ^= ON_CURVE_POINT;
+                }
+            }
+            gs->loop = 1;
+            break;
+        }
+        case 0x81: case 0x82: { // FLIPRGON, FLIPRGOFF
+            hint_zone *zone = &exec->zones[1];
+            if (bad_point(zone, args[0]) || bad_point(zone, args[1])) {
+                break;
+            }
+            for (int32_t i = args[0]; i <= args[1]; i++) {
+                if (op == 0x81) {
+                    zone->tags[i] |= ON_CURVE_POINT;
+                } else {
+                    zone->tags[i] &= ~ON_CURVE_POINT;
+                }
+            }
+            break;
+        }
+        case 0x85: // SCANCTRL
+            gs->scan_control = (uint32_t)args[0];
+            break;
+        case 0x86: case 0x87: { // SDPVTL
+            int32_t p1 = args[1], p2 = args[0];
+            if (bad_point(exec->zp1, p2) || bad_point(exec->zp2, p1)) {
+                break;
+            }
+            // a degenerate original line also cancels the rotation of the current one
+            bool rotate = op & 1;
+            hint_vector *lines[2][2] = {
+                { &exec->zp1->org[p2], &exec->zp2->org[p1] },
+                { &exec->zp1->cur[p2], &exec->zp2->cur[p1] }
+            };
+            for (uint32_t i = 0; i < 2; i++) {
+                int32_t a = lines[i][0]->x - lines[i][1]->x, b = lines[i][0]->y - lines[i][1]->y;
+                if (a == 0 && b == 0) {
+                    a = 0x4000;
+                    rotate = false;
+                }
+                if (rotate) {
+                    int32_t c = b; b = a; a = -c;
+                }
+                if (i == 0) {
+                    gs->dual = normalize(a, b);
+                } else {
+                    gs->projection = normalize(a, b);
+                }
+            }
+            update_vectors(exec);
+            break;
+        }
+        case 0x88: { // GETINFO, answering like a grayscale rasterizer of version 35
+            int32_t result = 0;
+            if (args[0] & 1) {
+                result = 35;
+            }
+            if (args[0] & 32) {
+                result |= 1 << 12;
+            }
+            args[0] = result;
+            break;
+        }
+        case 0x8A: { // ROLL
+            int32_t a = args[2];
+            args[2] = args[0];
+            args[0] = args[1];
+            args[1] = a;
+            break;
+        }
+        case 0x8B:
+            args[0] = args[0] > args[1] ? args[0] : args[1];
+            break;
+        case 0x8C:
+            args[0] = args[0] < args[1] ? args[0] : args[1];
+            break;
+        case 0x8D: // SCANTYPE
+            break;
+        case 0x8E: { // INSTCTRL, only honoured in prep
+            if (exec->in_glyph || exec->in_fpgm || args[1] < 1 || args[1] > 3) {
+                break;
+            }
+            uint8_t mask = (uint8_t)(1 << (args[1] - 1));
+            gs->instruct_control = (gs->instruct_control & ~mask) | (args[0] ? mask : 0);
+            break;
+        }
+        default:
+            if (op >= 0xC0) {
+                // MDRP[abcde]: set rp0, keep minimum distance, round, distance type
+                int32_t point = args[0];
+                if (bad_point(exec->zp1, point) || bad_point(exec->zp0, gs->rp0)) {
+                    break;
+                }
+                int32_t org_dist;
+                if (op < 0xE0) {
+                    if (gs->zp0 == 0 || gs->zp1 == 0) {
+                        org_dist = dual_project(exec, exec->zp1->org[point], exec->zp0->org[gs->rp0]);
+                    } else {
+                        org_dist = mul_fix(dual_project(exec, exec->zp1->orus[point], exec->zp0->orus[gs->rp0]), exec->scale);
+                    }
+                    if (abs_long(sub_long(org_dist, gs->single_width_value)) < gs->single_width_cutin) {
+                        org_dist = org_dist >= 0 ? gs->single_width_value : -gs->single_width_value;
+                    }
+                    int32_t distance = (op & 4) ? round_value(exec, org_dist) : org_dist;
+                    if (op & 8) {
+                        if (org_dist >= 0) {
+                            distance = distance < gs->minimum_distance ? gs->minimum_distance : distance;
+                        } else {
+                            distance = distance > -gs->minimum_distance ? -gs->minimum_distance : distance;
+                        }
+                    }
+                    int32_t cur_dist = project(exec, exec->zp1->cur[point], exec->zp0->cur[gs->rp0]);
+                    move_point(exec, exec->zp1, (uint16_t)point, distance - cur_dist);
+                } else {
+                    // MIRP[abcde], args[1] is the cvt entry, -1 meaning a zero distance
+                    int32_t cvt_dist = args[1] == -1 ? 0 : read_cvt(exec, args[1]);
+                    if (abs_long(sub_long(cvt_dist, gs->single_width_value)) < gs->single_width_cutin) {
+                        cvt_dist = cvt_dist >= 0 ? gs->single_width_value : -gs->single_width_value;
+                    }
+                    if (gs->zp1 == 0) {
+                        exec->zp1->org[point].x = exec->zp0->org[gs->rp0].x + mul_fix14(cvt_dist, gs->freedom.x);
+                        exec->zp1->org[point].y = exec->zp0->org[gs->rp0].y + mul_fix14(cvt_dist, gs->freedom.y);
+                        exec->zp1->cur[point] = exec->zp1->org[point];
+                    }
+                    org_dist = dual_project(exec, exec->zp1->org[point], exec->zp0->org[gs->rp0]);
+                    int32_t cur_dist = project(exec, exec->zp1->cur[point], exec->zp0->cur[gs->rp0]);
+                    if (gs->auto_flip && (org_dist ^ cvt_dist) < 0) {
+                        cvt_dist = -cvt_dist;
+                    }
+                    int32_t distance;
+                    if (op & 4) {
+                        if (gs->zp0 == gs->zp1 && abs_long(sub_long(cvt_dist, org_dist)) > gs->control_value_cutin) {
+                            cvt_dist = org_dist;
+                        }
+                        distance = round_value(exec, cvt_dist);
+                    } else {
+                        distance = cvt_dist;
+                    }
+                    if (op & 8) {
+                        if (org_dist >= 0) {
+                            distance = distance < gs->minimum_distance ? gs->minimum_distance : distance;
+                        } else {
+                            distance = distance > -gs->minimum_distance ? -gs->minimum_distance : distance;
+                        }
+                    }
+                    move_point(exec, exec->zp1, (uint16_t)point, distance - cur_dist);
+                }
+                gs->rp1 = gs->rp0;
+                gs->rp2 = (uint16_t)point;
+                if (op & 16) {
+                    gs->rp0 = (uint16_t)point;
+                }
+                break;
+            }
+            if (exec->idefs[op].defined) {
+                ttf_status status = call_function(exec, &exec->idefs[op], op);
+                if (status) {
+                    return status;
+                }
+                break;
+            }
+            return fail(exec, op, "invalid opcode");
+        }
+
+        if (!ok) {
+            return fail(exec, op, "stack underflow");
+        }
+        exec->top += pushes;
+        ip = next;
+    }
+    return TTF_OK;
+}
+
+static int init_zone(hint_zone *zone, uint16_t point_count) {
+    memset(zone, 0, sizeof(hint_zone));
+    zone->point_count = point_count;
+    if (point_count == 0) {
+        return 0;
+    }
+    zone->orus = calloc(point_count, sizeof(hint_vector));
+    zone->org = calloc(point_count, sizeof(hint_vector));
+    zone->cur = calloc(point_count, sizeof(hint_vector));
+    zone->tags = calloc(point_count, 1);
+    return zone->orus && zone->org && zone->cur && zone->tags ? 0 : -1;
+}
+
+static void free_zone(hint_zone *zone) {
+    free(zone->orus);
+    free(zone->org);
+    free(zone->cur);
+    free(zone->tags);
+    free(zone->contours);
+    memset(zone, 0, sizeof(hint_zone));
+}
+
+static int copy_zone(hint_zone *zone, const hint_zone *source) {
+    if (init_zone(zone, source->point_count)) {
+        return -1;
+    }
+    if (source->point_count) {
+        memcpy(zone->orus, source->orus, source->point_count * sizeof(hint_vector));
+        memcpy(zone->org, source->org, source->point_count * sizeof(hint_vector));
+        memcpy(zone->cur, source->cur, source->point_count * sizeof(hint_vector));
+        memcpy(zone->tags, source->tags, source->point_count);
+    }
+    return 0;
+}
+
+// every program run starts with these parts of the graphics state reset
+static ttf_status run_program(hint_exec *exec, const uint8_t *code, uint32_t length) {
+    exec->gs.projection = exec->gs.freedom = exec->gs.dual = (hint_vector){ 0x4000, 0 };
+    exec->gs.zp0 = exec->gs.zp1 = exec->gs.zp2 = 1;
+    exec->gs.round_state = ROUND_TO_GRID;
+    exec->gs.loop = 1;
+    exec->top = 0;
+    exec->depth = 0;
+    exec->instructions = 0;
+    update_vectors(exec);
+    update_zones(exec);
+    return run_code(exec, code, length);
+}
+
+static int init_exec(hint_exec *exec, ttf_hinter *hinter, ttf_error *error) {
+    memset(exec, 0, sizeof(hint_exec));
+    exec->hinter = hinter;
+    exec->error = error;
+    exec->stack_size = hinter->max_stack;
+    exec->stack = malloc(exec->stack_size * sizeof(int32_t));
+    exec->storage = calloc(hinter->max_storage + 1, sizeof(int32_t));
+    exec->cvt = calloc(hinter->cvt_count + 1, sizeof(int32_t));
+    return exec->stack && exec->storage && exec->cvt ? 0 : -1;
+}
+
+static void free_exec(hint_exec *exec) {
+    free(exec->stack);
+    free(exec->storage);
+    free(exec->cvt);
+    free_zone(&exec->zones[0]);
+    free_zone(&exec->zones[1]);
+}
+
+ttf_status init_hinter(ttf_hinter *hinter, ttf_font *font, ttf_error *error) {
+    memset(hinter, 0, sizeof(ttf_hinter));
+    hinter->font = font;
+    pthread_mutex_init(&hinter->lock, NULL);
+
+    maxp_table *maxp = NULL;
+    ttf_status status = load_maxp_table(&font->source, &maxp, error);
+    if (status) {
+        free_hinter(hinter);
+        return status;
+    }
+    if (ntohl(maxp->version) < 0x00010000) {
+        free_hinter(hinter);
+        return ttf_fail(error, TTF_ERR_UNSUPPORTED, "maxp has no TrueType limits");
+    }
+    // FreeType pads the stack too, fonts routinely understate their depth
+    hinter->max_stack = ntohs(maxp->maxStackElements) + 32;
+    hinter->max_storage = ntohs(maxp->maxStorage);
+    hinter->max_functions = ntohs(maxp->maxFunctionDefs);
+    hinter->max_twilight = ntohs(maxp->maxTwilightPoints);
+
+    ttf_table_record record = {0};
+    uint8_t *data = (uint8_t*)font->source.data;
+    if (!find_table_record(&font->source, &record, FPGM_TAG)) {
+        hinter->fpgm = data + ntohl(record.offset);
+        hinter->fpgm_length = ntohl(record.length);
+    }
+    if (!find_table_record(&font->source, &record, PREP_TAG)) {
+        hinter->prep = data + ntohl(record.offset);
+        hinter->prep_length = ntohl(record.length);
+    }
+    if (!find_table_record(&font->source, &record, CVT_TAG)) {
+        hinter->cvt = (const uint16_t*)(data + ntohl(record.offset));
+        hinter->cvt_count = ntohl(record.length) / 2;
+    }
+
+    hinter->functions = calloc(hinter->max_functions + 1, sizeof(hint_function));
+    if (!hinter->functions) {
+        free_hinter(hinter);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory starting the hinter");
+    }
+    if (hinter->fpgm_length == 0) {
+        return TTF_OK;
+    }
+
+    hint_exec exec = {0};
+    if (init_exec(&exec, hinter, error)) {
+        free_exec(&exec);
+        free_hinter(hinter);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory starting the hinter");
+    }
+    exec.gs = default_state;
+    exec.functions = hinter->functions;
+    exec.idefs = hinter->idefs;
+    exec.in_fpgm = true;
+    status = run_program(&exec, hinter->fpgm, hinter->fpgm_length);
+    free_exec(&exec);
+    if (status) {
+        free_hinter(hinter);
+    }
+    return status;
+}
+
+static void free_size(ttf_hinter *hinter, hint_size *size) {
+    if (size->glyphs) {
+        for (uint16_t i = 0; i < hinter->font->glyph_count; i++) {
+            hinted_glyph *glyph = atomic_load_explicit(&size->glyphs[i], memory_order_relaxed);
+            if (glyph && glyph != &no_outline) {
+                free(glyph->outline.flags);
+                free(glyph->outline.x_poss);
+                free(glyph->outline.y_poss);
+                free(glyph);
+            }
+        }
+    }
+    free(size->glyphs);
+    free(size->cvt);
+    free(size->storage);
+    free(size->functions);
+    free_zone(&size->twilight);
+    free(size);
+}
+
+void free_hinter(ttf_hinter *hinter) {
+    for (uint32_t ppem = 0; ppem <= HINT_MAX_PPEM; ppem++) {
+        hint_size *size = atomic_load_explicit(&hinter->sizes[ppem], memory_order_relaxed);
+        if (size) {
+            free_size(hinter, size);
+        }
+    }
+    free(hinter->functions);
+    pthread_mutex_destroy(&hinter->lock);
+    memset(hinter, 0, sizeof(ttf_hinter));
+}
+
+// scales the cvt and runs prep; a failing prep leaves the size's glyphs unhinted
+static hint_size* create_size(ttf_hinter *hinter, uint16_t ppem) {
+    hint_size *size = calloc(1, sizeof(hint_size));
+    if (!size) {
+        return NULL;
+    }
+    size->ppem = ppem;
+    size->scale = mul_div((int64_t)ppem << 6, 0x10000, get_units_per_em(hinter->font->head));
+    size->glyphs = calloc(hinter->font->glyph_count, sizeof(_Atomic(hinted_glyph*)));
+    size->functions = malloc((hinter->max_functions + 1) * sizeof(hint_function));
+    hint_exec exec = {0};
+    if (!size->glyphs || !size->functions || init_exec(&exec, hinter, NULL)
+        || init_zone(&exec.zones[0], (uint16_t)hinter->max_twilight)) {
+        free_exec(&exec);
+        free_size(hinter, size);
+        return NULL;
+    }
+    memcpy(size->functions, hinter->functions, (hinter->max_functions + 1) * sizeof(hint_function));
+    memcpy(size->idefs, hinter->idefs, sizeof(size->idefs));
+
+    for (uint32_t i = 0; i < hinter->cvt_count; i++) {
+        // FreeType keeps unscaled cvt entries in F26.6 and drops the scale's low bits,
+        // fonts tuned against it round a pixel differently with the exact product
+        exec.cvt[i] = mul_fix((int16_t)ntohs(hinter->cvt[i]) * 64, size->scale >> 6);
+    }
+    exec.gs = default_state;
+    exec.scale = size->scale;
+    exec.ppem = ppem;
+    exec.functions = size->functions;
+    exec.idefs = size->idefs;
+    if (hinter->prep_length) {
+        size->prep_failed = run_program(&exec, hinter->prep, hinter->prep_length) != TTF_OK;
+    }
+
+    size->state = exec.gs;
+    size->cvt = exec.cvt;
+    size->storage = exec.storage;
+    size->twilight = exec.zones[0];
+    exec.cvt = NULL;
+    exec.storage = NULL;
+    memset(&exec.zones[0], 0, sizeof(hint_zone));
+    free_exec(&exec);
+    return size;
+}
+
+static hint_size* get_size(ttf_hinter *hinter, uint16_t ppem) {
+    hint_size *size = atomic_load_explicit(&hinter->sizes[ppem], memory_order_acquire);
+    if (size) {
+        return size;
+    }
+    pthread_mutex_lock(&hinter->lock);
+    size = atomic_load_explicit(&hinter->sizes[ppem], memory_order_relaxed);
+    if (!size) {
+        size = create_size(hinter, ppem);
+        atomic_store_explicit(&hinter->sizes[ppem], size, memory_order_release);
+    }
+    pthread_mutex_unlock(&hinter->lock);
+    return size;
+}
+
+static int16_t clamp_int16(int32_t value) {
+    return (int16_t)(value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value));
+}
+
+static hinted_glyph* hint_glyph(ttf_hinter *hinter, hint_size *size, uint16_t index, const glyph_t *glyph) {
+    ttf_font *font = hinter->font;
+    hint_exec exec = {0};
+    uint16_t count = glyph->count;
+    hinted_glyph *hinted = calloc(1, sizeof(hinted_glyph));
+    if (!hinted || init_exec(&exec, hinter, NULL) || copy_zone(&exec.zones[0], &size->twilight)
+        || init_zone(&exec.zones[1], count + HINT_PHANTOM_POINTS)) {
+        free(hinted);
+        free_exec(&exec);
+        return NULL;
+    }
+    hint_zone *zone = &exec.zones[1];
+    zone->contours = malloc((glyph->numberOfContours + 1) * sizeof(uint16_t));
+    if (!zone->contours) {
+        free(hinted);
+        free_exec(&exec);
+        return NULL;
+    }
+    for (int16_t c = 0; c < glyph->numberOfContours; c++) {
+        zone->contours[c] = ntohs(glyph->endPtsOfContours[c]);
+    }
+    zone->contour_count = (uint16_t)glyph->numberOfContours;
+
+    for (uint16_t i = 0; i < count; i++) {
+        zone->orus[i] = (hint_vector){ glyph->x_poss[i], glyph->y_poss[i] };
+        zone->tags[i] = glyph->flags[i] & ON_CURVE_POINT;
+    }
+    // phantom points: origin, advance, then top and bottom of the line
+    int16_t ascender = (int16_t)ntohs(font->hhea->ascender);
+    int16_t descender = (int16_t)ntohs(font->hhea->descender);
+    int32_t origin = glyph->xMin - get_left_side_bearing(font->hhea, font->hmtx, index);
+    zone->orus[count] = (hint_vector){ origin, 0 };
+    zone->orus[count + 1] = (hint_vector){ origin + font_advance_width(font, index), 0 };
+    zone->orus[count + 2] = (hint_vector){ 0, ascender };
+    zone->orus[count + 3] = (hint_vector){ 0, descender };
+    for (uint16_t i = 0; i < zone->point_count; i++) {
+        zone->org[i] = (hint_vector){ mul_fix(zone->orus[i].x, size->scale), mul_fix(zone->orus[i].y, size->scale) };
+        zone->cur[i] = zone->org[i];
+    }
+    zone->cur[count].x = (zone->cur[count].x + 32) & -64;
+    zone->cur[count + 1].x = (zone->cur[count + 1].x + 32) & -64;
+    zone->cur[count + 2].y = (zone->cur[count + 2].y + 32) & -64;
+    zone->cur[count + 3].y = (zone->cur[count + 3].y + 32) & -64;
+
+    const uint8_t *code = NULL;
+    uint16_t length = 0;
+    uint32_t glyph_offset = font->locations[index];
+    load_glyph_instructions(&font->source, glyph_offset, font->locations[index + 1] - glyph_offset, &code, &length, NULL);
+
+    exec.gs = size->state.instruct_control & 2 ? default_state : size->state;
+    exec.scale = size->scale;
+    exec.ppem = size->ppem;
+    exec.functions = size->functions;
+    exec.idefs = size->idefs;
+    exec.in_glyph = true;
+    memcpy(exec.cvt, size->cvt, hinter->cvt_count * sizeof(int32_t));
+    memcpy(exec.storage, size->storage, hinter->max_storage * sizeof(int32_t));
+
+    bool hinting = !size->prep_failed && !(size->state.instruct_control & 1) && length > 0;
+    if (hinting && run_program(&exec, code, length)) {
+        // a broken glyph program falls back to the plain scaled outline
+        for (uint16_t i = 0; i < zone->point_count; i++) {
+            zone->cur[i] = zone->org[i];
+            zone->tags[i] = i < count ? glyph->flags[i] & ON_CURVE_POINT : 0;
+        }
+    }
+
+    glyph_t *outline = &hinted->outline;
+    *outline = *glyph;
+    outline->owns_end_points = false;
+    outline->flags = malloc(count);
+    outline->x_poss = malloc(count * sizeof(int16_t));
+    outline->y_poss = malloc(count * sizeof(int16_t));
+    if (!outline->flags || !outline->x_poss || !outline->y_poss) {
+        free(outline->flags);
+        free(outline->x_poss);
+        free(outline->y_poss);
+        free(hinted);
+        free_exec(&exec);
+        return NULL;
+    }
+
+    int32_t x_min = INT32_MAX, y_min = INT32_MAX, x_max = INT32_MIN, y_max = INT32_MIN;
+    for (uint16_t i = 0; i < count; i++) {
+        hint_vector p = zone->cur[i];
+        outline->flags[i] = (glyph->flags[i] & ~ON_CURVE_POINT) | (zone->tags[i] & ON_CURVE_POINT);
+        outline->x_poss[i] = clamp_int16(p.x);
+        outline->y_poss[i] = clamp_int16(p.y);
+        x_min = p.x < x_min ? p.x : x_min;
+        y_min = p.y < y_min ? p.y : y_min;
+        x_max = p.x > x_max ? p.x : x_max;
+        y_max = p.y > y_max ? p.y : y_max;
+    }
+    outline->xMin = clamp_int16(x_min);
+    outline->yMin = clamp_int16(y_min);
+    outline->xMax = clamp_int16(x_max);
+    outline->yMax = clamp_int16(y_max);
+    hinted->advance = zone->cur[count + 1].x - zone->cur[count].x;
+
+    free_exec(&exec);
+    return hinted;
+}
+
+// same publication scheme as get_font_glyph: racing threads may both hint a glyph,
+// the first CAS wins and the loser frees its copy
+const hinted_glyph* get_hinted_glyph(ttf_hinter *hinter, uint16_t index, uint16_t ppem) {
+    if (ppem == 0 || ppem > HINT_MAX_PPEM || index >= hinter->font->glyph_count) {
+        return NULL;
+    }
+    hint_size *size = get_size(hinter, ppem);
+    if (!size) {
+        return NULL;
+    }
+
+    hinted_glyph *hinted = atomic_load_explicit(&size->glyphs[index], memory_order_acquire);
+    if (!hinted) {
+        const glyph_t *glyph = get_font_glyph(hinter->font, index);
+        hinted_glyph *fresh = glyph ? hint_glyph(hinter, size, index, glyph) : &no_outline;
+        if (!fresh) {
+            return NULL;
+        }
+        if (atomic_compare_exchange_strong_explicit(&size->glyphs[index], &hinted, fresh,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            hinted = fresh;
+        } else if (fresh != &no_outline) {
+            free(fresh->outline.flags);
+            free(fresh->outline.x_poss);
+            free(fresh->outline.y_poss);
+            free(fresh);
+        }
+    }
+    return hinted == &no_outline ? NULL : hinted;
+}
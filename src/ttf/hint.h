@@ -0,0 +1,140 @@
+#ifndef HINT
+#define HINT
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "font.h"
+#include "maxp.h"
+
+#define FPGM_TAG "fpgm"
+#define PREP_TAG "prep"
+#define CVT_TAG "cvt "
+
+// hinted outlines keep F26.6 pixels in int16, which holds glyphs up to this size
+#define HINT_MAX_PPEM 200
+#define HINT_PHANTOM_POINTS 4
+#define HINT_MAX_CALL_DEPTH 64
+// guards against programs that never terminate, counted per program run
+#define HINT_MAX_INSTRUCTIONS 1000000
+
+// hinted outlines are in F26.6 pixels, so they flatten at their ppem with
+// ppem * HINT_UNITS_PER_PIXEL units per em
+#define HINT_UNITS_PER_PIXEL 64
+
+#define HINT_TOUCHED_X 0x08
+#define HINT_TOUCHED_Y 0x10
+
+typedef struct hint_vector {
+    int32_t x;
+    int32_t y;
+} hint_vector;
+
+typedef enum hint_round_state {
+    ROUND_TO_HALF_GRID,
+    ROUND_TO_GRID,
+    ROUND_TO_DOUBLE_GRID,
+    ROUND_DOWN_TO_GRID,
+    ROUND_UP_TO_GRID,
+    ROUND_OFF,
+    ROUND_SUPER,
+    ROUND_SUPER_45
+} hint_round_state;
+
+// vectors are 2.14 unit vectors, distances F26.6
+typedef struct hint_graphics_state {
+    hint_vector projection;
+    hint_vector freedom;
+    hint_vector dual;
+    uint16_t rp0;
+    uint16_t rp1;
+    uint16_t rp2;
+    uint8_t zp0;
+    uint8_t zp1;
+    uint8_t zp2;
+    int32_t loop;
+    int32_t minimum_distance;
+    int32_t control_value_cutin;
+    int32_t single_width_cutin;
+    int32_t single_width_value;
+    uint16_t delta_base;
+    uint16_t delta_shift;
+    bool auto_flip;
+    hint_round_state round_state;
+    // super rounding parameters in F26.6
+    int32_t period;
+    int32_t phase;
+    int32_t threshold;
+    uint8_t instruct_control;
+    uint32_t scan_control;
+} hint_graphics_state;
+
+typedef struct hint_function {
+    const uint8_t *code;
+    uint32_t length;
+    bool defined;
+} hint_function;
+
+// zone 0 is the twilight zone, zone 1 holds the glyph's points followed by the
+// four phantom points; orus are font units, org the scaled and cur the hinted points
+typedef struct hint_zone {
+    hint_vector *orus;
+    hint_vector *org;
+    hint_vector *cur;
+    uint8_t *tags;
+    uint16_t *contours;
+    uint16_t point_count;
+    uint16_t contour_count;
+} hint_zone;
+
+// advance is the hinted distance between the first two phantom points
+typedef struct hinted_glyph {
+    glyph_t outline;
+    int32_t advance;
+} hinted_glyph;
+
+// Everything prep leaves behind for one ppem; glyph programs start from copies of
+// it so glyphs hint the same whatever order they are loaded in.
+typedef struct hint_size {
+    uint16_t ppem;
+    int32_t scale;
+    bool prep_failed;
+    hint_graphics_state state;
+    int32_t *cvt;
+    int32_t *storage;
+    hint_function *functions;
+    hint_function idefs[256];
+    hint_zone twilight;
+    _Atomic(hinted_glyph*) *glyphs;
+} hint_size;
+
+// fpgm runs once in init_hinter; sizes are created on first use under lock,
+// after which lookups are lock-free like get_font_glyph
+typedef struct ttf_hinter {
+    ttf_font *font;
+    const uint8_t *fpgm;
+    uint32_t fpgm_length;
+    const uint8_t *prep;
+    uint32_t prep_length;
+    const uint16_t *cvt;
+    uint32_t cvt_count;
+    uint32_t max_stack;
+    uint32_t max_storage;
+    uint32_t max_functions;
+    uint32_t max_twilight;
+    hint_function *functions;
+    hint_function idefs[256];
+    pthread_mutex_t lock;
+    _Atomic(hint_size*) sizes[HINT_MAX_PPEM + 1];
+} ttf_hinter;
+
+ttf_status init_hinter(ttf_hinter *hinter, ttf_font *font, ttf_error *error);
+void free_hinter(ttf_hinter *hinter);
+
+// NULL for glyphs without an outline and ppems outside 1..HINT_MAX_PPEM; a glyph
+// whose program fails comes back scaled but unhinted
+const hinted_glyph* get_hinted_glyph(ttf_hinter *hinter, uint16_t index, uint16_t ppem);
+
+#endif
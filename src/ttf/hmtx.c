@@ -0,0 +1,43 @@
+#include "hmtx.h"
+
+ttf_status load_hhea_table(ttf_source *source, hhea_table **hhea, ttf_error *error) {
+
+    ttf_table_record hhea_record = {0};
+    ttf_status status = load_table_record(source, &hhea_record, HHEA_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    *hhea = (hhea_table *)((uint8_t*)source->data + ntohl(hhea_record.offset));
+    return TTF_OK;
+}
+
+ttf_status load_hmtx_table(ttf_source *source, long_hor_metric **hmtx, ttf_error *error) {
+
+    ttf_table_record hmtx_record = {0};
+    ttf_status status = load_table_record(source, &hmtx_record, HMTX_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    *hmtx = (long_hor_metric *)((uint8_t*)source->data + ntohl(hmtx_record.offset));
+    return TTF_OK;
+}
+
+// glyphs past numberOfHMetrics repeat the last advance
+uint16_t get_advance_width(hhea_table *hhea, long_hor_metric *hmtx, uint16_t index) {
+    uint16_t count = ntohs(hhea->numberOfHMetrics);
+    if (index >= count) {
+        index = count - 1;
+    }
+    return ntohs(hmtx[index].advanceWidth);
+}
+
+int16_t get_left_side_bearing(hhea_table *hhea, long_hor_metric *hmtx, uint16_t index) {
+    uint16_t count = ntohs(hhea->numberOfHMetrics);
+    if (index < count) {
+        return (int16_t)ntohs(hmtx[index].lsb);
+    }
+    int16_t *bearings = (int16_t*)(hmtx + count);
+    return (int16_t)ntohs(bearings[index - count]);
+}
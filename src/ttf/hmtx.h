@@ -0,0 +1,45 @@
+#ifndef HMTX
+#define HMTX
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+
+#define HHEA_TAG "hhea"
+#define HMTX_TAG "hmtx"
+
+#pragma pack(1)
+
+typedef struct hhea_table {
+    fixed_t version;
+    int16_t ascender;
+    int16_t descender;
+    int16_t lineGap;
+    uint16_t advanceWidthMax;
+    int16_t minLeftSideBearing;
+    int16_t minRightSideBearing;
+    int16_t xMaxExtent;
+    int16_t caretSlopeRise;
+    int16_t caretSlopeRun;
+    int16_t caretOffset;
+    int16_t reserved[4];
+    int16_t metricDataFormat;
+    uint16_t numberOfHMetrics;
+} hhea_table;
+
+typedef struct long_hor_metric {
+    uint16_t advanceWidth;
+    int16_t lsb;
+} long_hor_metric;
+
+#pragma pack()
+
+ttf_status load_hhea_table(ttf_source *source, hhea_table **hhea, ttf_error *error);
+ttf_status load_hmtx_table(ttf_source *source, long_hor_metric **hmtx, ttf_error *error);
+uint16_t get_advance_width(hhea_table *hhea, long_hor_metric *hmtx, uint16_t index);
+int16_t get_left_side_bearing(hhea_table *hhea, long_hor_metric *hmtx, uint16_t index);
+
+#endif
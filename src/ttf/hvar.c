@@ -0,0 +1,76 @@
+#include <string.h>
+
+#include "hvar.h"
+
+int load_hvar(ttf_source *source, hvar_table *hvar) {
+    ttf_table_record hvar_record = {0};
+    memset(hvar, 0, sizeof(hvar_table));
+
+    if (find_table_record(source, &hvar_record, HVAR_TAG)) {
+        return -1;
+    }
+
+    uint8_t *table = (uint8_t*)source->data + ntohl(hvar_record.offset);
+    hvar_header *header = (hvar_header*)table;
+
+    if (load_item_variation_store(table + ntohl(header->itemVariationStoreOffset), &hvar->store)) {
+        return -1;
+    }
+
+    uint32_t map_offset = ntohl(header->advanceWidthMappingOffset);
+    hvar->advance_map = map_offset ? table + map_offset : NULL;
+
+    return 0;
+}
+
+float get_advance_delta(const hvar_table *hvar, uint16_t glyph_index, const float *scalars) {
+    uint16_t outer, inner;
+    lookup_delta_set_index(hvar->advance_map, glyph_index, &outer, &inner);
+    return get_item_delta(&hvar->store, outer, inner, scalars);
+}
+
+int load_mvar(ttf_source *source, mvar_table *mvar) {
+    ttf_table_record mvar_record = {0};
+    memset(mvar, 0, sizeof(mvar_table));
+
+    if (find_table_record(source, &mvar_record, MVAR_TAG)) {
+        return -1;
+    }
+
+    uint8_t *table = (uint8_t*)source->data + ntohl(mvar_record.offset);
+    mvar_header *header = (mvar_header*)table;
+    uint16_t store_offset = ntohs(header->itemVariationStoreOffset);
+
+    // a table without a store carries no deltas
+    if (store_offset == 0 || load_item_variation_store(table + store_offset, &mvar->store)) {
+        return -1;
+    }
+
+    mvar->records = table + sizeof(mvar_header);
+    mvar->record_size = ntohs(header->valueRecordSize);
+    mvar->record_count = ntohs(header->valueRecordCount);
+
+    return 0;
+}
+
+// value records are sorted by tag
+float get_metric_delta(const mvar_table *mvar, const char tag[4], const float *scalars) {
+    int lo = 0, hi = (int)mvar->record_count - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        mvar_value_record *rec = (mvar_value_record*)(mvar->records + mid * mvar->record_size);
+        int cmp = memcmp(rec->valueTag, tag, 4);
+
+        if (cmp == 0) {
+            return get_item_delta(&mvar->store, ntohs(rec->deltaSetOuterIndex), ntohs(rec->deltaSetInnerIndex), scalars);
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return 0.0f;
+}
@@ -0,0 +1,64 @@
+#ifndef HVAR
+#define HVAR
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "varstore.h"
+
+#define HVAR_TAG "HVAR"
+#define MVAR_TAG "MVAR"
+
+#define MVAR_HORIZONTAL_ASCENDER "hasc"
+#define MVAR_HORIZONTAL_DESCENDER "hdsc"
+#define MVAR_HORIZONTAL_LINE_GAP "hlgp"
+
+#pragma pack(1)
+
+typedef struct hvar_header {
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+    uint32_t itemVariationStoreOffset;
+    uint32_t advanceWidthMappingOffset;
+    uint32_t lsbMappingOffset;
+    uint32_t rsbMappingOffset;
+} hvar_header;
+
+typedef struct mvar_header {
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+    uint16_t reserved;
+    uint16_t valueRecordSize;
+    uint16_t valueRecordCount;
+    uint16_t itemVariationStoreOffset;
+} mvar_header;
+
+typedef struct mvar_value_record {
+    char valueTag[4];
+    uint16_t deltaSetOuterIndex;
+    uint16_t deltaSetInnerIndex;
+} mvar_value_record;
+
+#pragma pack()
+
+typedef struct hvar_table {
+    item_variation_store store;
+    uint8_t *advance_map;
+} hvar_table;
+
+typedef struct mvar_table {
+    item_variation_store store;
+    uint8_t *records;
+    uint16_t record_size;
+    uint16_t record_count;
+} mvar_table;
+
+int load_hvar(ttf_source *source, hvar_table *hvar);
+float get_advance_delta(const hvar_table *hvar, uint16_t glyph_index, const float *scalars);
+
+int load_mvar(ttf_source *source, mvar_table *mvar);
+float get_metric_delta(const mvar_table *mvar, const char tag[4], const float *scalars);
+
+#endif
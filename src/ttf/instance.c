@@ -0,0 +1,268 @@
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#include "instance.h"
+#include "loca.h"
+
+ttf_status init_instance_cache(ttf_instance_cache *cache, ttf_source *source, ttf_error *error) {
+    maxp_table *maxp = NULL;
+    ttf_status status;
+    memset(cache, 0, sizeof(ttf_instance_cache));
+
+    if (load_fvar(source, &cache->fvar) || load_gvar(source, &cache->gvar)) {
+        return ttf_fail(error, TTF_ERR_UNSUPPORTED, "font has no usable fvar/gvar tables");
+    }
+    if (cache->gvar.axis_count != cache->fvar.axis_count) {
+        return ttf_fail(error, TTF_ERR_MALFORMED, "gvar and fvar disagree on axis count");
+    }
+
+    if ((status = load_head_table(source, &cache->head, error))
+        || (status = load_maxp_table(source, &maxp, error))
+        || (status = load_hhea_table(source, &cache->hhea, error))
+        || (status = load_hmtx_table(source, &cache->hmtx, error))) {
+        return status;
+    }
+
+    cache->source = source;
+    cache->glyph_count = get_num_glyphs(maxp);
+    cache->base_glyphs = calloc(cache->glyph_count, sizeof(glyph_t*));
+    if (!cache->base_glyphs) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory caching %u glyphs", cache->glyph_count);
+    }
+    cache->has_hvar = !load_hvar(source, &cache->hvar) && cache->hvar.store.axis_count == cache->fvar.axis_count;
+    cache->has_mvar = !load_mvar(source, &cache->mvar) && cache->mvar.store.axis_count == cache->fvar.axis_count;
+
+    return TTF_OK;
+}
+
+static void free_instance(ttf_instance_cache *cache, ttf_instance *instance) {
+    for (uint16_t i = 0; instance->glyphs && i < cache->glyph_count; i++) {
+        free_glyph(instance->glyphs[i]);
+    }
+    free(instance->glyphs);
+    free(instance->advances);
+    free(instance->shared_scalars);
+    free(instance->hvar_scalars);
+    free(instance->mvar_scalars);
+    free(instance);
+}
+
+void free_instance_cache(ttf_instance_cache *cache) {
+    for (size_t i = 0; i < cache->count; i++) {
+        free_instance(cache, cache->instances[i]);
+    }
+    for (uint16_t i = 0; i < cache->glyph_count; i++) {
+        free_glyph(cache->base_glyphs[i]);
+    }
+    free(cache->base_glyphs);
+    memset(cache, 0, sizeof(ttf_instance_cache));
+}
+
+ttf_status get_instance(ttf_instance_cache *cache, const float *user_coords, ttf_instance **instance, ttf_error *error) {
+    int16_t coords[TTF_MAX_AXES] = {0};
+    normalize_axis_coords(&cache->fvar, user_coords, coords);
+    return get_normalized_instance(cache, coords, instance, error);
+}
+
+ttf_status get_normalized_instance(ttf_instance_cache *cache, const int16_t *coords, ttf_instance **instance, ttf_error *error) {
+    size_t coords_size = cache->fvar.axis_count * sizeof(int16_t);
+    cache->clock++;
+
+    for (size_t i = 0; i < cache->count; i++) {
+        if (memcmp(cache->instances[i]->coords, coords, coords_size) == 0) {
+            cache->instances[i]->last_used = cache->clock;
+            *instance = cache->instances[i];
+            return TTF_OK;
+        }
+    }
+
+    // built before anything is evicted, so a failure leaves the cache as it was
+    ttf_instance *created = calloc(1, sizeof(ttf_instance));
+    if (!created) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory creating an instance");
+    }
+    memcpy(created->coords, coords, coords_size);
+    created->shared_scalars = malloc((cache->gvar.shared_tuple_count + 1) * sizeof(float));
+    created->glyphs = calloc(cache->glyph_count, sizeof(glyph_t*));
+    if (cache->has_hvar) {
+        created->hvar_scalars = malloc((cache->hvar.store.region_count + 1) * sizeof(float));
+    }
+    if (cache->has_mvar) {
+        created->mvar_scalars = malloc((cache->mvar.store.region_count + 1) * sizeof(float));
+    }
+    if (!created->shared_scalars || !created->glyphs
+        || (cache->has_hvar && !created->hvar_scalars) || (cache->has_mvar && !created->mvar_scalars)) {
+        free_instance(cache, created);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory creating an instance");
+    }
+
+    created->last_used = cache->clock;
+    compute_shared_scalars(&cache->gvar, created->coords, created->shared_scalars);
+    if (cache->has_hvar) {
+        compute_region_scalars(&cache->hvar.store, created->coords, created->hvar_scalars);
+    }
+    if (cache->has_mvar) {
+        compute_region_scalars(&cache->mvar.store, created->coords, created->mvar_scalars);
+    }
+
+    size_t slot = cache->count;
+    if (cache->count == INSTANCE_CACHE_SIZE) {
+        slot = 0;
+        for (size_t i = 1; i < cache->count; i++) {
+            if (cache->instances[i]->last_used < cache->instances[slot]->last_used) {
+                slot = i;
+            }
+        }
+        free_instance(cache, cache->instances[slot]);
+    } else {
+        cache->count++;
+    }
+
+    cache->instances[slot] = created;
+    *instance = created;
+    return TTF_OK;
+}
+
+static glyph_t* get_base_glyph(ttf_instance_cache *cache, uint16_t index) {
+    if (cache->base_glyphs[index]) {
+        return cache->base_glyphs[index];
+    }
+
+    // empty and composite glyphs have no outline to vary
+    uint32_t glyph_offset, glyph_length;
+    if (load_glyph_location(cache->source, cache->head, index, &glyph_offset, &glyph_length, NULL)
+        || load_glyph(cache->source, glyph_offset, glyph_length, &cache->base_glyphs[index], NULL)) {
+        return NULL;
+    }
+    return cache->base_glyphs[index];
+}
+
+ttf_status get_instance_glyph(ttf_instance_cache *cache, ttf_instance *instance, uint16_t index, glyph_t **glyph, ttf_error *error) {
+    *glyph = NULL;
+    if (index >= cache->glyph_count) {
+        return ttf_fail(error, TTF_ERR_RANGE, "glyph %u out of range", index);
+    }
+    if (instance->glyphs[index]) {
+        *glyph = instance->glyphs[index];
+        return TTF_OK;
+    }
+
+    glyph_t *base = get_base_glyph(cache, index);
+    if (!base) {
+        return TTF_OK;
+    }
+
+    uint16_t count = base->count;
+    float *acc_x = calloc(count * 2, sizeof(float));
+    glyph_t *varied = copy_glyph(base);
+    if (!acc_x || !varied) {
+        free(acc_x);
+        free_glyph(varied);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory varying glyph %u", index);
+    }
+    float *acc_y = acc_x + count;
+    if (index < cache->gvar.glyph_count
+        && apply_glyph_variations(&cache->gvar, index, instance->coords, instance->shared_scalars, base, acc_x, acc_y)) {
+        free(acc_x);
+        free_glyph(varied);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory varying glyph %u", index);
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        varied->x_poss[i] = (int16_t)floorf(base->x_poss[i] + acc_x[i] + 0.5f);
+        varied->y_poss[i] = (int16_t)floorf(base->y_poss[i] + acc_y[i] + 0.5f);
+    }
+    free(acc_x);
+
+    varied->xMin = varied->xMax = varied->x_poss[0];
+    varied->yMin = varied->yMax = varied->y_poss[0];
+    for (uint16_t i = 1; i < count; i++) {
+        if (varied->x_poss[i] < varied->xMin) varied->xMin = varied->x_poss[i];
+        if (varied->x_poss[i] > varied->xMax) varied->xMax = varied->x_poss[i];
+        if (varied->y_poss[i] < varied->yMin) varied->yMin = varied->y_poss[i];
+        if (varied->y_poss[i] > varied->yMax) varied->yMax = varied->y_poss[i];
+    }
+
+    instance->glyphs[index] = varied;
+    *glyph = varied;
+    return TTF_OK;
+}
+
+typedef struct preload_job {
+    ttf_instance_cache *cache;
+    ttf_instance *instance;
+    atomic_bool failed;
+} preload_job;
+
+static void preload_range(uint32_t begin, uint32_t end, void *arg) {
+    preload_job *job = arg;
+    glyph_t *glyph;
+    for (uint32_t i = begin; i < end; i++) {
+        if (get_instance_glyph(job->cache, job->instance, (uint16_t)i, &glyph, NULL)) {
+            atomic_store(&job->failed, true);
+        }
+    }
+}
+
+// every glyph index is owned by exactly one chunk, so the lazy slots need no locking
+ttf_status preload_instance(ttf_instance_cache *cache, ttf_instance *instance, thread_pool *pool, ttf_error *error) {
+    preload_job job = { cache, instance, false };
+    parallel_for(pool, 0, cache->glyph_count, 0, preload_range, &job);
+    if (atomic_load(&job.failed) || !get_instance_advances(cache, instance)) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory preloading an instance");
+    }
+    return TTF_OK;
+}
+
+static uint16_t resolve_advance(ttf_instance_cache *cache, ttf_instance *instance, uint16_t index) {
+    float advance = get_advance_width(cache->hhea, cache->hmtx, index);
+    if (cache->has_hvar) {
+        advance += get_advance_delta(&cache->hvar, index, instance->hvar_scalars);
+    }
+    return advance > 0.0f ? (uint16_t)floorf(advance + 0.5f) : 0;
+}
+
+// Advances for the whole font are resolved through HVAR once per instance,
+// so layout never needs the outline or its phantom points.
+const uint16_t* get_instance_advances(ttf_instance_cache *cache, ttf_instance *instance) {
+    if (instance->advances) {
+        return instance->advances;
+    }
+
+    uint16_t *advances = malloc(cache->glyph_count * sizeof(uint16_t));
+    if (!advances) {
+        return NULL;
+    }
+    for (uint16_t i = 0; i < cache->glyph_count; i++) {
+        advances[i] = resolve_advance(cache, instance, i);
+    }
+
+    instance->advances = advances;
+    return instance->advances;
+}
+
+uint16_t get_instance_advance(ttf_instance_cache *cache, ttf_instance *instance, uint16_t index) {
+    if (index >= cache->glyph_count) {
+        return 0;
+    }
+    // without room for the table the one advance is resolved directly
+    const uint16_t *advances = get_instance_advances(cache, instance);
+    return advances ? advances[index] : resolve_advance(cache, instance, index);
+}
+
+float get_instance_metric_delta(ttf_instance_cache *cache, ttf_instance *instance, const char tag[4]) {
+    if (!cache->has_mvar) {
+        return 0.0f;
+    }
+    return get_metric_delta(&cache->mvar, tag, instance->mvar_scalars);
+}
+
+void get_instance_line_metrics(ttf_instance_cache *cache, ttf_instance *instance, line_metrics *metrics) {
+    metrics->ascender = (int16_t)ntohs(cache->hhea->ascender)
+        + get_instance_metric_delta(cache, instance, MVAR_HORIZONTAL_ASCENDER);
+    metrics->descender = (int16_t)ntohs(cache->hhea->descender)
+        + get_instance_metric_delta(cache, instance, MVAR_HORIZONTAL_DESCENDER);
+    metrics->line_gap = (int16_t)ntohs(cache->hhea->lineGap)
+        + get_instance_metric_delta(cache, instance, MVAR_HORIZONTAL_LINE_GAP);
+}
@@ -0,0 +1,73 @@
+#ifndef INSTANCE
+#define INSTANCE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+#include "maxp.h"
+#include "glyph.h"
+#include "fvar.h"
+#include "gvar.h"
+#include "hmtx.h"
+#include "hvar.h"
+#include "pool.h"
+
+#define INSTANCE_CACHE_SIZE 8
+
+typedef struct ttf_instance {
+    int16_t coords[TTF_MAX_AXES];
+    float *shared_scalars;
+    float *hvar_scalars;
+    float *mvar_scalars;
+    glyph_t **glyphs;
+    uint16_t *advances;
+    uint64_t last_used;
+} ttf_instance;
+
+typedef struct line_metrics {
+    float ascender;
+    float descender;
+    float line_gap;
+} line_metrics;
+
+typedef struct ttf_instance_cache {
+    ttf_source *source;
+    head_table *head;
+    fvar_info fvar;
+    gvar_table gvar;
+    hhea_table *hhea;
+    long_hor_metric *hmtx;
+    hvar_table hvar;
+    mvar_table mvar;
+    bool has_hvar;
+    bool has_mvar;
+    uint16_t glyph_count;
+    glyph_t **base_glyphs;
+    ttf_instance *instances[INSTANCE_CACHE_SIZE];
+    size_t count;
+    uint64_t clock;
+} ttf_instance_cache;
+
+ttf_status init_instance_cache(ttf_instance_cache *cache, ttf_source *source, ttf_error *error);
+void free_instance_cache(ttf_instance_cache *cache);
+
+// The cache keeps the INSTANCE_CACHE_SIZE most recently used instances. Getting an
+// instance that is not cached may evict and free the least recently used one, so an
+// instance and its glyphs are only valid until a later get_instance call misses the
+// cache; callers juggling several instances must get them again before each use.
+ttf_status get_instance(ttf_instance_cache *cache, const float *user_coords, ttf_instance **instance, ttf_error *error);
+ttf_status get_normalized_instance(ttf_instance_cache *cache, const int16_t *coords, ttf_instance **instance, ttf_error *error);
+// glyph is NULL when the index has no outline to vary (empty or composite)
+ttf_status get_instance_glyph(ttf_instance_cache *cache, ttf_instance *instance, uint16_t index, glyph_t **glyph, ttf_error *error);
+ttf_status preload_instance(ttf_instance_cache *cache, ttf_instance *instance, thread_pool *pool, ttf_error *error);
+
+// NULL when the advance table cannot be allocated
+const uint16_t* get_instance_advances(ttf_instance_cache *cache, ttf_instance *instance);
+uint16_t get_instance_advance(ttf_instance_cache *cache, ttf_instance *instance, uint16_t index);
+float get_instance_metric_delta(ttf_instance_cache *cache, ttf_instance *instance, const char tag[4]);
+void get_instance_line_metrics(ttf_instance_cache *cache, ttf_instance *instance, line_metrics *metrics);
+
+#endif
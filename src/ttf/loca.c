@@ -1,26 +1,34 @@
 #include "loca.h"
 
 
-void load_as_short(ttf_source *source, head_table* head, uint16_t index, uint32_t* glyph_offset, uint32_t* glyph_length) {
+ttf_status load_glyph_location(ttf_source *source, head_table* head, uint16_t index, uint32_t* glyph_offset, uint32_t* glyph_length, ttf_error *error) {
     ttf_table_record loca_record = {0};
-    try_load_table_record(source, &loca_record, LOCA_TAG);
-    
-    uint16_t *table = (uint16_t*)((uint8_t*)source->data + ntohl(loca_record.offset));
-    uint16_t start = ntohs(table[index]);
-    uint16_t end = ntohs(table[index + 1]);
-    
-    *glyph_offset = start * 2;
-    *glyph_length = (end - start) * 2;
-}
+    ttf_status status = load_table_record(source, &loca_record, LOCA_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    uint8_t *table = (uint8_t*)source->data + ntohl(loca_record.offset);
+    uint32_t entry_size = is_short_format(head) ? 2 : 4;
+    if ((uint32_t)index + 1 >= ntohl(loca_record.length) / entry_size) {
+        return ttf_fail(error, TTF_ERR_RANGE, "glyph %u has no loca entry", index);
+    }
+
+    uint32_t start, end;
+    if (entry_size == 2) {
+        start = ntohs(((uint16_t*)table)[index]) * 2u;
+        end = ntohs(((uint16_t*)table)[index + 1]) * 2u;
+    } else {
+        start = ntohl(((uint32_t*)table)[index]);
+        end = ntohl(((uint32_t*)table)[index + 1]);
+    }
+
+    // validate_ttf_source already walked every entry of a trusted source
+    if (!source->trusted && end < start) {
+        return ttf_fail(error, TTF_ERR_MALFORMED, "loca entry %u is not monotonic", index);
+    }
 
-void load_as_long(ttf_source *source, head_table* head, uint16_t index, uint32_t* glyph_offset, uint32_t* glyph_length) {
-    ttf_table_record loca_record = {0};
-    try_load_table_record(source, &loca_record, LOCA_TAG);
-    
-    uint32_t *table = (uint32_t*)((uint8_t*)source->data + ntohl(loca_record.offset));
-    uint32_t start = ntohl(table[index]);
-    uint32_t end = ntohl(table[index + 1]);
-    
     *glyph_offset = start;
     *glyph_length = end - start;
+    return TTF_OK;
 }
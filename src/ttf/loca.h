@@ -9,7 +9,6 @@
 
 #define LOCA_TAG "loca"
 
-void load_as_short(ttf_source *source, head_table* head, uint16_t index, uint32_t* glyph_offset, uint32_t* glyph_length);
-void load_as_long(ttf_source *source, head_table* head, uint16_t index, uint32_t* glyph_offset, uint32_t* glyph_length);
+ttf_status load_glyph_location(ttf_source *source, head_table* head, uint16_t index, uint32_t* glyph_offset, uint32_t* glyph_length, ttf_error *error);
 
 #endif
@@ -0,0 +1,17 @@
+#include "maxp.h"
+
+ttf_status load_maxp_table(ttf_source *source, maxp_table **maxp, ttf_error *error) {
+
+    ttf_table_record maxp_record = {0};
+    ttf_status status = load_table_record(source, &maxp_record, MAXP_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    *maxp = (maxp_table *)((uint8_t*)source->data + ntohl(maxp_record.offset));
+    return TTF_OK;
+}
+
+uint16_t get_num_glyphs(maxp_table *maxp) {
+    return ntohs(maxp->numGlyphs);
+}
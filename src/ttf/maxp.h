@@ -0,0 +1,37 @@
+#ifndef MAXP
+#define MAXP
+
+#include <stdint.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+
+#define MAXP_TAG "maxp"
+
+#pragma pack(1)
+
+typedef struct maxp_table {
+    fixed_t version;
+    uint16_t numGlyphs;
+    uint16_t maxPoints;
+    uint16_t maxContours;
+    uint16_t maxCompositePoints;
+    uint16_t maxCompositeContours;
+    uint16_t maxZones;
+    uint16_t maxTwilightPoints;
+    uint16_t maxStorage;
+    uint16_t maxFunctionDefs;
+    uint16_t maxInstructionDefs;
+    uint16_t maxStackElements;
+    uint16_t maxSizeOfInstructions;
+    uint16_t maxComponentElements;
+    uint16_t maxComponentDepth;
+} maxp_table;
+
+#pragma pack()
+
+ttf_status load_maxp_table(ttf_source *source, maxp_table **maxp, ttf_error *error);
+uint16_t get_num_glyphs(maxp_table *maxp);
+
+#endif
@@ -0,0 +1,115 @@
+#include <string.h>
+#include <stdbool.h>
+
+#include "name.h"
+
+static int name_record_rank(name_record *rec) {
+    uint16_t platform = ntohs(rec->platformID);
+    uint16_t language = ntohs(rec->languageID);
+
+    if (platform == PLATFORM_WINDOWS) {
+        return language == WINDOWS_LANGUAGE_EN_US ? 0 : 1;
+    }
+    if (platform == PLATFORM_UNICODE) {
+        return 2;
+    }
+    if (platform == PLATFORM_MACINTOSH && ntohs(rec->encodingID) == 0) {
+        return 3;
+    }
+    return -1;
+}
+
+static size_t put_utf8(char *out, size_t pos, size_t size, uint32_t cp) {
+    char buf[4];
+    size_t n;
+
+    if (cp < 0x80) {
+        buf[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+
+    if (pos + n >= size) {
+        return pos;
+    }
+    memcpy(out + pos, buf, n);
+    return pos + n;
+}
+
+// Copies the best available record for name_id into out as UTF-8.
+// Works on raw table bytes so it can be fed from a mapping or a read buffer.
+int get_name_string(uint8_t *table, uint32_t length, uint16_t name_id, char *out, size_t size) {
+    if (length < sizeof(name_header) || size == 0) {
+        return -1;
+    }
+
+    name_header *header = (name_header*)table;
+    uint16_t count = ntohs(header->count);
+    uint16_t storage = ntohs(header->storageOffset);
+    name_record *records = (name_record*)(table + sizeof(name_header));
+
+    if (sizeof(name_header) + count * sizeof(name_record) > length) {
+        return -1;
+    }
+
+    name_record *best = NULL;
+    int best_rank = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        name_record *rec = &records[i];
+        int rank = name_record_rank(rec);
+        if (ntohs(rec->nameID) != name_id || rank < 0) {
+            continue;
+        }
+        if (!best || rank < best_rank) {
+            best = rec;
+            best_rank = rank;
+        }
+    }
+
+    if (!best) {
+        return -1;
+    }
+
+    uint32_t start = storage + ntohs(best->stringOffset);
+    uint32_t len = ntohs(best->length);
+    if (start + len > length) {
+        return -1;
+    }
+
+    uint8_t *str = table + start;
+    size_t pos = 0;
+    bool utf16 = ntohs(best->platformID) != PLATFORM_MACINTOSH;
+
+    if (utf16) {
+        for (uint32_t i = 0; i + 1 < len; i += 2) {
+            uint32_t cp = (str[i] << 8) | str[i + 1];
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 3 < len) {
+                uint32_t low = (str[i + 2] << 8) | str[i + 3];
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+            pos = put_utf8(out, pos, size, cp);
+        }
+    } else {
+        for (uint32_t i = 0; i < len && pos + 1 < size; i++) {
+            out[pos++] = str[i] < 0x80 ? (char)str[i] : '?';
+        }
+    }
+
+    out[pos] = '\0';
+    return 0;
+}
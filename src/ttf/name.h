@@ -0,0 +1,41 @@
+#ifndef NAME
+#define NAME
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arpa/inet.h>
+
+#define NAME_TAG "name"
+
+#define NAME_ID_FAMILY 1
+#define NAME_ID_SUBFAMILY 2
+#define NAME_ID_TYPOGRAPHIC_FAMILY 16
+#define NAME_ID_TYPOGRAPHIC_SUBFAMILY 17
+
+#define PLATFORM_UNICODE 0
+#define PLATFORM_MACINTOSH 1
+#define PLATFORM_WINDOWS 3
+#define WINDOWS_LANGUAGE_EN_US 0x0409
+
+#pragma pack(1)
+
+typedef struct name_header {
+    uint16_t version;
+    uint16_t count;
+    uint16_t storageOffset;
+} name_header;
+
+typedef struct name_record {
+    uint16_t platformID;
+    uint16_t encodingID;
+    uint16_t languageID;
+    uint16_t nameID;
+    uint16_t length;
+    uint16_t stringOffset;
+} name_record;
+
+#pragma pack()
+
+int get_name_string(uint8_t *table, uint32_t length, uint16_t name_id, char *out, size_t size);
+
+#endif
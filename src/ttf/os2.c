@@ -0,0 +1,12 @@
+#include "os2.h"
+
+int find_os2_table(ttf_source *source, os2_table **os2) {
+    ttf_table_record os2_record = {0};
+
+    if (find_table_record(source, &os2_record, OS2_TAG)) {
+        return -1;
+    }
+
+    *os2 = (os2_table *)((uint8_t*)source->data + ntohl(os2_record.offset));
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef OS2
+#define OS2
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+#include "ttf.h"
+
+#define OS2_TAG "OS/2"
+
+#define FS_SELECTION_ITALIC 0x0001
+#define FS_SELECTION_BOLD 0x0020
+
+#pragma pack(1)
+
+typedef struct os2_table {
+    uint16_t version;
+    int16_t xAvgCharWidth;
+    uint16_t usWeightClass;
+    uint16_t usWidthClass;
+    uint16_t fsType;
+    int16_t ySubscriptXSize;
+    int16_t ySubscriptYSize;
+    int16_t ySubscriptXOffset;
+    int16_t ySubscriptYOffset;
+    int16_t ySuperscriptXSize;
+    int16_t ySuperscriptYSize;
+    int16_t ySuperscriptXOffset;
+    int16_t ySuperscriptYOffset;
+    int16_t yStrikeoutSize;
+    int16_t yStrikeoutPosition;
+    int16_t sFamilyClass;
+    uint8_t panose[10];
+    uint32_t ulUnicodeRange1;
+    uint32_t ulUnicodeRange2;
+    uint32_t ulUnicodeRange3;
+    uint32_t ulUnicodeRange4;
+    char achVendID[4];
+    uint16_t fsSelection;
+    uint16_t usFirstCharIndex;
+    uint16_t usLastCharIndex;
+    int16_t sTypoAscender;
+    int16_t sTypoDescender;
+    int16_t sTypoLineGap;
+    uint16_t usWinAscent;
+    uint16_t usWinDescent;
+} os2_table;
+
+#pragma pack()
+
+int find_os2_table(ttf_source *source, os2_table **os2);
+
+#endif
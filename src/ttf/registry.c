@@ -0,0 +1,270 @@
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+
+#include "registry.h"
+#include "cmap.h"
+#include "loca.h"
+#include "validate.h"
+
+static uint8_t* read_table(int fd, ttf_table_record *records, uint16_t count, const char tag[4], uint32_t *length) {
+    for (uint16_t i = 0; i < count; i++) {
+        if (memcmp(records[i].tag, tag, 4) != 0) {
+            continue;
+        }
+
+        *length = ntohl(records[i].length);
+        uint8_t *table = malloc(*length);
+        if (!table) {
+            return NULL;
+        }
+        if (pread(fd, table, *length, ntohl(records[i].offset)) != (ssize_t)*length) {
+            free(table);
+            return NULL;
+        }
+        return table;
+    }
+    return NULL;
+}
+
+// Reads only the table directory and the name/OS/2 tables, the file is never mapped.
+int probe_font_file(const char *path, font_entry *entry) {
+    struct stat info;
+    ttf_header header;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) < 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header)) {
+        close(fd);
+        return -1;
+    }
+
+    uint16_t count = ntohs(header.numTables);
+    ttf_table_record *records = malloc(count * sizeof(ttf_table_record));
+    if (!records || pread(fd, records, count * sizeof(ttf_table_record), sizeof(header)) != (ssize_t)(count * sizeof(ttf_table_record))) {
+        free(records);
+        close(fd);
+        return -1;
+    }
+
+    entry->file_size = (size_t)info.st_size;
+    entry->mtime = info.st_mtime;
+    entry->weight = 400;
+    entry->italic = false;
+    entry->family[0] = '\0';
+    entry->style[0] = '\0';
+
+    uint32_t length = 0;
+    uint8_t *name = read_table(fd, records, count, NAME_TAG, &length);
+    if (name) {
+        if (get_name_string(name, length, NAME_ID_TYPOGRAPHIC_FAMILY, entry->family, REGISTRY_NAME_SIZE)) {
+            get_name_string(name, length, NAME_ID_FAMILY, entry->family, REGISTRY_NAME_SIZE);
+        }
+        if (get_name_string(name, length, NAME_ID_TYPOGRAPHIC_SUBFAMILY, entry->style, REGISTRY_NAME_SIZE)) {
+            get_name_string(name, length, NAME_ID_SUBFAMILY, entry->style, REGISTRY_NAME_SIZE);
+        }
+        free(name);
+    }
+
+    uint8_t *os2 = read_table(fd, records, count, OS2_TAG, &length);
+    if (os2 && length >= offsetof(os2_table, usFirstCharIndex)) {
+        os2_table *table = (os2_table*)os2;
+        entry->weight = ntohs(table->usWeightClass);
+        entry->italic = ntohs(table->fsSelection) & FS_SELECTION_ITALIC;
+    } else {
+        head_table *head = (head_table*)read_table(fd, records, count, HEAD_TAG, &length);
+        if (head && length >= sizeof(head_table)) {
+            uint16_t mac_style = ntohs(head->macStyle);
+            entry->weight = (mac_style & MAC_STYLE_BOLD) ? 700 : 400;
+            entry->italic = mac_style & MAC_STYLE_ITALIC;
+        }
+        free(head);
+    }
+    free(os2);
+
+    free(records);
+    close(fd);
+    return 0;
+}
+
+bool is_font_file(const char *name) {
+    const char *ext = strrchr(name, '.');
+    return ext && (strcasecmp(ext, ".ttf") == 0 || strcasecmp(ext, ".otf") == 0);
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const font_entry*)a)->path, ((const font_entry*)b)->path);
+}
+
+int registry_scan(font_registry *registry, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return -1;
+    }
+
+    if (registry->budget == 0) {
+        registry->budget = REGISTRY_DEFAULT_BUDGET;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (!is_font_file(ent->d_name)) {
+            continue;
+        }
+
+        size_t path_size = strlen(dir) + strlen(ent->d_name) + 2;
+        char *path = malloc(path_size);
+        if (!path) {
+            closedir(d);
+            return -1;
+        }
+        snprintf(path, path_size, "%s/%s", dir, ent->d_name);
+
+        font_entry entry = {0};
+        if (probe_font_file(path, &entry)) {
+            free(path);
+            continue;
+        }
+        entry.path = path;
+
+        if (registry->count == registry->capacity) {
+            size_t capacity = registry->capacity ? registry->capacity * 2 : 16;
+            font_entry *entries = realloc(registry->entries, capacity * sizeof(font_entry));
+            if (!entries) {
+                free(path);
+                closedir(d);
+                return -1;
+            }
+            registry->entries = entries;
+            registry->capacity = capacity;
+        }
+        registry->entries[registry->count++] = entry;
+    }
+    closedir(d);
+
+    qsort(registry->entries, registry->count, sizeof(font_entry), compare_entries);
+    return 0;
+}
+
+static void unmap_entry(font_registry *registry, font_entry *entry) {
+    if (!entry->mapped) {
+        return;
+    }
+    registry->mapped_bytes -= entry->source.size;
+    unload_ttf_source(&entry->source);
+    entry->mapped = false;
+    entry->cmap_subtable = NULL;
+    entry->head = NULL;
+}
+
+void free_registry(font_registry *registry) {
+    for (size_t i = 0; i < registry->count; i++) {
+        unmap_entry(registry, &registry->entries[i]);
+        free(registry->entries[i].path);
+    }
+    free(registry->entries);
+    memset(registry, 0, sizeof(font_registry));
+}
+
+// Exact weight wins, otherwise the closest one with the requested slant.
+font_entry* registry_find(font_registry *registry, const char *family, uint16_t weight, bool italic) {
+    font_entry *best = NULL;
+    int best_distance = 0;
+
+    for (size_t i = 0; i < registry->count; i++) {
+        font_entry *entry = &registry->entries[i];
+        if (strcasecmp(entry->family, family) != 0) {
+            continue;
+        }
+
+        int distance = abs((int)entry->weight - (int)weight) + (entry->italic != italic ? 10000 : 0);
+        if (!best || distance < best_distance) {
+            best = entry;
+            best_distance = distance;
+        }
+    }
+
+    return best;
+}
+
+static void evict_idle(font_registry *registry, font_entry *keep) {
+    while (registry->mapped_bytes > registry->budget) {
+        font_entry *victim = NULL;
+        for (size_t i = 0; i < registry->count; i++) {
+            font_entry *entry = &registry->entries[i];
+            if (!entry->mapped || entry->refs > 0 || entry == keep) {
+                continue;
+            }
+            if (!victim || entry->last_used < victim->last_used) {
+                victim = entry;
+            }
+        }
+        if (!victim) {
+            return;
+        }
+        unmap_entry(registry, victim);
+        registry->evictions++;
+    }
+}
+
+ttf_source* registry_acquire(font_registry *registry, font_entry *entry) {
+    if (entry->rejected) {
+        return NULL;
+    }
+
+    // the file may come from anywhere, validate before any decoder sees it
+    if (!entry->mapped) {
+        if (load_ttf_source(&entry->source, entry->path)) {
+            return NULL;
+        }
+        if (validate_ttf_source(&entry->source, NULL)) {
+            unload_ttf_source(&entry->source);
+            entry->rejected = true;
+            return NULL;
+        }
+        entry->mapped = true;
+        registry->mapped_bytes += entry->source.size;
+        evict_idle(registry, entry);
+    }
+
+    entry->refs++;
+    entry->last_used = ++registry->clock;
+    return &entry->source;
+}
+
+void registry_release(font_registry *registry, font_entry *entry) {
+    if (entry->refs > 0) {
+        entry->refs--;
+    }
+    evict_idle(registry, NULL);
+}
+
+uint16_t registry_glyph_index(font_registry *registry, font_entry *entry, uint32_t unicode) {
+    if (!registry_acquire(registry, entry)) {
+        return 0;
+    }
+
+    uint16_t index = 0;
+    if (entry->cmap_subtable || !load_cmap_subtable(&entry->source, &entry->cmap_subtable, NULL)) {
+        index = get_glyph_index_format4(entry->cmap_subtable, unicode);
+    }
+
+    registry_release(registry, entry);
+    return index;
+}
+
+int registry_glyph_location(font_registry *registry, font_entry *entry, uint16_t index, uint32_t *glyph_offset, uint32_t *glyph_length) {
+    if (!registry_acquire(registry, entry)) {
+        return -1;
+    }
+
+    int result = -1;
+    if (entry->head || !load_head_table(&entry->source, &entry->head, NULL)) {
+        result = load_glyph_location(&entry->source, entry->head, index, glyph_offset, glyph_length, NULL) ? -1 : 0;
+    }
+
+    registry_release(registry, entry);
+    return result;
+}
@@ -0,0 +1,63 @@
+#ifndef REGISTRY
+#define REGISTRY
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+#include "name.h"
+#include "os2.h"
+
+#define REGISTRY_NAME_SIZE 64
+#define REGISTRY_DEFAULT_BUDGET (64u * 1024u * 1024u)
+
+#define MAC_STYLE_BOLD 0x0001
+#define MAC_STYLE_ITALIC 0x0002
+
+typedef struct font_entry {
+    char *path;
+    char family[REGISTRY_NAME_SIZE];
+    char style[REGISTRY_NAME_SIZE];
+    uint16_t weight;
+    bool italic;
+    size_t file_size;
+    time_t mtime;
+
+    ttf_source source;
+    bool mapped;
+    bool rejected;
+    uint32_t refs;
+    uint64_t last_used;
+
+    // resolved on first use after mapping
+    uint8_t *cmap_subtable;
+    head_table *head;
+} font_entry;
+
+typedef struct font_registry {
+    font_entry *entries;
+    size_t count;
+    size_t capacity;
+    size_t mapped_bytes;
+    size_t budget;
+    uint64_t clock;
+    uint64_t evictions;
+} font_registry;
+
+int probe_font_file(const char *path, font_entry *entry);
+bool is_font_file(const char *name);
+
+int registry_scan(font_registry *registry, const char *dir);
+void free_registry(font_registry *registry);
+
+font_entry* registry_find(font_registry *registry, const char *family, uint16_t weight, bool italic);
+ttf_source* registry_acquire(font_registry *registry, font_entry *entry);
+void registry_release(font_registry *registry, font_entry *entry);
+uint16_t registry_glyph_index(font_registry *registry, font_entry *entry, uint32_t unicode);
+int registry_glyph_location(font_registry *registry, font_entry *entry, uint16_t index, uint32_t *glyph_offset, uint32_t *glyph_length);
+
+#endif
@@ -1,11 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
 #include "source.h"
 
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static int read_into_buffer(ttf_source *source, int fd, size_t size)
+{
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t capacity = (size + page - 1) / page * page;
+	void *buffer = NULL;
+	size_t done = 0;
+
+	if (capacity == 0 || posix_memalign(&buffer, page, capacity)) {
+		return -1;
+	}
+	while (done < size) {
+		ssize_t n = pread(fd, (uint8_t *) buffer + done, size - done, (off_t) done);
+		if (n <= 0) {
+			free(buffer);
+			return -1;
+		}
+		done += (size_t) n;
+	}
+
+	source->data = buffer;
+	source->buffered = true;
+	return 0;
+}
+
+static void advise_mapping(ttf_source *source, uint32_t advice)
+{
+	if (advice & TTF_ADVISE_WILLNEED) {
+		madvise(source->data, source->size, MADV_WILLNEED);
+	}
+	if (advice & TTF_ADVISE_RANDOM) {
+		madvise(source->data, source->size, MADV_RANDOM);
+	}
+#ifdef MADV_HUGEPAGE
+	if (advice & TTF_ADVISE_HUGEPAGE) {
+		madvise(source->data, source->size, MADV_HUGEPAGE);
+	}
+#endif
+}
+
 int load_ttf_source(ttf_source *source, const char *filename)
 {
+	return load_ttf_source_ex(source, filename, NULL, NULL);
+}
+
+// Maps the file as before unless options ask otherwise. A failed mmap
+// falls back to reading the file into a page aligned buffer.
+int load_ttf_source_ex(ttf_source *source, const char *filename, const ttf_load_options *options, ttf_load_stats *stats)
+{
+	ttf_load_options defaults = {0};
 	struct stat info;
 	int fd;
+	int flags = MAP_PRIVATE;
+	uint64_t start = now_ns();
+
+	if (!options) {
+		options = &defaults;
+	}
 	source->data = MAP_FAILED;
 	source->size   = 0;
+	source->header_offset = 0;
+	source->buffered = false;
+	source->trusted = false;
 	if ((fd = open(filename, O_RDONLY)) < 0) {
 		return -1;
 	}
@@ -13,9 +81,71 @@ int load_ttf_source(ttf_source *source, const char *filename)
 		close(fd);
 		return -1;
 	}
-	source->data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-	source->size   = (uint_fast32_t) info.st_size;
+	source->size   = (size_t) info.st_size;
+
+#ifdef MAP_POPULATE
+	if (options->populate) {
+		flags |= MAP_POPULATE;
+	}
+#endif
+
+	if (!options->read_into_buffer) {
+		source->data = mmap(NULL, source->size, PROT_READ, flags, fd, 0);
+	}
+	if (source->data == MAP_FAILED && read_into_buffer(source, fd, source->size)) {
+		close(fd);
+		source->data = MAP_FAILED;
+		return -1;
+	}
 	close(fd);
-	return source->data == MAP_FAILED ? -1 : 0;
+
+	if (!source->buffered) {
+		advise_mapping(source, options->advice);
+	}
+
+	if (stats) {
+		memset(stats, 0, sizeof(ttf_load_stats));
+		stats->load_ns = now_ns() - start;
+		if (options->measure_faults) {
+			touch_ttf_source(source, stats);
+		}
+	}
+	return 0;
+}
+
+void unload_ttf_source(ttf_source *source)
+{
+	if (source->data && source->data != MAP_FAILED) {
+		if (source->buffered) {
+			free(source->data);
+		} else {
+			munmap(source->data, source->size);
+		}
+	}
+	source->data = NULL;
+	source->size = 0;
+	source->header_offset = 0;
+	source->buffered = false;
+	source->trusted = false;
 }
 
+// Reads one byte per page and records how long that took and how many
+// faults it caused, which is the cost the first glyph decode would pay.
+void touch_ttf_source(ttf_source *source, ttf_load_stats *stats)
+{
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	volatile uint8_t sink = 0;
+	struct rusage before, after;
+
+	getrusage(RUSAGE_SELF, &before);
+	uint64_t start = now_ns();
+	for (size_t offset = 0; offset < source->size; offset += page) {
+		sink ^= ((volatile uint8_t *) source->data)[offset];
+	}
+	stats->first_touch_ns = now_ns() - start;
+	getrusage(RUSAGE_SELF, &after);
+
+	stats->minor_faults = after.ru_minflt - before.ru_minflt;
+	stats->major_faults = after.ru_majflt - before.ru_majflt;
+	(void) sink;
+}
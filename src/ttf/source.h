@@ -7,6 +7,11 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+#define TTF_ADVISE_WILLNEED 0x01
+#define TTF_ADVISE_RANDOM 0x02
+#define TTF_ADVISE_HUGEPAGE 0x04
 
 #pragma pack(1)
 
@@ -14,10 +19,30 @@
 typedef struct ttf_source {
     void *data;
     size_t size;
+    uint32_t header_offset;
+    bool buffered;
+    bool trusted;
 } ttf_source;
 
 #pragma pack()
 
+typedef struct ttf_load_options {
+    bool populate;
+    uint32_t advice;
+    bool read_into_buffer;
+    bool measure_faults;
+} ttf_load_options;
+
+typedef struct ttf_load_stats {
+    uint64_t load_ns;
+    uint64_t first_touch_ns;
+    long minor_faults;
+    long major_faults;
+} ttf_load_stats;
+
 int load_ttf_source(ttf_source *source, const char *filename);
+int load_ttf_source_ex(ttf_source *source, const char *filename, const ttf_load_options *options, ttf_load_stats *stats);
+void unload_ttf_source(ttf_source *source);
+void touch_ttf_source(ttf_source *source, ttf_load_stats *stats);
 
 #endif
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "status.h"
+
+const char* ttf_status_to_str(ttf_status status) {
+    switch (status) {
+    case TTF_OK:
+        return "OK";
+    case TTF_ERR_IO:
+        return "IO";
+    case TTF_ERR_MISSING_TABLE:
+        return "MISSING_TABLE";
+    case TTF_ERR_MALFORMED:
+        return "MALFORMED";
+    case TTF_ERR_UNSUPPORTED:
+        return "UNSUPPORTED";
+    case TTF_ERR_EMPTY_GLYPH:
+        return "EMPTY_GLYPH";
+    case TTF_ERR_RANGE:
+        return "RANGE";
+    case TTF_ERR_NO_MEMORY:
+        return "NO_MEMORY";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+// Fills error when the caller asked for one and hands the status back,
+// so failure paths read `return ttf_fail(error, ..., "...")`.
+ttf_status ttf_fail(ttf_error *error, ttf_status status, const char *format, ...) {
+    if (error) {
+        va_list args;
+        va_start(args, format);
+        error->status = status;
+        vsnprintf(error->message, sizeof(error->message), format, args);
+        va_end(args);
+    }
+    return status;
+}
@@ -0,0 +1,27 @@
+#ifndef STATUS
+#define STATUS
+
+#include <stddef.h>
+
+#define TTF_ERROR_MESSAGE_SIZE 128
+
+typedef enum ttf_status {
+    TTF_OK = 0,
+    TTF_ERR_IO,
+    TTF_ERR_MISSING_TABLE,
+    TTF_ERR_MALFORMED,
+    TTF_ERR_UNSUPPORTED,
+    TTF_ERR_EMPTY_GLYPH,
+    TTF_ERR_RANGE,
+    TTF_ERR_NO_MEMORY
+} ttf_status;
+
+typedef struct ttf_error {
+    ttf_status status;
+    char message[TTF_ERROR_MESSAGE_SIZE];
+} ttf_error;
+
+const char* ttf_status_to_str(ttf_status status);
+ttf_status ttf_fail(ttf_error *error, ttf_status status, const char *format, ...);
+
+#endif
@@ -0,0 +1,527 @@
+#include "subset.h"
+#include "cmap.h"
+#include "maxp.h"
+#include "name.h"
+#include "os2.h"
+#include "hint.h"
+
+#define NO_GLYPH 0xFFFF
+
+typedef struct subset_table {
+    char tag[4];
+    uint8_t *data;
+    uint32_t length;
+} subset_table;
+
+typedef struct subset_builder {
+    ttf_font *font;
+    const uint8_t *glyf;
+    // new id to old id and back, dropped glyphs map to NO_GLYPH
+    uint16_t *old_ids;
+    uint16_t *new_ids;
+    uint16_t glyph_count;
+    uint32_t *codepoints;
+    uint16_t *codepoint_glyphs;
+    uint32_t codepoint_count;
+    subset_table tables[SUBSET_MAX_TABLES];
+    uint32_t table_count;
+} subset_builder;
+
+typedef struct cmap_segment {
+    uint16_t start;
+    uint16_t end;
+    uint16_t delta;
+    int32_t array_index;
+} cmap_segment;
+
+static uint16_t read_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static void write_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static void write_u32(uint8_t *p, uint32_t value) {
+    write_u16(p, (uint16_t)(value >> 16));
+    write_u16(p + 2, (uint16_t)value);
+}
+
+// big-endian words over the zero padded length
+static uint32_t table_checksum(const uint8_t *data, uint32_t length) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < length; i += 4) {
+        sum += (uint32_t)data[i] << 24 | (uint32_t)data[i + 1] << 16 | (uint32_t)data[i + 2] << 8 | data[i + 3];
+    }
+    return sum;
+}
+
+static uint32_t floor_log2(uint32_t value) {
+    uint32_t log = 0;
+    while (value >>= 1) {
+        log++;
+    }
+    return log;
+}
+
+static uint8_t* add_table(subset_builder *builder, const char tag[4], uint32_t length) {
+    subset_table *table = &builder->tables[builder->table_count];
+    table->data = calloc(1, length ? length : 1);
+    if (!table->data) {
+        return NULL;
+    }
+    memcpy(table->tag, tag, 4);
+    table->length = length;
+    builder->table_count++;
+    return table->data;
+}
+
+static const uint8_t* glyph_data(const subset_builder *builder, uint16_t old, uint32_t *length) {
+    *length = builder->font->locations[old + 1] - builder->font->locations[old];
+    return builder->glyf + builder->font->locations[old];
+}
+
+static bool is_composite(const uint8_t *glyph, uint32_t length) {
+    return length >= sizeof(glyph_header) && (int16_t)read_u16(glyph) < 0;
+}
+
+// offset of the component record after the one at offset, 0 once the last is passed;
+// load_font validated that every record lies inside the glyph
+static uint32_t next_component(const uint8_t *glyph, uint32_t length, uint32_t offset) {
+    uint16_t flags = read_u16(glyph + offset);
+    uint32_t size = 4 + ((flags & ARG_1_AND_2_ARE_WORDS) ? 4 : 2);
+    if (flags & WE_HAVE_A_SCALE) {
+        size += 2;
+    } else if (flags & WE_HAVE_AN_X_AND_Y_SCALE) {
+        size += 4;
+    } else if (flags & WE_HAVE_A_TWO_BY_TWO) {
+        size += 8;
+    }
+    offset += size;
+    return (flags & MORE_COMPONENTS) && offset + 4 <= length ? offset : 0;
+}
+
+// .notdef and the mapped glyphs seed a walk that pulls in components, then
+// kept glyphs are numbered in their original order
+static ttf_status collect_glyphs(subset_builder *builder, const uint32_t *codepoints, uint32_t count, ttf_error *error) {
+    ttf_font *font = builder->font;
+    builder->new_ids = malloc(font->glyph_count * sizeof(uint16_t));
+    builder->old_ids = malloc(font->glyph_count * sizeof(uint16_t));
+    builder->codepoints = malloc((count + 1) * sizeof(uint32_t));
+    builder->codepoint_glyphs = malloc((count + 1) * sizeof(uint16_t));
+    uint16_t *stack = malloc(font->glyph_count * sizeof(uint16_t));
+    if (!builder->new_ids || !builder->old_ids || !builder->codepoints || !builder->codepoint_glyphs || !stack) {
+        free(stack);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory collecting subset glyphs");
+    }
+    memset(builder->new_ids, 0xFF, font->glyph_count * sizeof(uint16_t));
+
+    // format 4 stops at the BMP and reserves U+FFFF for its closing segment
+    uint8_t *seen = calloc(CMAP_COVERAGE_BYTES, 1);
+    if (!seen) {
+        free(stack);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory collecting subset glyphs");
+    }
+    uint32_t top = 0;
+    stack[top++] = 0;
+    builder->new_ids[0] = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t codepoint = codepoints[i];
+        if (codepoint >= 0xFFFF || (seen[codepoint >> 3] & (1 << (codepoint & 7)))) {
+            continue;
+        }
+        seen[codepoint >> 3] |= (uint8_t)(1 << (codepoint & 7));
+        uint16_t glyph = font_glyph_index(font, codepoint);
+        if (glyph == 0 || glyph >= font->glyph_count) {
+            continue;
+        }
+        if (builder->new_ids[glyph] == NO_GLYPH) {
+            builder->new_ids[glyph] = 0;
+            stack[top++] = glyph;
+        }
+    }
+
+    while (top > 0) {
+        uint16_t glyph = stack[--top];
+        uint32_t length;
+        const uint8_t *data = glyph_data(builder, glyph, &length);
+        if (!is_composite(data, length)) {
+            continue;
+        }
+        for (uint32_t offset = sizeof(glyph_header); offset; offset = next_component(data, length, offset)) {
+            uint16_t component = read_u16(data + offset + 2);
+            if (component < font->glyph_count && builder->new_ids[component] == NO_GLYPH) {
+                builder->new_ids[component] = 0;
+                stack[top++] = component;
+            }
+        }
+    }
+    free(stack);
+
+    for (uint32_t old = 0; old < font->glyph_count; old++) {
+        if (builder->new_ids[old] != NO_GLYPH) {
+            builder->new_ids[old] = builder->glyph_count;
+            builder->old_ids[builder->glyph_count++] = (uint16_t)old;
+        }
+    }
+
+    // walking the coverage bitmap leaves the codepoints sorted
+    for (uint32_t codepoint = 0; codepoint < 0xFFFF; codepoint++) {
+        if (seen[codepoint >> 3] & (1 << (codepoint & 7))) {
+            uint16_t glyph = font_glyph_index(font, codepoint);
+            if (glyph != 0 && glyph < font->glyph_count) {
+                builder->codepoints[builder->codepoint_count] = codepoint;
+                builder->codepoint_glyphs[builder->codepoint_count++] = builder->new_ids[glyph];
+            }
+        }
+    }
+    free(seen);
+    return TTF_OK;
+}
+
+// glyphs are copied whole and 4-byte aligned, composites get their component ids renumbered
+static ttf_status build_glyf_loca(subset_builder *builder, bool *short_format, ttf_error *error) {
+    uint32_t *offsets = malloc((builder->glyph_count + 1) * sizeof(uint32_t));
+    if (!offsets) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building glyf");
+    }
+    offsets[0] = 0;
+    for (uint16_t i = 0; i < builder->glyph_count; i++) {
+        uint32_t length;
+        glyph_data(builder, builder->old_ids[i], &length);
+        offsets[i + 1] = offsets[i] + ((length + 3) & ~3u);
+    }
+
+    uint8_t *glyf = add_table(builder, FLYPH_TAG, offsets[builder->glyph_count]);
+    if (!glyf) {
+        free(offsets);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building glyf");
+    }
+    for (uint16_t i = 0; i < builder->glyph_count; i++) {
+        uint32_t length;
+        const uint8_t *data = glyph_data(builder, builder->old_ids[i], &length);
+        uint8_t *copy = glyf + offsets[i];
+        memcpy(copy, data, length);
+        if (!is_composite(copy, length)) {
+            continue;
+        }
+        for (uint32_t offset = sizeof(glyph_header); offset; offset = next_component(copy, length, offset)) {
+            uint16_t component = read_u16(copy + offset + 2);
+            write_u16(copy + offset + 2, component < builder->font->glyph_count ? builder->new_ids[component] : 0);
+        }
+    }
+
+    // short offsets count words, so they reach 128 KiB of glyph data
+    *short_format = offsets[builder->glyph_count] / 2 <= 0xFFFF;
+    uint32_t entry = *short_format ? 2 : 4;
+    uint8_t *loca = add_table(builder, LOCA_TAG, (builder->glyph_count + 1) * entry);
+    if (!loca) {
+        free(offsets);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building loca");
+    }
+    for (uint32_t i = 0; i <= builder->glyph_count; i++) {
+        if (*short_format) {
+            write_u16(loca + i * 2, (uint16_t)(offsets[i] / 2));
+        } else {
+            write_u32(loca + i * 4, offsets[i]);
+        }
+    }
+    free(offsets);
+    return TTF_OK;
+}
+
+// runs of consecutive codepoints become segments, through idDelta when their
+// glyphs are consecutive too and through glyphIdArray otherwise
+static ttf_status build_cmap(subset_builder *builder, ttf_error *error) {
+    cmap_segment *segments = malloc((builder->codepoint_count + 1) * sizeof(cmap_segment));
+    if (!segments) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building cmap");
+    }
+    uint32_t segment_count = 0, array_count = 0;
+    for (uint32_t i = 0; i < builder->codepoint_count;) {
+        uint32_t j = i;
+        bool consecutive = true;
+        while (j + 1 < builder->codepoint_count && builder->codepoints[j + 1] == builder->codepoints[j] + 1) {
+            consecutive &= builder->codepoint_glyphs[j + 1] == builder->codepoint_glyphs[j] + 1;
+            j++;
+        }
+        cmap_segment *segment = &segments[segment_count++];
+        segment->start = (uint16_t)builder->codepoints[i];
+        segment->end = (uint16_t)builder->codepoints[j];
+        segment->delta = consecutive ? (uint16_t)(builder->codepoint_glyphs[i] - builder->codepoints[i]) : 0;
+        segment->array_index = consecutive ? -1 : (int32_t)array_count;
+        if (!consecutive) {
+            array_count += j - i + 1;
+        }
+        i = j + 1;
+    }
+    segments[segment_count++] = (cmap_segment){ 0xFFFF, 0xFFFF, 1, -1 };
+
+    uint32_t length = 16 + 8 * segment_count + 2 * array_count;
+    if (length > 0xFFFF) {
+        free(segments);
+        return ttf_fail(error, TTF_ERR_RANGE, "%u codepoints do not fit a format 4 cmap", builder->codepoint_count);
+    }
+
+    // one subtable shared by the Unicode BMP and Windows BMP encodings
+    uint8_t *cmap = add_table(builder, CMAP_TAG, 20 + length);
+    if (!cmap) {
+        free(segments);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building cmap");
+    }
+    write_u16(cmap + 2, 2);
+    write_u16(cmap + 4, 0);
+    write_u16(cmap + 6, 3);
+    write_u32(cmap + 8, 20);
+    write_u16(cmap + 12, 3);
+    write_u16(cmap + 14, 1);
+    write_u32(cmap + 16, 20);
+
+    uint8_t *table = cmap + 20;
+    uint32_t search_range = 2u << floor_log2(segment_count);
+    write_u16(table, 4);
+    write_u16(table + 2, (uint16_t)length);
+    write_u16(table + 6, (uint16_t)(segment_count * 2));
+    write_u16(table + 8, (uint16_t)search_range);
+    write_u16(table + 10, (uint16_t)floor_log2(segment_count));
+    write_u16(table + 12, (uint16_t)(segment_count * 2 - search_range));
+    uint8_t *ends = table + 14;
+    uint8_t *starts = ends + 2 * segment_count + 2;
+    uint8_t *deltas = starts + 2 * segment_count;
+    uint8_t *range_offsets = deltas + 2 * segment_count;
+    uint8_t *glyph_ids = range_offsets + 2 * segment_count;
+    uint32_t next = 0;
+    for (uint32_t s = 0; s < segment_count; s++) {
+        cmap_segment *segment = &segments[s];
+        write_u16(ends + 2 * s, segment->end);
+        write_u16(starts + 2 * s, segment->start);
+        write_u16(deltas + 2 * s, segment->delta);
+        if (segment->array_index < 0) {
+            continue;
+        }
+        // the offset counts bytes from this segment's own idRangeOffset slot
+        write_u16(range_offsets + 2 * s, (uint16_t)(2 * (segment_count - s + segment->array_index)));
+        for (uint32_t c = segment->start; c <= segment->end; c++) {
+            while (builder->codepoints[next] != c) {
+                next++;
+            }
+            write_u16(glyph_ids + 2 * (segment->array_index + c - segment->start), builder->codepoint_glyphs[next]);
+        }
+    }
+    free(segments);
+    return TTF_OK;
+}
+
+static ttf_status copy_table(subset_builder *builder, const char tag[4], uint8_t **copy, ttf_error *error) {
+    ttf_table_record record;
+    *copy = NULL;
+    if (find_table_record(&builder->font->source, &record, tag)) {
+        return TTF_OK;
+    }
+    uint32_t length = ntohl(record.length);
+    *copy = add_table(builder, tag, length);
+    if (!*copy) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory copying '%.4s'", tag);
+    }
+    memcpy(*copy, (uint8_t*)builder->font->source.data + ntohl(record.offset), length);
+    return TTF_OK;
+}
+
+// hmtx drops trailing advances equal to the last one kept, hhea and head get
+// their extremes recomputed over the kept glyphs
+static ttf_status build_metrics(subset_builder *builder, bool short_format, ttf_error *error) {
+    ttf_font *font = builder->font;
+    uint16_t count = builder->glyph_count;
+    uint16_t long_metrics = count;
+    while (long_metrics > 1 && font_advance_width(font, builder->old_ids[long_metrics - 1])
+                               == font_advance_width(font, builder->old_ids[long_metrics - 2])) {
+        long_metrics--;
+    }
+
+    uint8_t *hmtx = add_table(builder, HMTX_TAG, long_metrics * 4u + (count - long_metrics) * 2u);
+    if (!hmtx) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building hmtx");
+    }
+    uint16_t advance_max = 0;
+    int16_t min_lsb = INT16_MAX, min_rsb = INT16_MAX, max_extent = INT16_MIN;
+    int16_t x_min = INT16_MAX, y_min = INT16_MAX, x_max = INT16_MIN, y_max = INT16_MIN;
+    uint8_t *cursor = hmtx;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t old = builder->old_ids[i];
+        uint16_t advance = font_advance_width(font, old);
+        int16_t lsb = get_left_side_bearing(font->hhea, font->hmtx, old);
+        if (i < long_metrics) {
+            write_u16(cursor, advance);
+            cursor += 2;
+        }
+        write_u16(cursor, (uint16_t)lsb);
+        cursor += 2;
+
+        advance_max = advance > advance_max ? advance : advance_max;
+        uint32_t length;
+        const uint8_t *data = glyph_data(builder, old, &length);
+        if (length < sizeof(glyph_header) || read_u16(data) == 0) {
+            continue;
+        }
+        int16_t gx_min = (int16_t)read_u16(data + 2), gy_min = (int16_t)read_u16(data + 4);
+        int16_t gx_max = (int16_t)read_u16(data + 6), gy_max = (int16_t)read_u16(data + 8);
+        int32_t extent = lsb + (gx_max - gx_min);
+        min_lsb = lsb < min_lsb ? lsb : min_lsb;
+        min_rsb = advance - extent < min_rsb ? (int16_t)(advance - extent) : min_rsb;
+        max_extent = extent > max_extent ? (int16_t)extent : max_extent;
+        x_min = gx_min < x_min ? gx_min : x_min;
+        y_min = gy_min < y_min ? gy_min : y_min;
+        x_max = gx_max > x_max ? gx_max : x_max;
+        y_max = gy_max > y_max ? gy_max : y_max;
+    }
+    bool outlines = x_min <= x_max;
+
+    uint8_t *hhea, *head, *maxp;
+    ttf_status status;
+    if ((status = copy_table(builder, HHEA_TAG, &hhea, error))
+        || (status = copy_table(builder, HEAD_TAG, &head, error))
+        || (status = copy_table(builder, MAXP_TAG, &maxp, error))) {
+        return status;
+    }
+    if (!hhea || !head || !maxp) {
+        return ttf_fail(error, TTF_ERR_MISSING_TABLE, "subset needs hhea, head and maxp");
+    }
+    write_u16(hhea + offsetof(hhea_table, advanceWidthMax), advance_max);
+    write_u16(hhea + offsetof(hhea_table, minLeftSideBearing), (uint16_t)(outlines ? min_lsb : 0));
+    write_u16(hhea + offsetof(hhea_table, minRightSideBearing), (uint16_t)(outlines ? min_rsb : 0));
+    write_u16(hhea + offsetof(hhea_table, xMaxExtent), (uint16_t)(outlines ? max_extent : 0));
+    write_u16(hhea + offsetof(hhea_table, numberOfHMetrics), long_metrics);
+
+    write_u32(head + offsetof(head_table, checksumAdjustment), 0);
+    write_u16(head + offsetof(head_table, xMin), (uint16_t)(outlines ? x_min : 0));
+    write_u16(head + offsetof(head_table, yMin), (uint16_t)(outlines ? y_min : 0));
+    write_u16(head + offsetof(head_table, xMax), (uint16_t)(outlines ? x_max : 0));
+    write_u16(head + offsetof(head_table, yMax), (uint16_t)(outlines ? y_max : 0));
+    write_u16(head + offsetof(head_table, indexToLocFormat), short_format ? 0 : 1);
+
+    // the per-glyph maxima of the full font still bound the subset
+    write_u16(maxp + offsetof(maxp_table, numGlyphs), count);
+    return TTF_OK;
+}
+
+// post 3.0 carries no glyph names, so nothing in it depends on glyph ids
+static ttf_status build_post(subset_builder *builder, ttf_error *error) {
+    uint8_t *post = add_table(builder, SUBSET_POST_TAG, 32);
+    if (!post) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory building post");
+    }
+    ttf_table_record record;
+    if (!find_table_record(&builder->font->source, &record, SUBSET_POST_TAG) && ntohl(record.length) >= 16) {
+        memcpy(post + 4, (uint8_t*)builder->font->source.data + ntohl(record.offset) + 4, 12);
+    }
+    write_u32(post, 0x00030000);
+    return TTF_OK;
+}
+
+// the first and last character OS/2 advertises follow the new cmap
+static void patch_os2(subset_builder *builder) {
+    for (uint32_t i = 0; i < builder->table_count; i++) {
+        subset_table *table = &builder->tables[i];
+        if (memcmp(table->tag, OS2_TAG, 4) || table->length < offsetof(os2_table, usLastCharIndex) + 2
+            || builder->codepoint_count == 0) {
+            continue;
+        }
+        write_u16(table->data + offsetof(os2_table, usFirstCharIndex), (uint16_t)builder->codepoints[0]);
+        write_u16(table->data + offsetof(os2_table, usLastCharIndex), (uint16_t)builder->codepoints[builder->codepoint_count - 1]);
+    }
+}
+
+static int compare_tables(const void *a, const void *b) {
+    return memcmp(((const subset_table*)a)->tag, ((const subset_table*)b)->tag, 4);
+}
+
+// tables go out sorted by tag and 4-byte aligned behind the directory
+static ttf_status write_font(subset_builder *builder, ttf_subset *subset, ttf_error *error) {
+    qsort(builder->tables, builder->table_count, sizeof(subset_table), compare_tables);
+    uint32_t count = builder->table_count;
+    size_t size = sizeof(ttf_header) + count * sizeof(ttf_table_record);
+    for (uint32_t i = 0; i < count; i++) {
+        size += (builder->tables[i].length + 3) & ~3u;
+    }
+    uint8_t *data = calloc(1, size);
+    if (!data) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory writing subset");
+    }
+
+    uint32_t search_range = 16u << floor_log2(count);
+    write_u32(data, 0x00010000);
+    write_u16(data + 4, (uint16_t)count);
+    write_u16(data + 6, (uint16_t)search_range);
+    write_u16(data + 8, (uint16_t)floor_log2(count));
+    write_u16(data + 10, (uint16_t)(count * 16 - search_range));
+
+    uint32_t offset = sizeof(ttf_header) + count * sizeof(ttf_table_record);
+    uint8_t *head = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        subset_table *table = &builder->tables[i];
+        uint8_t *record = data + sizeof(ttf_header) + i * sizeof(ttf_table_record);
+        memcpy(data + offset, table->data, table->length);
+        memcpy(record, table->tag, 4);
+        write_u32(record + 4, table_checksum(data + offset, table->length));
+        write_u32(record + 8, offset);
+        write_u32(record + 12, table->length);
+        if (memcmp(table->tag, HEAD_TAG, 4) == 0) {
+            head = data + offset;
+        }
+        offset += (table->length + 3) & ~3u;
+    }
+    // head's own checksum was taken with the adjustment at 0, as the spec requires
+    write_u32(head + offsetof(head_table, checksumAdjustment), SUBSET_CHECKSUM_MAGIC - table_checksum(data, (uint32_t)size));
+
+    subset->data = data;
+    subset->size = size;
+    subset->glyph_count = builder->glyph_count;
+    subset->codepoint_count = builder->codepoint_count;
+    return TTF_OK;
+}
+
+ttf_status build_font_subset(ttf_font *font, const uint32_t *codepoints, uint32_t count, ttf_subset *subset, ttf_error *error) {
+    memset(subset, 0, sizeof(ttf_subset));
+    ttf_table_record glyf_record;
+    ttf_status status = load_table_record(&font->source, &glyf_record, FLYPH_TAG, error);
+    if (status) {
+        return status;
+    }
+
+    subset_builder builder = {0};
+    builder.font = font;
+    builder.glyf = (uint8_t*)font->source.data + ntohl(glyf_record.offset);
+
+    // tables that hold no glyph ids travel unchanged
+    static const char *copied[] = { OS2_TAG, NAME_TAG, CVT_TAG, FPGM_TAG, PREP_TAG, SUBSET_GASP_TAG };
+    bool short_format = false;
+    if (!(status = collect_glyphs(&builder, codepoints, count, error))
+        && !(status = build_glyf_loca(&builder, &short_format, error))
+        && !(status = build_cmap(&builder, error))
+        && !(status = build_metrics(&builder, short_format, error))
+        && !(status = build_post(&builder, error))) {
+        for (uint32_t i = 0; i < sizeof(copied) / sizeof(copied[0]) && !status; i++) {
+            uint8_t *copy;
+            status = copy_table(&builder, copied[i], &copy, error);
+        }
+    }
+    if (!status) {
+        patch_os2(&builder);
+        status = write_font(&builder, subset, error);
+    }
+
+    for (uint32_t i = 0; i < builder.table_count; i++) {
+        free(builder.tables[i].data);
+    }
+    free(builder.old_ids);
+    free(builder.new_ids);
+    free(builder.codepoints);
+    free(builder.codepoint_glyphs);
+    return status;
+}
+
+void free_font_subset(ttf_subset *subset) {
+    free(subset->data);
+    memset(subset, 0, sizeof(ttf_subset));
+}
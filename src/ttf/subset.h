@@ -0,0 +1,33 @@
+#ifndef SUBSET
+#define SUBSET
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "font.h"
+
+// the whole font sums to this once head.checksumAdjustment is set
+#define SUBSET_CHECKSUM_MAGIC 0xB1B0AFBA
+#define SUBSET_MAX_TABLES 16
+
+#define SUBSET_POST_TAG "post"
+#define SUBSET_GASP_TAG "gasp"
+
+// A standalone TTF in memory. Glyphs keep their relative order with .notdef
+// first, so new ids only close the gaps left by dropped glyphs.
+typedef struct ttf_subset {
+    uint8_t *data;
+    size_t size;
+    uint16_t glyph_count;
+    uint32_t codepoint_count;
+} ttf_subset;
+
+// Keeps the glyphs the codepoints map to plus every component they pull in and
+// rebuilds cmap (format 4), loca, glyf, hmtx, hhea, maxp, head and post around
+// them; OS/2, name and the hinting tables are copied. Tables indexed by glyph id
+// that are not rebuilt, layout and variations among them, are left out.
+ttf_status build_font_subset(ttf_font *font, const uint32_t *codepoints, uint32_t count, ttf_subset *subset, ttf_error *error);
+void free_font_subset(ttf_subset *subset);
+
+#endif
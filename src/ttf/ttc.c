@@ -0,0 +1,218 @@
+#include <string.h>
+
+#include "ttc.h"
+#include "maxp.h"
+#include "loca.h"
+#include "validate.h"
+
+static bool is_ttc(ttf_source *source) {
+    return source->size >= 4 && memcmp(source->data, TTC_TAG, 4) == 0;
+}
+
+// NULL for a plain sfnt, and for a collection whose offset table runs past the file
+static ttc_header* find_ttc_header(ttf_source *source) {
+    if (!is_ttc(source) || source->size < sizeof(ttc_header)) {
+        return NULL;
+    }
+    ttc_header *header = (ttc_header*)source->data;
+    if (sizeof(ttc_header) + 4 * (uint64_t)ntohl(header->numFonts) > source->size) {
+        return NULL;
+    }
+    return header;
+}
+
+// a plain sfnt counts as a collection of one, a truncated collection has none
+uint32_t get_face_count(ttf_source *source) {
+    if (!is_ttc(source)) {
+        return 1;
+    }
+    ttc_header *header = find_ttc_header(source);
+    return header ? ntohl(header->numFonts) : 0;
+}
+
+int select_ttf_face(ttf_source *source, uint32_t face_index) {
+    source->trusted = false;
+    if (!is_ttc(source)) {
+        source->header_offset = 0;
+        return face_index == 0 ? 0 : -1;
+    }
+    ttc_header *header = find_ttc_header(source);
+    if (!header || face_index >= ntohl(header->numFonts)) {
+        return -1;
+    }
+
+    uint32_t *offsets = (uint32_t*)((uint8_t*)header + sizeof(ttc_header));
+    uint32_t offset = ntohl(offsets[face_index]);
+    if (offset + sizeof(ttf_header) > source->size) {
+        return -1;
+    }
+
+    source->header_offset = offset;
+    return 0;
+}
+
+static void free_store(ttc_glyph_store *store) {
+    for (uint16_t g = 0; g < store->glyph_count; g++) {
+        free_glyph(store->outlines[g]);
+    }
+    free(store->outlines);
+    free(store->locations);
+    free(store);
+}
+
+// a face without glyf/loca gets no store
+static ttf_status find_or_create_store(ttc_collection *collection, ttf_source *face, ttc_glyph_store **result, ttf_error *error) {
+    *result = NULL;
+    ttf_table_record loca_record = {0};
+    ttf_table_record glyf_record = {0};
+    if (find_table_record(face, &loca_record, LOCA_TAG) || find_table_record(face, &glyf_record, FLYPH_TAG)) {
+        return TTF_OK;
+    }
+
+    uint32_t loca_offset = ntohl(loca_record.offset);
+    uint32_t glyf_offset = ntohl(glyf_record.offset);
+    for (uint32_t i = 0; i < collection->store_count; i++) {
+        ttc_glyph_store *store = collection->stores[i];
+        if (store->loca_offset == loca_offset && store->glyf_offset == glyf_offset) {
+            *result = store;
+            return TTF_OK;
+        }
+    }
+
+    head_table *head = NULL;
+    maxp_table *maxp = NULL;
+    ttf_status status;
+    if ((status = load_head_table(face, &head, error)) || (status = load_maxp_table(face, &maxp, error))) {
+        return status;
+    }
+
+    ttc_glyph_store **stores = realloc(collection->stores, (collection->store_count + 1) * sizeof(ttc_glyph_store*));
+    if (!stores) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory indexing a collection");
+    }
+    collection->stores = stores;
+
+    ttc_glyph_store *store = calloc(1, sizeof(ttc_glyph_store));
+    if (!store) {
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory indexing a collection");
+    }
+    store->loca_offset = loca_offset;
+    store->glyf_offset = glyf_offset;
+    store->glyph_count = get_num_glyphs(maxp);
+    store->locations = calloc(store->glyph_count + 1, sizeof(uint32_t));
+    store->outlines = calloc(store->glyph_count, sizeof(glyph_t*));
+    if (!store->locations || !store->outlines) {
+        store->glyph_count = 0;
+        free_store(store);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory indexing a collection");
+    }
+
+    for (uint16_t i = 0; i < store->glyph_count; i++) {
+        uint32_t glyph_offset, glyph_length;
+        if (load_glyph_location(face, head, i, &glyph_offset, &glyph_length, NULL)) {
+            glyph_offset = store->locations[i];
+            glyph_length = 0;
+        }
+        store->locations[i] = glyph_offset;
+        store->locations[i + 1] = glyph_offset + glyph_length;
+    }
+
+    collection->stores[collection->store_count++] = store;
+    *result = store;
+    return TTF_OK;
+}
+
+ttf_status load_ttc_collection(ttc_collection *collection, const char *filename, ttf_error *error) {
+    memset(collection, 0, sizeof(ttc_collection));
+
+    if (load_ttf_source(&collection->file, filename)) {
+        return ttf_fail(error, TTF_ERR_IO, "cannot load '%s'", filename);
+    }
+
+    // the offset table is known to fit in the file, which bounds the face count
+    uint32_t face_count = get_face_count(&collection->file);
+    if (face_count == 0) {
+        free_ttc_collection(collection);
+        return ttf_fail(error, TTF_ERR_MALFORMED, "'%s' is a truncated collection", filename);
+    }
+    collection->faces = calloc(face_count, sizeof(ttc_face));
+    if (!collection->faces) {
+        free_ttc_collection(collection);
+        return ttf_fail(error, TTF_ERR_NO_MEMORY, "out of memory loading '%s'", filename);
+    }
+    collection->face_count = face_count;
+
+    for (uint32_t i = 0; i < collection->face_count; i++) {
+        ttc_face *face = &collection->faces[i];
+        face->source = collection->file;
+        if (select_ttf_face(&face->source, i)) {
+            free_ttc_collection(collection);
+            return ttf_fail(error, TTF_ERR_MALFORMED, "face %u has no offset table", i);
+        }
+        ttf_validation validation = {0};
+        if (validate_ttf_source(&face->source, &validation)) {
+            free_ttc_collection(collection);
+            return ttf_fail(error, TTF_ERR_MALFORMED, "rejected face %u of '%s' : %s", i, filename, validation.reason);
+        }
+        ttf_status status = find_or_create_store(collection, &face->source, &face->store, error);
+        if (status) {
+            free_ttc_collection(collection);
+            return status;
+        }
+    }
+
+    return TTF_OK;
+}
+
+void free_ttc_collection(ttc_collection *collection) {
+    for (uint32_t i = 0; i < collection->store_count; i++) {
+        free_store(collection->stores[i]);
+    }
+    free(collection->stores);
+    free(collection->faces);
+
+    unload_ttf_source(&collection->file);
+    memset(collection, 0, sizeof(ttc_collection));
+}
+
+glyph_t* get_face_glyph(ttc_collection *collection, uint32_t face_index, uint16_t index) {
+    if (face_index >= collection->face_count) {
+        return NULL;
+    }
+
+    ttc_face *face = &collection->faces[face_index];
+    ttc_glyph_store *store = face->store;
+    if (!store || index >= store->glyph_count) {
+        return NULL;
+    }
+    if (store->outlines[index]) {
+        return store->outlines[index];
+    }
+
+    uint32_t glyph_offset = store->locations[index];
+    uint32_t glyph_length = store->locations[index + 1] - glyph_offset;
+    if (load_glyph(&face->source, glyph_offset, glyph_length, &store->outlines[index], NULL)) {
+        return NULL;
+    }
+    return store->outlines[index];
+}
+
+typedef struct preload_job {
+    ttc_collection *collection;
+    uint32_t face_index;
+} preload_job;
+
+static void preload_range(uint32_t begin, uint32_t end, void *arg) {
+    preload_job *job = arg;
+    for (uint32_t i = begin; i < end; i++) {
+        get_face_glyph(job->collection, job->face_index, (uint16_t)i);
+    }
+}
+
+void preload_face(ttc_collection *collection, uint32_t face_index, thread_pool *pool) {
+    if (face_index >= collection->face_count || !collection->faces[face_index].store) {
+        return;
+    }
+    preload_job job = { collection, face_index };
+    parallel_for(pool, 0, collection->faces[face_index].store->glyph_count, 0, preload_range, &job);
+}
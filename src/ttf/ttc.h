@@ -0,0 +1,57 @@
+#ifndef TTC
+#define TTC
+
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "source.h"
+#include "ttf.h"
+#include "head.h"
+#include "glyph.h"
+#include "pool.h"
+
+#define TTC_TAG "ttcf"
+
+#pragma pack(1)
+
+typedef struct ttc_header {
+    char ttcTag[4];
+    uint16_t majorVersion;
+    uint16_t minorVersion;
+    uint32_t numFonts;
+} ttc_header;
+
+#pragma pack()
+
+// Decoded loca and outline cache for one physical glyf/loca pair.
+// Faces of a collection pointing at the same tables share one store.
+typedef struct ttc_glyph_store {
+    uint32_t loca_offset;
+    uint32_t glyf_offset;
+    uint16_t glyph_count;
+    uint32_t *locations;
+    glyph_t **outlines;
+} ttc_glyph_store;
+
+typedef struct ttc_face {
+    ttf_source source;
+    ttc_glyph_store *store;
+} ttc_face;
+
+typedef struct ttc_collection {
+    ttf_source file;
+    ttc_face *faces;
+    uint32_t face_count;
+    ttc_glyph_store **stores;
+    uint32_t store_count;
+} ttc_collection;
+
+uint32_t get_face_count(ttf_source *source);
+int select_ttf_face(ttf_source *source, uint32_t face_index);
+
+ttf_status load_ttc_collection(ttc_collection *collection, const char *filename, ttf_error *error);
+void free_ttc_collection(ttc_collection *collection);
+glyph_t* get_face_glyph(ttc_collection *collection, uint32_t face_index, uint16_t index);
+void preload_face(ttc_collection *collection, uint32_t face_index, thread_pool *pool);
+
+#endif
@@ -1,15 +1,14 @@
 #include <string.h>
 
 #include "ttf.h"
-#include "logger.h"
 
 
 int find_table_record(ttf_source *source, ttf_table_record *record, const char name[4]) {
     (void) record;
-    ttf_header *header = (ttf_header*)source->data;
-    ttf_table_record *table_records = (ttf_table_record*)((char*)source->data + sizeof(ttf_header));
+    ttf_header *header = (ttf_header*)((char*)source->data + source->header_offset);
+    ttf_table_record *table_records = (ttf_table_record*)((char*)header + sizeof(ttf_header));
 
-    for (uint16_t i = 0; i < header->numTables; i++) {
+    for (uint16_t i = 0; i < ntohs(header->numTables); i++) {
         ttf_table_record *rec = &table_records[i];
     
         if (memcmp(rec->tag, name, 4) == 0) {
@@ -22,8 +21,9 @@ int find_table_record(ttf_source *source, ttf_table_record *record, const char n
 }
 
 
-void try_load_table_record(ttf_source *source, ttf_table_record *record, const char name[4]) {
-    if(find_table_record(source, record, name)) {
-        elog("record about table '%s' not fount int ttf header", name);
+ttf_status load_table_record(ttf_source *source, ttf_table_record *record, const char name[4], ttf_error *error) {
+    if (find_table_record(source, record, name)) {
+        return ttf_fail(error, TTF_ERR_MISSING_TABLE, "record about table '%.4s' not found in ttf header", name);
     }
+    return TTF_OK;
 }
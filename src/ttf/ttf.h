@@ -9,6 +9,7 @@
 #include <stdio.h>       
 #include <stdint.h>      
 #include "source.h"
+#include "status.h"
 
 #pragma pack(1)
 
@@ -30,6 +31,7 @@ typedef struct ttf_table_record {
 #pragma pack()
 
 int find_table_record(ttf_source *source, ttf_table_record *record, const char* name);
-void try_load_table_record(ttf_source *source, ttf_table_record *record, const char name[4]);
+ttf_status load_table_record(ttf_source *source, ttf_table_record *record, const char name[4], ttf_error *error);
+
 
 #endif
@@ -0,0 +1,358 @@
+#include <string.h>
+
+#include "validate.h"
+#include "cmap.h"
+#include "head.h"
+#include "maxp.h"
+#include "loca.h"
+#include "glyph.h"
+#include "hmtx.h"
+
+typedef struct table_span {
+    uint8_t *data;
+    uint32_t length;
+} table_span;
+
+#define REJECT(res, tag, msg) do { \
+    (res)->table = (tag); \
+    (res)->reason = (msg); \
+    return -1; \
+} while (0)
+
+static bool in_bounds(uint64_t size, uint64_t offset, uint64_t length) {
+    return offset <= size && length <= size - offset;
+}
+
+static int find_span(ttf_source *source, const char tag[4], table_span *span) {
+    ttf_table_record record = {0};
+    if (find_table_record(source, &record, tag)) {
+        return -1;
+    }
+    span->data = (uint8_t*)source->data + ntohl(record.offset);
+    span->length = ntohl(record.length);
+    return 0;
+}
+
+static int validate_directory(ttf_source *source, ttf_validation *res) {
+    if (!in_bounds(source->size, source->header_offset, sizeof(ttf_header))) {
+        REJECT(res, NULL, "offset table past end of file");
+    }
+
+    ttf_header *header = (ttf_header*)((uint8_t*)source->data + source->header_offset);
+    uint16_t count = ntohs(header->numTables);
+    uint64_t records_offset = (uint64_t)source->header_offset + sizeof(ttf_header);
+    if (!in_bounds(source->size, records_offset, (uint64_t)count * sizeof(ttf_table_record))) {
+        REJECT(res, NULL, "table directory past end of file");
+    }
+
+    ttf_table_record *records = (ttf_table_record*)((uint8_t*)source->data + records_offset);
+    for (uint16_t i = 0; i < count; i++) {
+        if (!in_bounds(source->size, ntohl(records[i].offset), ntohl(records[i].length))) {
+            REJECT(res, NULL, "table record past end of file");
+        }
+    }
+    return 0;
+}
+
+static int validate_cmap(ttf_source *source, ttf_validation *res) {
+    table_span cmap;
+    if (find_span(source, CMAP_TAG, &cmap)) {
+        REJECT(res, CMAP_TAG, "missing table");
+    }
+    if (cmap.length < sizeof(cmap_header)) {
+        REJECT(res, CMAP_TAG, "truncated header");
+    }
+
+    cmap_header *header = (cmap_header*)cmap.data;
+    uint16_t count = ntohs(header->numTables);
+    if (count == 0 || !in_bounds(cmap.length, sizeof(cmap_header), count * sizeof(cmap_encoding_record))) {
+        REJECT(res, CMAP_TAG, "bad encoding record count");
+    }
+
+    // get_glyph_index only ever reads the first subtable
+    cmap_encoding_record *record = (cmap_encoding_record*)(cmap.data + sizeof(cmap_header));
+    uint32_t offset = ntohl(record->subtableOffset);
+    if (!in_bounds(cmap.length, offset, 14)) {
+        REJECT(res, CMAP_TAG, "subtable past end of table");
+    }
+
+    uint8_t *p = cmap.data + offset;
+    uint16_t format = ntohs(*(uint16_t*)p);
+    uint16_t length = ntohs(*(uint16_t*)(p + 2));
+    uint16_t segCountX2 = ntohs(*(uint16_t*)(p + 6));
+    uint16_t segCount = segCountX2 / 2;
+
+    if (format != 4) {
+        REJECT(res, CMAP_TAG, "first subtable is not format 4");
+    }
+    if (!in_bounds(cmap.length, offset, length)) {
+        REJECT(res, CMAP_TAG, "subtable length past end of table");
+    }
+    if (segCount == 0 || segCountX2 & 1 || 16u + segCount * 8u > length) {
+        REJECT(res, CMAP_TAG, "bad segment count");
+    }
+
+    uint16_t *endCode = (uint16_t*)(p + 14);
+    uint16_t *startCode = endCode + segCount + 1;
+    uint16_t *idRangeOffset = startCode + segCount * 2;
+    uint8_t *subtable_end = p + length;
+
+    uint16_t previous_end = 0;
+    for (uint16_t i = 0; i < segCount; i++) {
+        uint16_t start = ntohs(startCode[i]);
+        uint16_t end = ntohs(endCode[i]);
+        uint16_t range = ntohs(idRangeOffset[i]);
+
+        if (start > end || (i > 0 && start <= previous_end)) {
+            REJECT(res, CMAP_TAG, "segments out of order");
+        }
+        if (range != 0) {
+            uint8_t *last = (uint8_t*)&idRangeOffset[i] + range + 2 * (end - start);
+            if (range & 1 || last + 2 > subtable_end) {
+                REJECT(res, CMAP_TAG, "glyph id array past end of subtable");
+            }
+        }
+        previous_end = end;
+    }
+    return 0;
+}
+
+static int validate_simple_glyph(uint8_t *p, uint32_t length, int16_t contours, uint16_t max_points, ttf_validation *res) {
+    uint8_t *end = p + length;
+    uint16_t *endPts = (uint16_t*)(p + sizeof(glyph_header));
+    uint8_t *ptr = (uint8_t*)(endPts + contours);
+
+    if (ptr + 2 > end) {
+        REJECT(res, FLYPH_TAG, "contour end points past end of glyph");
+    }
+
+    int32_t previous = -1;
+    for (int16_t c = 0; c < contours; c++) {
+        int32_t value = ntohs(endPts[c]);
+        if (value <= previous) {
+            REJECT(res, FLYPH_TAG, "contour end points not increasing");
+        }
+        previous = value;
+    }
+
+    uint32_t points = (uint32_t)previous + 1;
+    if (max_points && points > max_points) {
+        REJECT(res, FLYPH_TAG, "more points than maxp allows");
+    }
+
+    uint16_t instructions = ntohs(*(uint16_t*)ptr);
+    ptr += 2;
+    if (instructions > end - ptr) {
+        REJECT(res, FLYPH_TAG, "instructions past end of glyph");
+    }
+    ptr += instructions;
+
+    // mirror the decoder in try_load_glyph, counting coordinate bytes as we go
+    uint32_t x_bytes = 0, y_bytes = 0, n = 0;
+    while (n < points) {
+        if (ptr >= end) {
+            REJECT(res, FLYPH_TAG, "flags past end of glyph");
+        }
+        uint8_t flag = *ptr++;
+        uint32_t repeat = 1;
+        if (flag & REPEAT_FLAG) {
+            if (ptr >= end) {
+                REJECT(res, FLYPH_TAG, "flags past end of glyph");
+            }
+            repeat += *ptr++;
+        }
+        if (n + repeat > points) {
+            REJECT(res, FLYPH_TAG, "flag repeat overruns point count");
+        }
+
+        uint32_t x_size = (flag & X_SHORT_VECTOR) ? 1 : (flag & X_IS_SAME_OR_POSITIVE) ? 0 : 2;
+        uint32_t y_size = (flag & Y_SHORT_VECTOR) ? 1 : (flag & Y_IS_SAME_OR_POSITIVE) ? 0 : 2;
+        x_bytes += x_size * repeat;
+        y_bytes += y_size * repeat;
+        n += repeat;
+    }
+
+    if (x_bytes + y_bytes > (uint32_t)(end - ptr)) {
+        REJECT(res, FLYPH_TAG, "coordinates past end of glyph");
+    }
+    return 0;
+}
+
+static int validate_composite_glyph(uint8_t *p, uint32_t length, uint16_t glyph, uint16_t num_glyphs, ttf_validation *res) {
+    uint8_t *end = p + length;
+    uint8_t *ptr = p + sizeof(glyph_header);
+    uint16_t flags;
+
+    do {
+        if (ptr + 4 > end) {
+            REJECT(res, FLYPH_TAG, "component past end of glyph");
+        }
+        flags = ntohs(*(uint16_t*)ptr);
+        uint16_t component = ntohs(*(uint16_t*)(ptr + 2));
+        ptr += 4;
+
+        if (component >= num_glyphs || component == glyph) {
+            REJECT(res, FLYPH_TAG, "bad component reference");
+        }
+
+        uint32_t size = (flags & ARG_1_AND_2_ARE_WORDS) ? 4 : 2;
+        if (flags & WE_HAVE_A_SCALE) {
+            size += 2;
+        } else if (flags & WE_HAVE_AN_X_AND_Y_SCALE) {
+            size += 4;
+        } else if (flags & WE_HAVE_A_TWO_BY_TWO) {
+            size += 8;
+        }
+        if (size > (uint32_t)(end - ptr)) {
+            REJECT(res, FLYPH_TAG, "component past end of glyph");
+        }
+        ptr += size;
+    } while (flags & MORE_COMPONENTS);
+
+    if (flags & WE_HAVE_INSTRUCTIONS) {
+        if (ptr + 2 > end || ntohs(*(uint16_t*)ptr) > end - ptr - 2) {
+            REJECT(res, FLYPH_TAG, "instructions past end of glyph");
+        }
+    }
+    return 0;
+}
+
+static int validate_glyphs(ttf_source *source, ttf_validation *res) {
+    table_span head_span, maxp_span, loca_span, glyf_span;
+
+    if (find_span(source, HEAD_TAG, &head_span) || head_span.length < sizeof(head_table)) {
+        REJECT(res, HEAD_TAG, "missing or truncated table");
+    }
+    head_table *head = (head_table*)head_span.data;
+    int16_t loc_format = (int16_t)ntohs(head->indexToLocFormat);
+    if (ntohl(head->magicNumber) != HEAD_MAGIC_NUMBER || (loc_format != 0 && loc_format != 1)) {
+        REJECT(res, HEAD_TAG, "bad magic number or loca format");
+    }
+
+    if (find_span(source, MAXP_TAG, &maxp_span) || maxp_span.length < 6) {
+        REJECT(res, MAXP_TAG, "missing or truncated table");
+    }
+    maxp_table *maxp = (maxp_table*)maxp_span.data;
+    uint16_t num_glyphs = ntohs(maxp->numGlyphs);
+    uint16_t max_points = maxp_span.length >= 8 ? ntohs(maxp->maxPoints) : 0;
+    if (num_glyphs == 0) {
+        REJECT(res, MAXP_TAG, "no glyphs");
+    }
+
+    if (find_span(source, LOCA_TAG, &loca_span)) {
+        REJECT(res, LOCA_TAG, "missing table");
+    }
+    if (find_span(source, FLYPH_TAG, &glyf_span)) {
+        REJECT(res, FLYPH_TAG, "missing table");
+    }
+
+    uint32_t entry_size = loc_format == 0 ? 2 : 4;
+    if ((uint64_t)(num_glyphs + 1) * entry_size > loca_span.length) {
+        REJECT(res, LOCA_TAG, "fewer entries than glyphs");
+    }
+
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i <= num_glyphs; i++) {
+        uint32_t offset = loc_format == 0
+            ? ntohs(((uint16_t*)loca_span.data)[i]) * 2u
+            : ntohl(((uint32_t*)loca_span.data)[i]);
+
+        if (offset < previous) {
+            res->glyph = i;
+            REJECT(res, LOCA_TAG, "offsets not monotonic");
+        }
+        if (offset > glyf_span.length) {
+            res->glyph = i;
+            REJECT(res, LOCA_TAG, "offset past end of glyf");
+        }
+
+        if (i > 0 && offset > previous) {
+            uint32_t length = offset - previous;
+            uint8_t *glyph = glyf_span.data + previous;
+            res->glyph = i - 1;
+
+            if (length < sizeof(glyph_header)) {
+                REJECT(res, FLYPH_TAG, "truncated glyph header");
+            }
+
+            int16_t contours = (int16_t)ntohs(((glyph_header*)glyph)->numberOfContours);
+            if (contours > 0 && validate_simple_glyph(glyph, length, contours, max_points, res)) {
+                return -1;
+            }
+            if (contours < 0 && validate_composite_glyph(glyph, length, i - 1, num_glyphs, res)) {
+                return -1;
+            }
+        }
+        previous = offset;
+    }
+    res->glyph = 0;
+
+    table_span hhea_span, hmtx_span;
+    if (!find_span(source, HHEA_TAG, &hhea_span) && !find_span(source, HMTX_TAG, &hmtx_span)) {
+        if (hhea_span.length < sizeof(hhea_table)) {
+            REJECT(res, HHEA_TAG, "truncated table");
+        }
+        uint16_t metrics = ntohs(((hhea_table*)hhea_span.data)->numberOfHMetrics);
+        if (metrics == 0 || metrics > num_glyphs
+            || (uint64_t)metrics * 4 + (uint64_t)(num_glyphs - metrics) * 2 > hmtx_span.length) {
+            REJECT(res, HMTX_TAG, "metrics do not cover every glyph");
+        }
+    }
+    return 0;
+}
+
+// Checks the table directory, the first cmap subtable, head, maxp, every loca
+// entry and glyf outline, and that hmtx covers every glyph. A font that passes is
+// marked trusted and its glyphs are decoded without per-glyph checks. Variation
+// tables (fvar, avar, gvar, HVAR, MVAR) are not checked here.
+int validate_ttf_source(ttf_source *source, ttf_validation *result) {
+    ttf_validation local = {0};
+    ttf_validation *res = result ? result : &local;
+    memset(res, 0, sizeof(ttf_validation));
+    source->trusted = false;
+
+    if (validate_directory(source, res) || validate_cmap(source, res) || validate_glyphs(source, res)) {
+        return -1;
+    }
+
+    source->trusted = true;
+    return 0;
+}
+
+// slow path for sources that never passed validate_ttf_source, run before each glyph is decoded
+int validate_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, ttf_validation *result) {
+    ttf_validation local = {0};
+    ttf_validation *res = result ? result : &local;
+    memset(res, 0, sizeof(ttf_validation));
+    if (validate_directory(source, res)) {
+        return -1;
+    }
+
+    table_span glyf_span, maxp_span;
+    if (find_span(source, FLYPH_TAG, &glyf_span)) {
+        REJECT(res, FLYPH_TAG, "missing table");
+    }
+    if (find_span(source, MAXP_TAG, &maxp_span) || maxp_span.length < 6) {
+        REJECT(res, MAXP_TAG, "missing or truncated table");
+    }
+    if (!in_bounds(glyf_span.length, glyph_offset, glyph_length)) {
+        REJECT(res, FLYPH_TAG, "glyph past end of table");
+    }
+    if (glyph_length == 0) {
+        return 0;
+    }
+    if (glyph_length < sizeof(glyph_header)) {
+        REJECT(res, FLYPH_TAG, "truncated glyph header");
+    }
+
+    uint8_t *glyph = glyf_span.data + glyph_offset;
+    int16_t contours = (int16_t)ntohs(((glyph_header*)glyph)->numberOfContours);
+    uint16_t num_glyphs = ntohs(((maxp_table*)maxp_span.data)->numGlyphs);
+    if (contours > 0) {
+        return validate_simple_glyph(glyph, glyph_length, contours, 0, res);
+    }
+    if (contours < 0) {
+        return validate_composite_glyph(glyph, glyph_length, 0xFFFF, num_glyphs, res);
+    }
+    return 0;
+}
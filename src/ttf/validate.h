@@ -0,0 +1,21 @@
+#ifndef VALIDATE
+#define VALIDATE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "source.h"
+#include "ttf.h"
+
+#define HEAD_MAGIC_NUMBER 0x5F0F3CF5
+
+typedef struct ttf_validation {
+    const char *reason;
+    const char *table;
+    uint32_t glyph;
+} ttf_validation;
+
+int validate_ttf_source(ttf_source *source, ttf_validation *result);
+int validate_glyph(ttf_source *source, uint32_t glyph_offset, uint32_t glyph_length, ttf_validation *result);
+
+#endif
@@ -0,0 +1,136 @@
+#include <string.h>
+
+#include "varstore.h"
+
+int load_item_variation_store(uint8_t *table, item_variation_store *store) {
+    memset(store, 0, sizeof(item_variation_store));
+
+    item_variation_store_header *header = (item_variation_store_header*)table;
+    if (ntohs(header->format) != 1) {
+        return -1;
+    }
+
+    uint8_t *region_list = table + ntohl(header->variationRegionListOffset);
+    store->table = table;
+    store->axis_count = ntohs(*(uint16_t*)region_list);
+    store->region_count = ntohs(*(uint16_t*)(region_list + 2));
+    store->regions = (int16_t*)(region_list + 4);
+    store->data_count = ntohs(header->itemVariationDataCount);
+    store->data_offsets = (uint32_t*)(table + sizeof(item_variation_store_header));
+
+    return 0;
+}
+
+// each region axis is a (start, peak, end) triple of big-endian F2Dot14
+void compute_region_scalars(const item_variation_store *store, const int16_t *coords, float *scalars) {
+    for (uint16_t r = 0; r < store->region_count; r++) {
+        const int16_t *axes = store->regions + r * store->axis_count * 3;
+        float scalar = 1.0f;
+
+        for (uint16_t a = 0; a < store->axis_count && scalar != 0.0f; a++) {
+            int16_t start = (int16_t)ntohs(axes[a * 3]);
+            int16_t peak = (int16_t)ntohs(axes[a * 3 + 1]);
+            int16_t end = (int16_t)ntohs(axes[a * 3 + 2]);
+            int16_t v = coords[a];
+
+            if (peak == 0 || v == peak || start > peak || peak > end || (start < 0 && end > 0)) {
+                continue;
+            }
+            if (v <= start || v >= end) {
+                scalar = 0.0f;
+            } else if (v < peak) {
+                scalar *= (float)(v - start) / (float)(peak - start);
+            } else {
+                scalar *= (float)(end - v) / (float)(end - peak);
+            }
+        }
+
+        scalars[r] = scalar;
+    }
+}
+
+float get_item_delta(const item_variation_store *store, uint16_t outer, uint16_t inner, const float *scalars) {
+    if (outer >= store->data_count) {
+        return 0.0f;
+    }
+
+    uint8_t *data = store->table + ntohl(store->data_offsets[outer]);
+    item_variation_data_header *header = (item_variation_data_header*)data;
+    uint16_t item_count = ntohs(header->itemCount);
+    uint16_t word_info = ntohs(header->wordDeltaCount);
+    uint16_t region_index_count = ntohs(header->regionIndexCount);
+
+    if (inner >= item_count) {
+        return 0.0f;
+    }
+
+    bool long_words = word_info & LONG_WORDS;
+    uint16_t word_count = word_info & WORD_DELTA_COUNT_MASK;
+    uint16_t *region_indexes = (uint16_t*)(data + sizeof(item_variation_data_header));
+
+    uint32_t word_size = long_words ? 4 : 2;
+    uint32_t short_size = long_words ? 2 : 1;
+    uint32_t row_size = word_count * word_size + (region_index_count - word_count) * short_size;
+    uint8_t *row = (uint8_t*)(region_indexes + region_index_count) + inner * row_size;
+
+    float delta = 0.0f;
+    for (uint16_t i = 0; i < region_index_count; i++) {
+        int32_t value;
+        if (i < word_count) {
+            value = long_words ? (int32_t)ntohl(*(uint32_t*)row) : (int16_t)ntohs(*(uint16_t*)row);
+            row += word_size;
+        } else {
+            value = long_words ? (int16_t)ntohs(*(uint16_t*)row) : (int8_t)*row;
+            row += short_size;
+        }
+
+        uint16_t region = ntohs(region_indexes[i]);
+        if (value != 0 && region < store->region_count) {
+            delta += scalars[region] * value;
+        }
+    }
+
+    return delta;
+}
+
+// without a map the glyph id is the inner index of data set 0
+void lookup_delta_set_index(uint8_t *map, uint32_t index, uint16_t *outer, uint16_t *inner) {
+    if (!map) {
+        *outer = 0;
+        *inner = (uint16_t)index;
+        return;
+    }
+
+    uint8_t format = map[0];
+    uint8_t entry_format = map[1];
+    uint32_t map_count;
+    uint8_t *entries;
+
+    if (format == 0) {
+        map_count = ntohs(*(uint16_t*)(map + 2));
+        entries = map + 4;
+    } else {
+        map_count = ntohl(*(uint32_t*)(map + 2));
+        entries = map + 6;
+    }
+
+    if (map_count == 0) {
+        *outer = *inner = 0;
+        return;
+    }
+    if (index >= map_count) {
+        index = map_count - 1;
+    }
+
+    uint32_t entry_size = ((entry_format & DELTA_SET_ENTRY_SIZE_MASK) >> 4) + 1;
+    uint32_t inner_bits = (entry_format & DELTA_SET_INNER_BITS_MASK) + 1;
+    uint8_t *p = entries + index * entry_size;
+
+    uint32_t entry = 0;
+    for (uint32_t i = 0; i < entry_size; i++) {
+        entry = (entry << 8) | p[i];
+    }
+
+    *outer = (uint16_t)(entry >> inner_bits);
+    *inner = (uint16_t)(entry & ((1u << inner_bits) - 1));
+}
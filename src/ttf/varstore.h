@@ -0,0 +1,43 @@
+#ifndef VARSTORE
+#define VARSTORE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <arpa/inet.h>
+
+#define DELTA_SET_INNER_BITS_MASK 0x0F
+#define DELTA_SET_ENTRY_SIZE_MASK 0x30
+#define LONG_WORDS 0x8000
+#define WORD_DELTA_COUNT_MASK 0x7FFF
+
+#pragma pack(1)
+
+typedef struct item_variation_store_header {
+    uint16_t format;
+    uint32_t variationRegionListOffset;
+    uint16_t itemVariationDataCount;
+} item_variation_store_header;
+
+typedef struct item_variation_data_header {
+    uint16_t itemCount;
+    uint16_t wordDeltaCount;
+    uint16_t regionIndexCount;
+} item_variation_data_header;
+
+#pragma pack()
+
+typedef struct item_variation_store {
+    uint8_t *table;
+    uint16_t axis_count;
+    uint16_t region_count;
+    int16_t *regions;
+    uint16_t data_count;
+    uint32_t *data_offsets;
+} item_variation_store;
+
+int load_item_variation_store(uint8_t *table, item_variation_store *store);
+void compute_region_scalars(const item_variation_store *store, const int16_t *coords, float *scalars);
+float get_item_delta(const item_variation_store *store, uint16_t outer, uint16_t inner, const float *scalars);
+void lookup_delta_set_index(uint8_t *map, uint32_t index, uint16_t *outer, uint16_t *inner);
+
+#endif